@@ -0,0 +1,134 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ADDRESSINDEX_H
+#define BITCOIN_ADDRESSINDEX_H
+
+#include "amount.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+/** Kinds of address in the address index. */
+enum AddressIndexType
+{
+    ADDRESSINDEX_NONE = 0,
+    ADDRESSINDEX_P2PKH = 1,
+    ADDRESSINDEX_P2SH = 2,
+};
+
+/**
+ * An entry of the address index: an output paid to an address, or an input
+ * spending one (with a negative amount). Heights and transaction positions
+ * are big-endian, so that the entries of an address are stored in chain
+ * order and a height range is a single key range.
+ */
+struct CAddressIndexKey
+{
+    uint8_t type;
+    uint160 hashBytes;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    unsigned int index;
+    bool spending;
+
+    CAddressIndexKey() : type(ADDRESSINDEX_NONE), blockHeight(0), txindex(0), index(0), spending(false) {}
+    CAddressIndexKey(uint8_t typeIn, const uint160& hashBytesIn, int blockHeightIn, unsigned int txindexIn,
+                     const uint256& txhashIn, unsigned int indexIn, bool spendingIn) :
+        type(typeIn), hashBytes(hashBytesIn), blockHeight(blockHeightIn), txindex(txindexIn),
+        txhash(txhashIn), index(indexIn), spending(spendingIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return 1 + 20 + 4 + 4 + 32 + 4 + 1;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s, nType, nVersion);
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s, nType, nVersion);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s, nType, nVersion);
+        index = ser_readdata32(s);
+        spending = ser_readdata8(s) != 0;
+    }
+};
+
+/** An unspent output paid to an address. */
+struct CAddressUnspentKey
+{
+    uint8_t type;
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index;
+
+    CAddressUnspentKey() : type(ADDRESSINDEX_NONE), index(0) {}
+    CAddressUnspentKey(uint8_t typeIn, const uint160& hashBytesIn, const uint256& txhashIn, unsigned int indexIn) :
+        type(typeIn), hashBytes(hashBytesIn), txhash(txhashIn), index(indexIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return 1 + 20 + 32 + 4;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s, nType, nVersion);
+        txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s, nType, nVersion);
+        txhash.Unserialize(s, nType, nVersion);
+        index = ser_readdata32(s);
+    }
+};
+
+/** The output behind a CAddressUnspentKey. A null value erases the entry. */
+struct CAddressUnspentValue
+{
+    CAmount satoshis;
+    CScript script;
+    int blockHeight;
+
+    CAddressUnspentValue() { SetNull(); }
+    CAddressUnspentValue(CAmount satoshisIn, const CScript& scriptIn, int blockHeightIn) :
+        satoshis(satoshisIn), script(scriptIn), blockHeight(blockHeightIn) {}
+
+    void SetNull() {
+        satoshis = -1;
+        script.clear();
+        blockHeight = 0;
+    }
+
+    bool IsNull() const { return satoshis == -1; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(satoshis);
+        READWRITE(script);
+        READWRITE(blockHeight);
+    }
+};
+
+#endif // BITCOIN_ADDRESSINDEX_H
@@ -10,23 +10,21 @@
 #include "streams.h"
 #include "util.h"
 
+#include <algorithm>
+
 // AMQP 1.0 Support
 //
 // The boost::signals2 signals and slot system is thread safe, so CValidationInterface listeners
 // can be invoked from any thread.
 //
-// Currently signals are fired from main.cpp so the callbacks should be invoked on the same thread.
-// It should be safe to share objects responsible for sending, as they should not be run concurrently
-// across different threads.
-//
-// Developers should be mindful of where notifications are fired to avoid potential race conditions.
-// For example, different signals targeting the same address could be fired from different threads
-// in different parts of the system around the same time.
+// The callbacks only number the notification and serialize what it publishes, and then queue it.
+// The notifiers themselves are only invoked from the queue's thread, so objects responsible for
+// sending are never used concurrently, whichever thread fired the signal.
 //
 // Like the ZMQ notification interface, if a notifier fails to send a message, the notifier is shut down.
 //
 
-AMQPNotificationInterface::AMQPNotificationInterface()
+AMQPNotificationInterface::AMQPNotificationInterface() : fBlockData(false), fTransactionData(false), nBlockSequence(0), nTransactionSequence(0)
 {
 }
 
@@ -63,8 +61,26 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     }
 
     if (!notifiers.empty()) {
+        int64_t nQueueSize = DEFAULT_NOTIFICATION_QUEUE_SIZE;
+        std::map<std::string, std::string>::const_iterator it = args.find("-amqpqueuesize");
+        if (it != args.end())
+            nQueueSize = std::max((int64_t)1, atoi64(it->second));
+        NotificationQueuePolicy policy = NOTIFY_DROP;
+        it = args.find("-amqpqueuepolicy");
+        if (it != args.end())
+            ParseNotificationQueuePolicy(it->second, policy);
+
         notificationInterface = new AMQPNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->queue.reset(new CNotificationQueue(nQueueSize << 20, policy));
+        for (std::list<AMQPAbstractNotifier*>::const_iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
+            if ((*i)->PublishesData()) {
+                if ((*i)->GetType() == "pubrawblock")
+                    notificationInterface->fBlockData = true;
+                else
+                    notificationInterface->fTransactionData = true;
+            }
+        }
 
         if (!notificationInterface->Initialize()) {
             delete notificationInterface;
@@ -95,6 +111,7 @@ bool AMQPNotificationInterface::Initialize()
         return false;
     }
 
+    queue->Start();
     return true;
 }
 
@@ -102,6 +119,8 @@ bool AMQPNotificationInterface::Initialize()
 void AMQPNotificationInterface::Shutdown()
 {
     LogPrint("amqp", "amqp: Shutdown notification interface\n");
+    if (queue)
+        queue->Stop();
 
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
         AMQPAbstractNotifier *notifier = *i;
@@ -109,11 +128,79 @@ void AMQPNotificationInterface::Shutdown()
     }
 }
 
+void AMQPNotificationInterface::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+{
+    // Blocks are only announced once the node is in sync, so there is no
+    // point in serializing them before.
+    if (!fBlockData || !added || IsInitialBlockDownload())
+        return;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *pblock;
+    std::lock_guard<std::mutex> lock(cs_lastBlock);
+    hashLastBlock = pindex->GetBlockHash();
+    lastBlockData = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+}
+
 void AMQPNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    CNotificationData block;
+    block.hash = pindex->GetBlockHash();
+    CDiskBlockPos pos;
+    if (fBlockData) {
+        std::lock_guard<std::mutex> lock(cs_lastBlock);
+        if (hashLastBlock == block.hash)
+            block.data = lastBlockData;
+        lastBlockData.reset();
+    }
+    if (fBlockData && !block.data) {
+        // The block was connected before ChainTip serialized blocks, so it
+        // is read back from disk on the queue's thread instead.
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+
+    std::lock_guard<std::mutex> lock(cs_sequence);
+    block.nSequence = nBlockSequence++;
+    size_t nSize = block.data ? block.data->size() : 0;
+    if (!queue->Push([this, block, pos]() mutable {
+            if (!pos.IsNull()) {
+                CBlock blockRead;
+                if (ReadBlockFromDisk(blockRead, pos)) {
+                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    ss << blockRead;
+                    block.data = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+                }
+            }
+            PublishBlock(block);
+        }, nSize)) {
+        LogPrint("amqp", "amqp: Notification queue full, dropped block %s\n", block.hash.GetHex());
+    }
+}
+
+void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    CNotificationData transaction;
+    transaction.hash = tx.GetHash();
+    if (fTransactionData) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << tx;
+        transaction.data = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+    }
+
+    std::lock_guard<std::mutex> lock(cs_sequence);
+    transaction.nSequence = nTransactionSequence++;
+    size_t nSize = transaction.data ? transaction.data->size() : 0;
+    if (!queue->Push([this, transaction]() { PublishTransaction(transaction); }, nSize)) {
+        LogPrint("amqp", "amqp: Notification queue full, dropped transaction %s\n", transaction.hash.GetHex());
+    }
+}
+
+void AMQPNotificationInterface::PublishBlock(const CNotificationData &block)
 {
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
         AMQPAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex)) {
+        if (notifier->NotifyBlock(block)) {
             i++;
         } else {
             notifier->Shutdown();
@@ -122,11 +209,11 @@ void AMQPNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
-void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+void AMQPNotificationInterface::PublishTransaction(const CNotificationData &transaction)
 {
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
         AMQPAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx)) {
+        if (notifier->NotifyTransaction(transaction)) {
             i++;
         } else {
             notifier->Shutdown();
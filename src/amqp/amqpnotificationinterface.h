@@ -5,9 +5,14 @@
 #ifndef ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
 #define ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
 
+#include "notificationqueue.h"
 #include "validationinterface.h"
-#include <string>
+
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 
 class CBlockIndex;
 class AMQPAbstractNotifier;
@@ -26,11 +31,33 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added);
 
 private:
     AMQPNotificationInterface();
 
+    //! Only used by the queue's thread once it has been started.
     std::list<AMQPAbstractNotifier*> notifiers;
+    std::unique_ptr<CNotificationQueue> queue;
+
+    //! Whether some notifier publishes serialized blocks or transactions.
+    bool fBlockData;
+    bool fTransactionData;
+
+    //! Held while numbering and queueing a notification, so that they are
+    //! queued in sequence order.
+    std::mutex cs_sequence;
+    uint64_t nBlockSequence;
+    uint64_t nTransactionSequence;
+
+    //! The last block connected, serialized while validation had it in
+    //! memory, for the following UpdatedBlockTip.
+    std::mutex cs_lastBlock;
+    uint256 hashLastBlock;
+    std::shared_ptr<const std::vector<unsigned char> > lastBlockData;
+
+    void PublishBlock(const CNotificationData &block);
+    void PublishTransaction(const CNotificationData &transaction);
 };
 
 #endif // ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
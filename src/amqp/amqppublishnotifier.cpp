@@ -3,7 +3,6 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amqppublishnotifier.h"
-#include "main.h"
 #include "util.h"
 
 #include "amqpsender.h"
@@ -93,7 +92,7 @@ void AMQPAbstractPublishNotifier::Shutdown()
 }
 
 
-bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size, uint64_t sequence)
 {
     try { 
         proton::binary content;
@@ -103,7 +102,7 @@ bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* d
         proton::message message(content);
         message.subject(std::string(command));
         proton::message::property_map & props = message.properties();
-        props.put("x-opt-sequence-number", sequence_);
+        props.put("x-opt-sequence-number", sequence);
         handler_->publish(message);
 
     } catch (proton::error_condition &e) {
@@ -123,55 +122,39 @@ bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* d
         return false;
     }
 
-    sequence_++;
-
     return true;
 }
 
-bool AMQPPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool AMQPPublishHashBlockNotifier::NotifyBlock(const CNotificationData &block)
 {
-    uint256 hash = pindex->GetBlockHash();
-    LogPrint("amqp", "amqp: Publish hashblock %s\n", hash.GetHex());
+    LogPrint("amqp", "amqp: Publish hashblock %s\n", block.hash.GetHex());
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
-        data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHBLOCK, data, 32);
+        data[31 - i] = block.hash.begin()[i];
+    return SendMessage(MSG_HASHBLOCK, data, 32, block.nSequence);
 }
 
-bool AMQPPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool AMQPPublishHashTransactionNotifier::NotifyTransaction(const CNotificationData &transaction)
 {
-    uint256 hash = transaction.GetHash();
-    LogPrint("amqp", "amqp: Publish hashtx %s\n", hash.GetHex());
+    LogPrint("amqp", "amqp: Publish hashtx %s\n", transaction.hash.GetHex());
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
-        data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTX, data, 32);
+        data[31 - i] = transaction.hash.begin()[i];
+    return SendMessage(MSG_HASHTX, data, 32, transaction.nSequence);
 }
 
-bool AMQPPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool AMQPPublishRawBlockNotifier::NotifyBlock(const CNotificationData &block)
 {
-    LogPrint("amqp", "amqp: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
-
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("amqp", "amqp: Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+    LogPrint("amqp", "amqp: Publish rawblock %s\n", block.hash.GetHex());
+    if (!block.data) {
+        LogPrint("amqp", "amqp: Can't read block from disk");
+        return false;
     }
-
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, block.data->data(), block.data->size(), block.nSequence);
 }
 
-bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CNotificationData &transaction)
 {
-    uint256 hash = transaction.GetHash();
-    LogPrint("amqp", "amqp: Publish rawtx %s\n", hash.GetHex());
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    LogPrint("amqp", "amqp: Publish rawtx %s\n", transaction.hash.GetHex());
+    return SendMessage(MSG_RAWTX, transaction.data->data(), transaction.data->size(), transaction.nSequence);
 }
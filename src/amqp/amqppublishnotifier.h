@@ -12,18 +12,15 @@
 #include <memory>
 #include <thread>
 
-class CBlockIndex;
-
 class AMQPAbstractPublishNotifier : public AMQPAbstractNotifier
 {
 private:
-    uint64_t sequence_;                         // memory only, per notifier instance: upcounting message sequence number
-
     std::shared_ptr<std::thread> thread_;       // proton container thread, may be shared between notifiers
     std::shared_ptr<AMQPSender> handler_;      // proton container message handler, may be shared between notifiers
 
 public:
-    bool SendMessage(const char *command, const void* data, size_t size);
+    // sequence counts the notifications of this kind, including any dropped from the queue
+    bool SendMessage(const char *command, const void* data, size_t size, uint64_t sequence);
     bool Initialize();
     void Shutdown();
     void SpawnProtonContainer();
@@ -32,25 +29,27 @@ public:
 class AMQPPublishHashBlockNotifier : public AMQPAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CNotificationData &block);
 };
 
 class AMQPPublishHashTransactionNotifier : public AMQPAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NotifyTransaction(const CNotificationData &transaction);
 };
 
 class AMQPPublishRawBlockNotifier : public AMQPAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool PublishesData() const { return true; }
+    bool NotifyBlock(const CNotificationData &block);
 };
 
 class AMQPPublishRawTransactionNotifier : public AMQPAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool PublishesData() const { return true; }
+    bool NotifyTransaction(const CNotificationData &transaction);
 };
 
 #endif // ZCASH_AMQP_AMQPPUBLISHNOTIFIER_H
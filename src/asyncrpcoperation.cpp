@@ -27,7 +27,7 @@ std::map<OperationStatus, std::string> OperationStatusMap = {
 /**
  * Every operation instance should have a globally unique id
  */
-AsyncRPCOperation::AsyncRPCOperation() : error_code_(0), error_message_() {
+AsyncRPCOperation::AsyncRPCOperation() : error_code_(0), error_message_(), priority_(OperationPriority::NORMAL) {
     // Set a unique reference for each operation
     boost::uuids::uuid uuid = uuidgen();
     id_ = "opid-" + boost::uuids::to_string(uuid);
@@ -35,11 +35,18 @@ AsyncRPCOperation::AsyncRPCOperation() : error_code_(0), error_message_() {
     set_state(OperationStatus::READY);
 }
 
+AsyncRPCOperation::AsyncRPCOperation(AsyncRPCOperationId id, int64_t creationTime) :
+        error_code_(0), error_message_(), priority_(OperationPriority::NORMAL),
+        id_(id), creation_time_(creationTime)
+{
+    set_state(OperationStatus::READY);
+}
+
 AsyncRPCOperation::AsyncRPCOperation(const AsyncRPCOperation& o) :
         id_(o.id_), creation_time_(o.creation_time_), state_(o.state_.load()),
         start_time_(o.start_time_), end_time_(o.end_time_),
         error_code_(o.error_code_), error_message_(o.error_message_),
-        result_(o.result_)
+        result_(o.result_), priority_(o.priority_.load())
 {
 }
 
@@ -52,6 +59,7 @@ AsyncRPCOperation& AsyncRPCOperation::operator=( const AsyncRPCOperation& other
     this->error_code_ = other.error_code_;
     this->error_message_ = other.error_message_;
     this->result_ = other.result_;
+    this->priority_.store(other.priority_.load());
     return *this;
 }
 
@@ -68,6 +76,18 @@ void AsyncRPCOperation::cancel() {
     }
 }
 
+/**
+ * Called by main() between steps it can pause at.
+ */
+bool AsyncRPCOperation::shouldYield() const {
+    std::function<bool()> check;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        check = yield_check_;
+    }
+    return check && check();
+}
+
 /**
  * Start timing the execution run of the code you're interested in
  */
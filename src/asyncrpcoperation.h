@@ -10,6 +10,7 @@
 #include <atomic>
 #include <map>
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <thread>
 #include <utility>
@@ -25,6 +26,9 @@ using namespace std;
  * To subclass AsyncRPCOperation, implement the main() method.
  * Update the operation status as work is underway and completes.
  * If main() can be interrupted, inmplement the cancel() method.
+ * If main() can pause between steps, check shouldYield() between them; when
+ * it returns true, keep the progress made, set the state back to READY and
+ * return. The queue will call main() again later.
  */
 
 typedef std::string AsyncRPCOperationId;
@@ -37,6 +41,16 @@ typedef enum class operationStateEnum {
     SUCCESS
 } OperationStatus;
 
+// Operations of a higher priority are run first, and lower priority
+// operations that can pause make way for them.
+typedef enum class operationPriorityEnum {
+    HIGH = 0,
+    NORMAL,
+    LOW
+} OperationPriority;
+
+class AsyncRPCQueue;
+
 class AsyncRPCOperation {
 public:
     AsyncRPCOperation();
@@ -62,6 +76,15 @@ public:
         return creation_time_;
     }
 
+    OperationPriority getPriority() const {
+        return priority_.load();
+    }
+
+    // Set before adding the operation to a queue.
+    void setPriority(OperationPriority priority) {
+        priority_.store(priority);
+    }
+
     // Override this method to add data to the default status object.
     virtual UniValue getStatus() const;
 
@@ -116,6 +139,13 @@ protected:
     std::atomic<OperationStatus> state_;
     std::chrono::time_point<std::chrono::system_clock> start_time_, end_time_;  
 
+    // Resume an operation saved before a restart, under its original id.
+    AsyncRPCOperation(AsyncRPCOperationId id, int64_t creationTime);
+
+    // True if the operation should pause: the queue is closing, or a higher
+    // priority operation is waiting.
+    bool shouldYield() const;
+
     void start_execution_clock();
     void stop_execution_clock();
 
@@ -139,6 +169,11 @@ protected:
     }
     
 private:
+    friend class AsyncRPCQueue;
+
+    std::atomic<OperationPriority> priority_;
+    // Installed by the queue running the operation, see shouldYield()
+    std::function<bool()> yield_check_;
 
     // Derived classes should write their own copy constructor and assignment operators
     AsyncRPCOperation(const AsyncRPCOperation& orig);
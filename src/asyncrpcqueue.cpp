@@ -4,6 +4,8 @@
 
 #include "asyncrpcqueue.h"
 
+#include <algorithm>
+
 static std::atomic<size_t> workerCounter(0);
 
 /**
@@ -15,7 +17,7 @@ shared_ptr<AsyncRPCQueue> AsyncRPCQueue::sharedInstance() {
     return q;
 }
 
-AsyncRPCQueue::AsyncRPCQueue() : closed_(false), finish_(false) {
+AsyncRPCQueue::AsyncRPCQueue() : closed_(false), finish_(false), max_finished_(DEFAULT_ASYNC_RPC_OPERATION_HISTORY) {
 }
 
 AsyncRPCQueue::~AsyncRPCQueue() {
@@ -32,26 +34,31 @@ void AsyncRPCQueue::run(size_t workerId) {
         std::shared_ptr<AsyncRPCOperation> operation;
         {
             std::unique_lock<std::mutex> guard(lock_);
-            while (operation_id_queue_.empty() && !isClosed() && !isFinishing()) {
+            while (getOperationCountLocked() == 0 && !isClosed() && !isFinishing()) {
                 this->condition_.wait(guard);
             }
 
             // Exit if the queue is empty and we are finishing up
-            if (isFinishing() && operation_id_queue_.empty()) {
+            if (isFinishing() && getOperationCountLocked() == 0) {
                 break;
             }
 
             // Exit if the queue is closing.
             if (isClosed()) {
-                while (!operation_id_queue_.empty()) {
-                    operation_id_queue_.pop();
+                for (auto& q : operation_id_queues_) {
+                    q.clear();
                 }
                 break;
             }
 
-            // Get operation id
-            key = operation_id_queue_.front();
-            operation_id_queue_.pop();
+            // Get the id of the oldest operation of the highest priority
+            for (auto& q : operation_id_queues_) {
+                if (!q.empty()) {
+                    key = q.front();
+                    q.pop_front();
+                    break;
+                }
+            }
 
             // Search operation map
             AsyncRPCOperationMap::const_iterator iter = operation_map_.find(key);
@@ -62,10 +69,36 @@ void AsyncRPCQueue::run(size_t workerId) {
 
         if (!operation) {
             // cannot find operation in map, may have been removed
+            continue;
         } else if (operation->isCancelled()) {
             // skip cancelled operation
         } else {
+            OperationPriority priority = operation->getPriority();
+            {
+                std::lock_guard<std::mutex> guard(operation->lock_);
+                operation->yield_check_ = [this, priority]() {
+                    return isClosed() || has_waiting_operations(priority);
+                };
+            }
             operation->main();
+            {
+                std::lock_guard<std::mutex> guard(operation->lock_);
+                operation->yield_check_ = nullptr;
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        if (operation->isReady()) {
+            // The operation paused; it goes on before others of its priority.
+            if (!isClosed()) {
+                operation_id_queues_[(size_t)operation->getPriority()].push_front(key);
+            }
+        } else if (operation_map_.count(key)) {
+            finished_ids_.push_back(key);
+            while (finished_ids_.size() > max_finished_) {
+                operation_map_.erase(finished_ids_.front());
+                finished_ids_.pop_front();
+            }
         }
     }
 }
@@ -91,7 +124,7 @@ void AsyncRPCQueue::addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOp
 
     AsyncRPCOperationId id = ptrOperation->getId();
     operation_map_.emplace(id, ptrOperation);
-    operation_id_queue_.push(id);
+    operation_id_queues_[(size_t)ptrOperation->getPriority()].push_back(id);
     this->condition_.notify_one();
 }
 
@@ -119,6 +152,7 @@ std::shared_ptr<AsyncRPCOperation> AsyncRPCQueue::popOperationForId(AsyncRPCOper
         // Note: if the id still exists in the operationIdQueue, when it gets processed by a worker
         // there will no operation in the map to execute, so nothing will happen.
         operation_map_.erase(id);
+        finished_ids_.erase(std::remove(finished_ids_.begin(), finished_ids_.end(), id), finished_ids_.end());
     }
     return ptr;
 }
@@ -168,7 +202,36 @@ void AsyncRPCQueue::cancelAllOperations() {
  */
 size_t AsyncRPCQueue::getOperationCount() const {
     std::lock_guard<std::mutex> guard(lock_);
-    return operation_id_queue_.size();
+    return getOperationCountLocked();
+}
+
+size_t AsyncRPCQueue::getOperationCountLocked() const {
+    size_t n = 0;
+    for (const auto& q : operation_id_queues_) {
+        n += q.size();
+    }
+    return n;
+}
+
+/**
+ * Return true if an operation of a higher priority than the given one is waiting to run
+ */
+bool AsyncRPCQueue::has_waiting_operations(OperationPriority priority) const {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (size_t i = 0; i < (size_t)priority; i++) {
+        if (!operation_id_queues_[i].empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Set how many finished operations are kept for z_getoperationstatus and z_getoperationresult
+ */
+void AsyncRPCQueue::setMaxFinishedOperations(size_t n) {
+    std::lock_guard<std::mutex> guard(lock_);
+    max_finished_ = n;
 }
 
 /**
@@ -7,10 +7,11 @@
 
 #include "asyncrpcoperation.h"
 
+#include <array>
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <queue>
+#include <deque>
 #include <unordered_map>
 #include <vector>
 #include <future>
@@ -21,6 +22,9 @@
 
 typedef std::unordered_map<AsyncRPCOperationId, std::shared_ptr<AsyncRPCOperation> > AsyncRPCOperationMap; 
 
+// Default number of finished operations whose results are kept until fetched
+static const size_t DEFAULT_ASYNC_RPC_OPERATION_HISTORY = 1000;
+
 
 class AsyncRPCQueue {
 public:
@@ -44,7 +48,8 @@ public:
     void closeAndWait(); // block thread until all threads have terminated.
     void finishAndWait(); // block thread until existing operations have finished, threads terminated
     void cancelAllOperations(); // mark all operations in the queue as cancelled
-    size_t getOperationCount() const;
+    size_t getOperationCount() const; // number of operations waiting to run
+    void setMaxFinishedOperations(size_t n); // beyond this, the oldest finished operations are forgotten
     std::shared_ptr<AsyncRPCOperation> getOperationForId(AsyncRPCOperationId) const;
     std::shared_ptr<AsyncRPCOperation> popOperationForId(AsyncRPCOperationId);
     void addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOperation);
@@ -54,6 +59,8 @@ private:
     // addWorker() will spawn a new thread on run())
     void run(size_t workerId);
     void wait_for_worker_threads();
+    size_t getOperationCountLocked() const;
+    bool has_waiting_operations(OperationPriority priority) const; // with a higher priority
 
     // Why this is not a recursive lock: http://www.zaval.org/resources/library/butenhof1.html
     mutable std::mutex lock_;
@@ -61,7 +68,11 @@ private:
     std::atomic<bool> closed_;
     std::atomic<bool> finish_;
     AsyncRPCOperationMap operation_map_;
-    std::queue <AsyncRPCOperationId> operation_id_queue_;
+    // One queue per OperationPriority, highest first
+    std::array<std::deque<AsyncRPCOperationId>, 3> operation_id_queues_;
+    // Finished operations still in operation_map_, oldest first
+    std::deque<AsyncRPCOperationId> finished_ids_;
+    size_t max_finished_;
     std::vector<std::thread> workers_;
 };
 
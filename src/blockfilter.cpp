@@ -0,0 +1,230 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "crypto/common.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "streams.h"
+#include "undo.h"
+#include "version.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/foreach.hpp>
+
+template <typename OStream>
+static void GolombRiceEncode(BitStreamWriter<OStream>& bitwriter, int P, uint64_t x)
+{
+    // The quotient in unary, as that many 1 bits and a 0 bit, then the
+    // remainder in P bits.
+    uint64_t q = x >> P;
+    while (q > 0) {
+        int nbits = q <= 64 ? static_cast<int>(q) : 64;
+        bitwriter.Write(~0ULL, nbits);
+        q -= nbits;
+    }
+    bitwriter.Write(0, 1);
+    bitwriter.Write(x, P);
+}
+
+template <typename IStream>
+static uint64_t GolombRiceDecode(BitStreamReader<IStream>& bitreader, int P)
+{
+    uint64_t q = 0;
+    while (bitreader.Read(1) == 1)
+        q++;
+    uint64_t r = bitreader.Read(P);
+    return (q << P) + r;
+}
+
+CGolombCodedSet::CGolombCodedSet() : k0(0), k1(0), P(0), M(0), N(0), F(0)
+{
+    // An empty set
+    vchEncoded.push_back(0);
+}
+
+CGolombCodedSet::CGolombCodedSet(uint64_t k0In, uint64_t k1In, int PIn, uint32_t MIn, const ElementSet& elements) :
+    k0(k0In), k1(k1In), P(PIn), M(MIn)
+{
+    if (elements.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("CGolombCodedSet: too many elements");
+    N = static_cast<uint32_t>(elements.size());
+    F = static_cast<uint64_t>(N) * static_cast<uint64_t>(M);
+
+    CDataStream stream(SER_NETWORK, 0);
+    WriteCompactSize(stream, N);
+    {
+        BitStreamWriter<CDataStream> bitwriter(stream);
+        uint64_t last = 0;
+        BOOST_FOREACH(uint64_t value, BuildHashedSet(elements)) {
+            GolombRiceEncode(bitwriter, P, value - last);
+            last = value;
+        }
+    }
+    vchEncoded.assign(stream.begin(), stream.end());
+}
+
+CGolombCodedSet::CGolombCodedSet(uint64_t k0In, uint64_t k1In, int PIn, uint32_t MIn, const std::vector<unsigned char>& vchEncodedIn) :
+    k0(k0In), k1(k1In), P(PIn), M(MIn), vchEncoded(vchEncodedIn)
+{
+    CDataStream stream(vchEncoded, SER_NETWORK, 0);
+    uint64_t nElements = ReadCompactSize(stream);
+    if (nElements > std::numeric_limits<uint32_t>::max())
+        throw std::ios_base::failure("CGolombCodedSet: too many elements");
+    N = static_cast<uint32_t>(nElements);
+    F = static_cast<uint64_t>(N) * static_cast<uint64_t>(M);
+
+    // Decode the whole set once, so that a malformed one is rejected here
+    // rather than when it is matched.
+    BitStreamReader<CDataStream> bitreader(stream);
+    for (uint64_t i = 0; i < N; i++)
+        GolombRiceDecode(bitreader, P);
+    if (!stream.empty())
+        throw std::ios_base::failure("CGolombCodedSet: encoded set has trailing data");
+}
+
+uint64_t CGolombCodedSet::HashToRange(const Element& element) const
+{
+    uint64_t hash = CSipHasher(k0, k1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(hash, F);
+}
+
+std::vector<uint64_t> CGolombCodedSet::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> hashed;
+    hashed.reserve(elements.size());
+    BOOST_FOREACH(const Element& element, elements) {
+        hashed.push_back(HashToRange(element));
+    }
+    std::sort(hashed.begin(), hashed.end());
+    return hashed;
+}
+
+bool CGolombCodedSet::MatchInternal(const uint64_t* pelements, size_t nElements) const
+{
+    CDataStream stream(vchEncoded, SER_NETWORK, 0);
+    ReadCompactSize(stream);
+    BitStreamReader<CDataStream> bitreader(stream);
+
+    // Walk the set and the sorted query together.
+    uint64_t value = 0;
+    size_t nQuery = 0;
+    for (uint32_t i = 0; i < N; i++) {
+        value += GolombRiceDecode(bitreader, P);
+        while (nQuery < nElements && pelements[nQuery] < value)
+            nQuery++;
+        if (nQuery == nElements)
+            return false;
+        if (pelements[nQuery] == value)
+            return true;
+    }
+    return false;
+}
+
+bool CGolombCodedSet::Match(const Element& element) const
+{
+    if (N == 0)
+        return false;
+    uint64_t query = HashToRange(element);
+    return MatchInternal(&query, 1);
+}
+
+bool CGolombCodedSet::MatchAny(const ElementSet& elements) const
+{
+    if (N == 0 || elements.empty())
+        return false;
+    std::vector<uint64_t> queries = BuildHashedSet(elements);
+    return MatchInternal(queries.data(), queries.size());
+}
+
+CGolombCodedSet::ElementSet CBlockFilter::GetElements(const CBlock& block, const CBlockUndo& blockundo)
+{
+    CGolombCodedSet::ElementSet elements;
+    BOOST_FOREACH(const CTransaction& tx, block.vtx) {
+        BOOST_FOREACH(const CTxOut& out, tx.vout) {
+            const CScript& script = out.scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN)
+                continue;
+            elements.insert(CGolombCodedSet::Element(script.begin(), script.end()));
+        }
+    }
+    BOOST_FOREACH(const CTxUndo& txundo, blockundo.vtxundo) {
+        BOOST_FOREACH(const CTxInUndo& undo, txundo.vprevout) {
+            const CScript& script = undo.txout.scriptPubKey;
+            if (script.empty())
+                continue;
+            elements.insert(CGolombCodedSet::Element(script.begin(), script.end()));
+        }
+    }
+    return elements;
+}
+
+/** The SipHash key of a block's filter: the first 16 bytes of its hash. */
+static void GetFilterKey(const uint256& hashBlock, uint64_t& k0, uint64_t& k1)
+{
+    k0 = ReadLE64(hashBlock.begin());
+    k1 = ReadLE64(hashBlock.begin() + 8);
+}
+
+CBlockFilter::CBlockFilter(const CBlock& block, const CBlockUndo& blockundo) : hashBlock(block.GetHash())
+{
+    uint64_t k0, k1;
+    GetFilterKey(hashBlock, k0, k1);
+    filter = CGolombCodedSet(k0, k1, BLOCK_FILTER_P, BLOCK_FILTER_M, GetElements(block, blockundo));
+}
+
+CBlockFilter::CBlockFilter(const uint256& hashBlockIn, const std::vector<unsigned char>& vchEncoded) : hashBlock(hashBlockIn)
+{
+    uint64_t k0, k1;
+    GetFilterKey(hashBlock, k0, k1);
+    filter = CGolombCodedSet(k0, k1, BLOCK_FILTER_P, BLOCK_FILTER_M, vchEncoded);
+}
+
+uint256 CBlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& vchEncoded = filter.GetEncoded();
+    return Hash(vchEncoded.begin(), vchEncoded.end());
+}
+
+uint256 CBlockFilter::ComputeHeader(const uint256& hashPrevHeader) const
+{
+    uint256 hashFilter = GetHash();
+    return Hash(hashFilter.begin(), hashFilter.end(), hashPrevHeader.begin(), hashPrevHeader.end());
+}
+
+CCompactShieldedBlock BuildCompactShieldedBlock(const CBlock& block, int nHeight)
+{
+    CCompactShieldedBlock compact;
+    compact.hashBlock = block.GetHash();
+    compact.hashPrevBlock = block.hashPrevBlock;
+    compact.nHeight = nHeight;
+    compact.nTime = block.nTime;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        if (tx.vjoinsplit.empty())
+            continue;
+        CCompactTx ctx;
+        ctx.txid = tx.GetHash();
+        ctx.index = i;
+        BOOST_FOREACH(const JSDescription& jsdesc, tx.vjoinsplit) {
+            CCompactJoinSplit cjs;
+            cjs.nullifiers = jsdesc.nullifiers;
+            cjs.commitments = jsdesc.commitments;
+            cjs.ephemeralKey = jsdesc.ephemeralKey;
+            cjs.h_sig = ZCJoinSplit::h_sig(jsdesc.randomSeed, jsdesc.nullifiers, tx.joinSplitPubKey);
+            for (size_t j = 0; j < ZC_NUM_JS_OUTPUTS; j++) {
+                const ZCNoteEncryption::Ciphertext& ciphertext = jsdesc.ciphertexts[j];
+                cjs.ciphertextPrefixes[j].assign(ciphertext.begin(), ciphertext.begin() + COMPACT_CIPHERTEXT_SIZE);
+            }
+            ctx.vjoinsplit.push_back(cjs);
+        }
+        compact.vtx.push_back(ctx);
+    }
+    return compact;
+}
@@ -0,0 +1,177 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILTER_H
+#define BITCOIN_BLOCKFILTER_H
+
+#include "serialize.h"
+#include "uint256.h"
+#include "zcash/NoteEncryption.hpp"
+#include "zcash/Zcash.h"
+
+#include <stdint.h>
+
+#include <set>
+#include <vector>
+
+#include <boost/array.hpp>
+
+class CBlock;
+class CBlockUndo;
+
+//! Golomb-Rice parameter of block filters
+static const int BLOCK_FILTER_P = 19;
+//! Inverse false positive rate of block filters
+static const uint32_t BLOCK_FILTER_M = 784931;
+//! Leading bytes of a note ciphertext in a compact block: enough to recover
+//! the note's leading byte, value, rho and r, but not its memo.
+static const size_t COMPACT_CIPHERTEXT_SIZE = ZC_NOTEPLAINTEXT_LEADING + ZC_V_SIZE + ZC_RHO_SIZE + ZC_R_SIZE;
+
+/**
+ * A Golomb-coded set: a compact probabilistic set of byte strings with no
+ * false negatives and a false positive rate of 1/M. Elements are hashed with
+ * SipHash into [0, N * M), and the sorted hashes are stored as Golomb-Rice
+ * coded differences.
+ */
+class CGolombCodedSet
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+private:
+    uint64_t k0, k1;
+    int P;
+    uint32_t M;
+    uint32_t N;
+    uint64_t F;
+    std::vector<unsigned char> vchEncoded;
+
+    uint64_t HashToRange(const Element& element) const;
+    std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
+    //! Whether any of the sorted hashes is in the set.
+    bool MatchInternal(const uint64_t* pelements, size_t nElements) const;
+
+public:
+    CGolombCodedSet();
+    CGolombCodedSet(uint64_t k0In, uint64_t k1In, int PIn, uint32_t MIn, const ElementSet& elements);
+    //! Decode an encoded set. Throws std::ios_base::failure if it is malformed.
+    CGolombCodedSet(uint64_t k0In, uint64_t k1In, int PIn, uint32_t MIn, const std::vector<unsigned char>& vchEncodedIn);
+
+    uint32_t GetN() const { return N; }
+    const std::vector<unsigned char>& GetEncoded() const { return vchEncoded; }
+
+    //! Whether element may be in the set.
+    bool Match(const Element& element) const;
+    //! Whether any of the elements may be in the set. Faster than calling
+    //! Match on each of them.
+    bool MatchAny(const ElementSet& elements) const;
+};
+
+/**
+ * Filter of the transparent scripts of a block: the scripts of its outputs,
+ * other than empty and OP_RETURN scripts, and of the outputs its inputs
+ * spend. A light wallet downloads the block only if the filter matches one
+ * of its scripts. The set is keyed by the block hash, so that false
+ * positives differ from block to block.
+ */
+class CBlockFilter
+{
+private:
+    uint256 hashBlock;
+    CGolombCodedSet filter;
+
+    static CGolombCodedSet::ElementSet GetElements(const CBlock& block, const CBlockUndo& blockundo);
+
+public:
+    CBlockFilter() {}
+    CBlockFilter(const CBlock& block, const CBlockUndo& blockundo);
+    //! Decode an encoded filter. Throws std::ios_base::failure if it is
+    //! malformed.
+    CBlockFilter(const uint256& hashBlockIn, const std::vector<unsigned char>& vchEncoded);
+
+    const uint256& GetBlockHash() const { return hashBlock; }
+    const CGolombCodedSet& GetFilter() const { return filter; }
+    const std::vector<unsigned char>& GetEncoded() const { return filter.GetEncoded(); }
+
+    uint256 GetHash() const;
+    //! Header committing to this filter and, through the header of the
+    //! previous block's filter, to the filters of all earlier blocks.
+    uint256 ComputeHeader(const uint256& hashPrevHeader) const;
+};
+
+/**
+ * What a light wallet needs of a JoinSplit to find and spend its notes: the
+ * nullifiers, to notice its notes being spent, and the commitments, with
+ * enough of the note ciphertexts to trial-decrypt the notes sent to it. The
+ * memos, proofs and signatures are left out.
+ */
+struct CCompactJoinSplit
+{
+    boost::array<uint256, ZC_NUM_JS_INPUTS> nullifiers;
+    boost::array<uint256, ZC_NUM_JS_OUTPUTS> commitments;
+    uint256 ephemeralKey;
+    //! Computed from the random seed, nullifiers and JoinSplit public key
+    //! of the transaction, so that the client does not need them.
+    uint256 h_sig;
+    boost::array<std::vector<unsigned char>, ZC_NUM_JS_OUTPUTS> ciphertextPrefixes;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(nullifiers);
+        READWRITE(commitments);
+        READWRITE(ephemeralKey);
+        READWRITE(h_sig);
+        READWRITE(ciphertextPrefixes);
+    }
+};
+
+/** The JoinSplits of a transaction, and its position in the block. */
+struct CCompactTx
+{
+    uint256 txid;
+    unsigned int index;
+    std::vector<CCompactJoinSplit> vjoinsplit;
+
+    CCompactTx() : index(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(txid);
+        READWRITE(index);
+        READWRITE(vjoinsplit);
+    }
+};
+
+/** The shielded part of a block, stripped down for light wallets. */
+struct CCompactShieldedBlock
+{
+    uint256 hashBlock;
+    uint256 hashPrevBlock;
+    int nHeight;
+    uint32_t nTime;
+    //! The transactions with JoinSplits, in block order.
+    std::vector<CCompactTx> vtx;
+
+    CCompactShieldedBlock() : nHeight(0), nTime(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlock);
+        READWRITE(hashPrevBlock);
+        READWRITE(nHeight);
+        READWRITE(nTime);
+        READWRITE(vtx);
+    }
+};
+
+CCompactShieldedBlock BuildCompactShieldedBlock(const CBlock& block, int nHeight);
+
+#endif // BITCOIN_BLOCKFILTER_H
@@ -6,6 +6,7 @@
 
 #include "primitives/transaction.h"
 #include "hash.h"
+#include "memusage.h"
 #include "script/script.h"
 #include "script/standard.h"
 #include "random.h"
@@ -14,6 +15,8 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include <boost/foreach.hpp>
 
 #define LN2SQUARED 0.4804530139182014246671025263266649717305529515945455
@@ -270,3 +273,66 @@ void CRollingBloomFilter::reset()
     b2.reset(nNewTweak);
     nInsertions = 0;
 }
+
+CBlockedBloomFilter::CBlockedBloomFilter(size_t nElementsIn) :
+    salt(GetRandHash()), nElements(nElementsIn), nInsertions(0)
+{
+    // 16 bits per element, rounded up to whole blocks.
+    size_t nBlocks = std::max<size_t>(1, (nElements * 16 + BLOCK_BITS - 1) / BLOCK_BITS);
+    vData.resize(nBlocks * BLOCK_WORDS);
+}
+
+const uint64_t* CBlockedBloomFilter::GetBlock(uint64_t nHash) const
+{
+    // The top half of the hash picks the block, the bottom half the bits in it.
+    uint64_t nBlocks = vData.size() / BLOCK_WORDS;
+    return &vData[((nHash >> 32) * nBlocks >> 32) * BLOCK_WORDS];
+}
+
+void CBlockedBloomFilter::insert(const uint256& hash)
+{
+    uint64_t nHash = hash.GetHash(salt);
+    uint64_t* block = const_cast<uint64_t*>(GetBlock(nHash));
+    uint32_t nBit = (uint32_t)nHash;
+    uint32_t nStep = (nBit >> 9) | 1;
+    for (unsigned int i = 0; i < BLOCK_HASH_FUNCS; i++) {
+        unsigned int n = nBit % BLOCK_BITS;
+        block[n / 64] |= (uint64_t)1 << (n % 64);
+        nBit += nStep;
+    }
+    nInsertions++;
+}
+
+bool CBlockedBloomFilter::contains(const uint256& hash) const
+{
+    uint64_t nHash = hash.GetHash(salt);
+    const uint64_t* block = GetBlock(nHash);
+    uint32_t nBit = (uint32_t)nHash;
+    uint32_t nStep = (nBit >> 9) | 1;
+    for (unsigned int i = 0; i < BLOCK_HASH_FUNCS; i++) {
+        unsigned int n = nBit % BLOCK_BITS;
+        if (!(block[n / 64] & ((uint64_t)1 << (n % 64))))
+            return false;
+        nBit += nStep;
+    }
+    return true;
+}
+
+void CBlockedBloomFilter::clear()
+{
+    std::fill(vData.begin(), vData.end(), 0);
+    nInsertions = 0;
+}
+
+void CBlockedBloomFilter::swap(CBlockedBloomFilter& other)
+{
+    std::swap(salt, other.salt);
+    std::swap(nElements, other.nElements);
+    std::swap(nInsertions, other.nInsertions);
+    vData.swap(other.vData);
+}
+
+size_t CBlockedBloomFilter::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vData);
+}
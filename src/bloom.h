@@ -6,12 +6,14 @@
 #define BITCOIN_BLOOM_H
 
 #include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
 
 #include <vector>
 
 class COutPoint;
 class CTransaction;
-class uint256;
 
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
@@ -134,5 +136,42 @@ private:
     CBloomFilter b1, b2;
 };
 
+/**
+ * BlockedBloomFilter is a bloom filter over 256-bit hashes in which all the
+ * bits for one key fall in the same 64-byte block, so that a lookup touches a
+ * single cache line. It is sized for nElements keys at about 16 bits per key;
+ * beyond that it keeps working but its false-positive rate rises, which
+ * IsSaturated() reports so the owner can rebuild it larger.
+ *
+ * Keys are hashed with a random salt, and cannot be removed.
+ */
+class CBlockedBloomFilter
+{
+public:
+    explicit CBlockedBloomFilter(size_t nElements);
+
+    void insert(const uint256& hash);
+    bool contains(const uint256& hash) const;
+
+    void clear();
+    void swap(CBlockedBloomFilter& other);
+
+    size_t size() const { return nInsertions; }
+    bool IsSaturated() const { return nInsertions > nElements; }
+    size_t DynamicMemoryUsage() const;
+
+private:
+    static const unsigned int BLOCK_BITS = 512;
+    static const unsigned int BLOCK_WORDS = BLOCK_BITS / 64;
+    static const unsigned int BLOCK_HASH_FUNCS = 8;
+
+    uint256 salt;
+    size_t nElements;
+    size_t nInsertions;
+    std::vector<uint64_t> vData;
+
+    const uint64_t* GetBlock(uint64_t nHash) const;
+};
+
 
 #endif // BITCOIN_BLOOM_H
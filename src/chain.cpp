@@ -5,8 +5,100 @@
 
 #include "chain.h"
 
+#include "main.h"
+#include "txdb.h"
+
+#include <list>
+#include <mutex>
+
+#include <boost/unordered_map.hpp>
+
 using namespace std;
 
+namespace {
+
+/** Number of trimmed solutions kept in memory (about 1.3 KB each on mainnet). */
+const size_t SOLUTION_CACHE_ENTRIES = 1024;
+
+/**
+ * Recently used solutions of trimmed block index entries, so that serving
+ * consecutive headers to peers does not go to disk for every entry.
+ */
+class CSolutionCache
+{
+private:
+    typedef std::list<std::pair<uint256, std::vector<unsigned char> > > list_type;
+    list_type entries;
+    boost::unordered_map<uint256, list_type::iterator, BlockHasher> index;
+    CCriticalSection cs;
+
+public:
+    bool Get(const uint256& hash, std::vector<unsigned char>& solution)
+    {
+        LOCK(cs);
+        auto it = index.find(hash);
+        if (it == index.end())
+            return false;
+        entries.splice(entries.begin(), entries, it->second);
+        solution = it->second->second;
+        return true;
+    }
+
+    void Put(const uint256& hash, std::vector<unsigned char>&& solution)
+    {
+        LOCK(cs);
+        auto it = index.find(hash);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(hash, std::move(solution));
+        index[hash] = entries.begin();
+        if (entries.size() > SOLUTION_CACHE_ENTRIES) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+CSolutionCache solutionCache;
+
+/**
+ * Guards CBlockIndex::nSolution. TrimSolution() clears it under cs_main,
+ * while headers may be read without cs_main, for example to answer REST
+ * and RPC requests.
+ */
+std::mutex cs_solution;
+
+bool ReadSolutionFromDisk(const CBlockIndex* pindex, std::vector<unsigned char>& solution)
+{
+    if (pblocktree) {
+        CDiskBlockIndex dbindex;
+        if (pblocktree->ReadDiskBlockIndex(pindex->GetBlockHash(), dbindex) && !dbindex.nSolution.empty()) {
+            solution.swap(dbindex.nSolution);
+            return true;
+        }
+    }
+    if (pindex->nStatus & BLOCK_HAVE_DATA) {
+        CAutoFile filein(OpenBlockFile(pindex->GetBlockPos(), true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return false;
+        CBlockHeader header;
+        try {
+            filein >> header;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        if (header.GetHash() != pindex->GetBlockHash())
+            return error("%s: header mismatch for %s", __func__, pindex->GetBlockHash().ToString());
+        solution.swap(header.nSolution);
+        return true;
+    }
+    return false;
+}
+
+} // anon namespace
+
 /**
  * CChain implementation
  */
@@ -102,6 +194,55 @@ const CBlockIndex* CBlockIndex::GetAncestor(int height) const
     return const_cast<CBlockIndex*>(this)->GetAncestor(height);
 }
 
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_solution);
+        if (!nSolution.empty() || !phashBlock)
+            return nSolution;
+    }
+
+    std::vector<unsigned char> solution;
+    if (solutionCache.Get(GetBlockHash(), solution))
+        return solution;
+    if (!ReadSolutionFromDisk(this, solution)) {
+        LogPrintf("%s: could not load solution for block %s\n", __func__, GetBlockHash().ToString());
+        return solution;
+    }
+    solutionCache.Put(GetBlockHash(), std::vector<unsigned char>(solution));
+    return solution;
+}
+
+void CBlockIndex::TrimSolution()
+{
+    std::vector<unsigned char> solution;
+    {
+        std::lock_guard<std::mutex> lock(cs_solution);
+        if (nSolution.empty() || !phashBlock)
+            return;
+        solution.swap(nSolution);
+    }
+    // Blocks that were just written are the ones peers are most likely to
+    // ask for next, so keep them in the cache. A reader that misses it in
+    // the meantime finds the solution in the block tree DB.
+    solutionCache.Put(GetBlockHash(), std::move(solution));
+}
+
+CBlockHeader CBlockIndex::GetBlockHeader() const
+{
+    CBlockHeader block;
+    block.nVersion       = nVersion;
+    if (pprev)
+        block.hashPrevBlock = pprev->GetBlockHash();
+    block.hashMerkleRoot = hashMerkleRoot;
+    block.hashReserved   = hashReserved;
+    block.nTime          = nTime;
+    block.nBits          = nBits;
+    block.nNonce         = nNonce;
+    block.nSolution      = GetSolution();
+    return block;
+}
+
 void CBlockIndex::BuildSkip()
 {
     if (pprev)
@@ -96,6 +96,10 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_ACTIVATES_UPGRADE  =   128, //! block activates a network upgrade
+
+    //! Loaded from a snapshot, so only its header was checked; its
+    //! transactions are assumed valid.
+    BLOCK_ASSUMED_VALID      =   256,
 };
 
 //! Short-hand for the highest consensus validity we implement.
@@ -173,6 +177,11 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
+
+    //! The Equihash solution. Once the entry has been written to the block
+    //! tree DB this is trimmed to save memory, and GetSolution() fetches it
+    //! on demand. Use GetSolution() rather than reading this directly: it
+    //! may be trimmed by another thread unless cs_main is held.
     std::vector<unsigned char> nSolution;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
@@ -243,20 +252,16 @@ public:
         return ret;
     }
 
-    CBlockHeader GetBlockHeader() const
-    {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        if (pprev)
-            block.hashPrevBlock = pprev->GetBlockHash();
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.hashReserved   = hashReserved;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
-        return block;
-    }
+    //! Return the Equihash solution, loading it from disk if it has been
+    //! trimmed. Does not need cs_main.
+    std::vector<unsigned char> GetSolution() const;
+
+    //! Drop the resident copy of the solution. Only call this once the
+    //! entry has been written to the block tree DB. cs_main must be held,
+    //! so that code holding it may read nSolution directly.
+    void TrimSolution();
+
+    CBlockHeader GetBlockHeader() const;
 
     uint256 GetBlockHash() const
     {
@@ -335,6 +340,8 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        if (nSolution.empty())
+            nSolution = pindex->GetSolution();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -384,7 +391,7 @@ public:
         }
     }
 
-    uint256 GetBlockHash() const
+    CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
         block.nVersion        = nVersion;
@@ -395,7 +402,12 @@ public:
         block.nBits           = nBits;
         block.nNonce          = nNonce;
         block.nSolution       = nSolution;
-        return block.GetHash();
+        return block;
+    }
+
+    uint256 GetBlockHash() const
+    {
+        return GetBlockHeader().GetHash();
     }
 
 
@@ -467,4 +479,49 @@ public:
     const CBlockIndex *FindFork(const CBlockIndex *pindex) const;
 };
 
+/**
+ * An immutable view of the active chain as of a single tip, for readers that
+ * do not hold cs_main. Block index entries are never freed while running and
+ * their pprev/pskip links are fixed once connected to the tree, so the view
+ * stays valid after the real chain has moved on. Lookups walk the skip list,
+ * which is O(log n) instead of the O(1) vector access CChain offers.
+ */
+class CChainSnapshot {
+private:
+    const CBlockIndex *pindexTip;
+
+public:
+    explicit CChainSnapshot(const CBlockIndex *pindexTipIn = NULL) : pindexTip(pindexTipIn) {}
+
+    /** Returns the index entry for the tip of this chain, or NULL if none. */
+    const CBlockIndex *Tip() const {
+        return pindexTip;
+    }
+
+    /** Return the maximal height in the chain, or -1 if it is empty. */
+    int Height() const {
+        return pindexTip ? pindexTip->nHeight : -1;
+    }
+
+    /** Returns the index entry at a particular height in this chain, or NULL if no such height exists. */
+    const CBlockIndex *operator[](int nHeight) const {
+        if (nHeight < 0 || nHeight > Height())
+            return NULL;
+        return pindexTip->GetAncestor(nHeight);
+    }
+
+    /** Check whether a block is present in this chain. */
+    bool Contains(const CBlockIndex *pindex) const {
+        return (*this)[pindex->nHeight] == pindex;
+    }
+
+    /** Find the successor of a block in this chain, or NULL if the given index is not found or is the tip. */
+    const CBlockIndex *Next(const CBlockIndex *pindex) const {
+        if (Contains(pindex))
+            return (*this)[pindex->nHeight + 1];
+        else
+            return NULL;
+    }
+};
+
 #endif // BITCOIN_CHAIN_H
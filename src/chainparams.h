@@ -32,6 +32,18 @@ struct CCheckpointData {
     double fTransactionsPerDay;
 };
 
+/**
+ * A chainstate snapshot that may be loaded with -loadsnapshot without being
+ * named by -assumesnapshot.
+ */
+struct CSnapshotData {
+    int nHeight;
+    uint256 hashBlock;
+    //! dumptxoutset's hash_snapshot, covering the coins, nullifiers and
+    //! anchors at hashBlock
+    uint256 hashSnapshot;
+};
+
 /**
  * CChainParams defines various tweakable parameters of a given instance of the
  * Bitcoin system. There are three: the main network on which people trade goods
@@ -83,6 +95,7 @@ public:
     const std::vector<unsigned char>& Base58Prefix(Base58Type type) const { return base58Prefixes[type]; }
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
+    const std::vector<CSnapshotData>& Snapshots() const { return vSnapshots; }
     /** Return the founder's reward address and script for a given block height */
     std::string GetFoundersRewardAddressAtHeight(int height) const;
     CScript GetFoundersRewardScriptAtHeight(int height) const;
@@ -113,6 +126,8 @@ protected:
     bool fMineBlocksOnDemand = false;
     bool fTestnetToBeDeprecatedFieldRPC = false;
     CCheckpointData checkpointData;
+    //! None yet for any network; snapshots are named with -assumesnapshot.
+    std::vector<CSnapshotData> vSnapshots;
     std::vector<std::string> vFoundersRewardAddress;
 };
 
@@ -367,6 +367,103 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+bool CCoinsViewCache::Sync(size_t nMaxUsage) {
+    assert(!hasModifier);
+
+    // Entries that have not been modified since the last flush are the least
+    // likely to be needed again, so make room by dropping those first.
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && DynamicMemoryUsage() > nMaxUsage;) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            it++;
+            continue;
+        }
+        cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+        CCoinsMap::iterator itOld = it++;
+        cacheCoins.erase(itOld);
+    }
+    for (CAnchorsMap::iterator it = cacheAnchors.begin(); it != cacheAnchors.end() && DynamicMemoryUsage() > nMaxUsage;) {
+        if (it->second.flags & CAnchorsCacheEntry::DIRTY) {
+            it++;
+            continue;
+        }
+        cachedCoinsUsage -= it->second.tree.DynamicMemoryUsage();
+        CAnchorsMap::iterator itOld = it++;
+        cacheAnchors.erase(itOld);
+    }
+    for (CNullifiersMap::iterator it = cacheNullifiers.begin(); it != cacheNullifiers.end() && DynamicMemoryUsage() > nMaxUsage;) {
+        if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
+            it++;
+            continue;
+        }
+        CNullifiersMap::iterator itOld = it++;
+        cacheNullifiers.erase(itOld);
+    }
+
+    // Collect the modified entries. They are copied while there is room to
+    // keep them, and moved out once there is not.
+    CCoinsMap mapCoins;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            it++;
+            continue;
+        }
+        bool fKeep = !it->second.coins.IsPruned() && DynamicMemoryUsage() <= nMaxUsage;
+        if (!(it->second.flags & CCoinsCacheEntry::FRESH) || !it->second.coins.IsPruned()) {
+            CCoinsCacheEntry& entry = mapCoins[it->first];
+            if (fKeep) {
+                entry.coins = it->second.coins;
+            } else {
+                entry.coins.swap(it->second.coins);
+            }
+            entry.flags = CCoinsCacheEntry::DIRTY | (it->second.flags & CCoinsCacheEntry::FRESH);
+        }
+        if (fKeep) {
+            // The base now has this entry, so it is neither dirty nor fresh.
+            it->second.flags = 0;
+            it++;
+        } else {
+            cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+            CCoinsMap::iterator itOld = it++;
+            cacheCoins.erase(itOld);
+        }
+    }
+
+    CAnchorsMap mapAnchors;
+    for (CAnchorsMap::iterator it = cacheAnchors.begin(); it != cacheAnchors.end();) {
+        if (!(it->second.flags & CAnchorsCacheEntry::DIRTY)) {
+            it++;
+            continue;
+        }
+        mapAnchors[it->first] = it->second;
+        if (it->second.entered && DynamicMemoryUsage() <= nMaxUsage) {
+            it->second.flags = 0;
+            it++;
+        } else {
+            cachedCoinsUsage -= it->second.tree.DynamicMemoryUsage();
+            CAnchorsMap::iterator itOld = it++;
+            cacheAnchors.erase(itOld);
+        }
+    }
+
+    CNullifiersMap mapNullifiers;
+    for (CNullifiersMap::iterator it = cacheNullifiers.begin(); it != cacheNullifiers.end();) {
+        if (!(it->second.flags & CNullifiersCacheEntry::DIRTY)) {
+            it++;
+            continue;
+        }
+        mapNullifiers[it->first] = it->second;
+        if (DynamicMemoryUsage() <= nMaxUsage) {
+            it->second.flags = 0;
+            it++;
+        } else {
+            CNullifiersMap::iterator itOld = it++;
+            cacheNullifiers.erase(itOld);
+        }
+    }
+
+    return base->BatchWrite(mapCoins, hashBlock, hashAnchor, mapAnchors, mapNullifiers);
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
@@ -334,8 +334,9 @@ struct CCoinsStats
     uint64_t nSerializedSize;
     uint256 hashSerialized;
     CAmount nTotalAmount;
+    uint64_t nNullifiers;
 
-    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
+    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0), nNullifiers(0) {}
 };
 
 
@@ -496,6 +497,14 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base like Flush(),
+     * but keep coins, anchor and nullifier entries cached as long as the
+     * cache stays under nMaxUsage bytes. Entries that were not modified since
+     * the last flush are evicted first. The same caveats as for Flush() apply.
+     */
+    bool Sync(size_t nMaxUsage);
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
@@ -0,0 +1,171 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <limits>
+
+namespace {
+
+/** 2^3072 - 1103717 is the modulus, so 2^3072 is congruent to this. */
+const uint32_t MAX_PRIME_DIFF = 1103717;
+
+/** Hash an arbitrary byte string to a 3072-bit number. */
+Num3072 ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char seed[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(seed);
+    unsigned char tmp[Num3072::BYTE_SIZE];
+    for (uint32_t i = 0; i < Num3072::BYTE_SIZE / CSHA256::OUTPUT_SIZE; i++) {
+        unsigned char counter[4];
+        WriteLE32(counter, i);
+        CSHA256().Write(seed, sizeof(seed)).Write(counter, sizeof(counter)).Finalize(tmp + i * CSHA256::OUTPUT_SIZE);
+    }
+    return Num3072(tmp);
+}
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; i++) {
+        limbs[i] = ReadLE32(data + 4 * i);
+    }
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; i++) {
+        limbs[i] = 0;
+    }
+}
+
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= std::numeric_limits<uint32_t>::max() - MAX_PRIME_DIFF)
+        return false;
+    for (int i = 1; i < LIMBS; i++) {
+        if (limbs[i] != std::numeric_limits<uint32_t>::max())
+            return false;
+    }
+    return true;
+}
+
+void Num3072::FullReduce()
+{
+    // Subtracting the modulus is the same as adding MAX_PRIME_DIFF and
+    // dropping the carry out of the top limb.
+    uint64_t c = MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS; i++) {
+        c += limbs[i];
+        limbs[i] = (uint32_t)c;
+        c >>= 32;
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    // Schoolbook multiplication into a double-width product. Each step fits
+    // in 64 bits: (2^32-1)^2 + 2 * (2^32-1) = 2^64-1.
+    uint32_t t[2 * LIMBS] = {0};
+    for (int i = 0; i < LIMBS; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; j < LIMBS; j++) {
+            uint64_t cur = (uint64_t)t[i + j] + (uint64_t)limbs[i] * a.limbs[j] + carry;
+            t[i + j] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        t[i + LIMBS] = (uint32_t)carry;
+    }
+
+    // Fold the high half into the low half, using 2^3072 = MAX_PRIME_DIFF.
+    uint64_t carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        uint64_t cur = (uint64_t)t[i] + (uint64_t)t[i + LIMBS] * MAX_PRIME_DIFF + carry;
+        limbs[i] = (uint32_t)cur;
+        carry = cur >> 32;
+    }
+    // What is left over is small, so folding it in again overflows at most
+    // once more, and only into a value with near-zero low limbs.
+    while (carry) {
+        uint64_t add = carry * MAX_PRIME_DIFF;
+        for (int i = 0; i < LIMBS && add; i++) {
+            add += limbs[i];
+            limbs[i] = (uint32_t)add;
+            add >>= 32;
+        }
+        carry = add;
+    }
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // By Fermat's little theorem the inverse is this^(p - 2). All limbs of
+    // p - 2 are set except the lowest.
+    const uint32_t low = std::numeric_limits<uint32_t>::max() - MAX_PRIME_DIFF - 1;
+    Num3072 result;
+    for (int i = LIMBS - 1; i >= 0; i--) {
+        uint32_t exponent = i == 0 ? low : std::numeric_limits<uint32_t>::max();
+        for (int bit = 31; bit >= 0; bit--) {
+            result.Multiply(result);
+            if ((exponent >> bit) & 1)
+                result.Multiply(*this);
+        }
+    }
+    return result;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    Num3072 reduced(*this);
+    if (reduced.IsOverflow())
+        reduced.FullReduce();
+    for (int i = 0; i < LIMBS; i++) {
+        WriteLE32(out + 4 * i, reduced.limbs[i]);
+    }
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& add)
+{
+    numerator.Multiply(add.numerator);
+    denominator.Multiply(add.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& sub)
+{
+    numerator.Multiply(sub.denominator);
+    denominator.Multiply(sub.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char out[OUTPUT_SIZE]) const
+{
+    Num3072 result(numerator);
+    result.Divide(denominator);
+    unsigned char data[Num3072::BYTE_SIZE];
+    result.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out);
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include "serialize.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** A number modulo 2^3072 - 1103717, the largest 3072-bit safe prime. */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+    static const int LIMBS = 96;
+
+    uint32_t limbs[LIMBS];
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        for (int i = 0; i < LIMBS; i++) {
+            READWRITE(limbs[i]);
+        }
+    }
+
+private:
+    bool IsOverflow() const;
+    void FullReduce();
+};
+
+/**
+ * A multiplicative hash of a set of byte strings (MuHash3072).
+ *
+ * Each element is hashed to a number modulo a 3072-bit prime and the set
+ * hash is the product of those numbers, so the result does not depend on
+ * the order in which elements were added. Removals are kept in a separate
+ * denominator so that an update costs a single multiplication; the one
+ * modular inverse is only computed by Finalize().
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+public:
+    static const size_t OUTPUT_SIZE = 32;
+
+    /** The hash of the empty set. */
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    MuHash3072& operator*=(const MuHash3072& add);
+    MuHash3072& operator/=(const MuHash3072& sub);
+
+    /** Compute the 256-bit hash of the set. */
+    void Finalize(unsigned char out[OUTPUT_SIZE]) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(numerator);
+        READWRITE(denominator);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
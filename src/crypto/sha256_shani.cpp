@@ -0,0 +1,93 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SHA-256 compression using the Intel SHA extensions. The state is kept in
+// the ABEF/CDGH register layout that SHA256RNDS2 expects, and each
+// QuadRound() performs four rounds.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256_shani {
+namespace {
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+/** Perform rounds 4*i .. 4*i+3 on the message words in m. */
+void inline QuadRound(__m128i& abef, __m128i& cdgh, __m128i m, int i)
+{
+    __m128i t = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + 4 * i)));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, t);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(t, 0x0E));
+}
+
+/** Compute the next four message words from the previous sixteen. */
+__m128i inline Next(__m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    return _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)), m3);
+}
+
+__m128i inline Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull));
+}
+
+} // namespace
+
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    // Convert the state from ABCD/EFGH to ABEF/CDGH.
+    __m128i t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);
+    __m128i abef = _mm_alignr_epi8(t, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, t, 0xF0);
+
+    while (blocks--) {
+        __m128i abef_save = abef, cdgh_save = cdgh;
+
+        __m128i m0 = Load(chunk + 0);
+        QuadRound(abef, cdgh, m0, 0);
+        __m128i m1 = Load(chunk + 16);
+        QuadRound(abef, cdgh, m1, 1);
+        __m128i m2 = Load(chunk + 32);
+        QuadRound(abef, cdgh, m2, 2);
+        __m128i m3 = Load(chunk + 48);
+        QuadRound(abef, cdgh, m3, 3);
+        for (int i = 4; i < 16; i += 4) {
+            m0 = Next(m0, m1, m2, m3);
+            QuadRound(abef, cdgh, m0, i + 0);
+            m1 = Next(m1, m2, m3, m0);
+            QuadRound(abef, cdgh, m1, i + 1);
+            m2 = Next(m2, m3, m0, m1);
+            QuadRound(abef, cdgh, m2, i + 2);
+            m3 = Next(m3, m0, m1, m2);
+            QuadRound(abef, cdgh, m3, i + 3);
+        }
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+        chunk += 64;
+    }
+
+    // Convert back to ABCD/EFGH.
+    t = _mm_shuffle_epi32(abef, 0x1B);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(t, cdgh, 0xF0));
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(cdgh, t, 8));
+}
+
+} // namespace sha256_shani
+
+#endif
@@ -0,0 +1,350 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CUCKOOCACHE_H
+#define BITCOIN_CUCKOOCACHE_H
+
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+
+/** What a check backed by a CSaltedCuckooCache does with the cache. */
+enum CacheMode
+{
+    //! Use a cached result, and cache the result of a check that passes
+    CACHE_STORE,
+    //! Use a cached result and drop it, as the check will not recur
+    CACHE_ERASE,
+    //! Use a cached result, but leave the cache as it is
+    CACHE_LOOKUP,
+};
+
+/** Counters of a CCuckooCache. */
+struct CCuckooCacheStats
+{
+    //! Memory taken by the table
+    size_t nBytes;
+    //! Number of entries the table can hold
+    size_t nSlots;
+    uint64_t nHits;
+    uint64_t nMisses;
+    //! Entries dropped to make room for newer ones
+    uint64_t nEvictions;
+
+    CCuckooCacheStats() : nBytes(0), nSlots(0), nHits(0), nMisses(0), nEvictions(0) {}
+};
+
+/**
+ * Fixed-size set of 256-bit keys, for remembering the result of expensive
+ * checks across threads without locks. Keys must be uniformly distributed
+ * and unpredictable to peers, such as hashes with a secret salt.
+ *
+ * Each key has two buckets of two slots. A bucket is a 64-byte cache line,
+ * so a lookup reads at most two lines. An insert takes a free or stale slot
+ * in either bucket, or else moves the oldest entry there to its other bucket,
+ * cuckoo style, for a few steps before evicting one.
+ *
+ * Entries are stamped with a generation, which advances each time a quarter
+ * of the slots have been filled. Entries two generations old are stale and
+ * are overwritten first, so recent entries are kept without ever scanning
+ * the table.
+ *
+ * Readers never wait. Each slot has a sequence number that is odd while the
+ * slot is written; a reader that sees it odd or changed treats the lookup as
+ * a miss. Writers take a slot by making its sequence number odd, and give up
+ * if another writer has it, which at worst loses a cache entry. Slots keep
+ * 192 bits of the key, so salted keys do not match by chance.
+ *
+ * The table is split by key into shards, each with its own generation and
+ * counters, so that threads do not all contend on the same counters.
+ */
+class CCuckooCache
+{
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> nSequence;
+        //! 0 if the slot is free
+        std::atomic<uint32_t> nGeneration;
+        std::atomic<uint64_t> key[3];
+
+        Slot() : nSequence(0), nGeneration(0) {
+            for (int i = 0; i < 3; i++)
+                key[i].store(0, std::memory_order_relaxed);
+        }
+    };
+
+    static const size_t CACHE_LINE_SIZE = 64;
+    static const size_t SLOTS_PER_BUCKET = 2;
+    static_assert(sizeof(Slot) * SLOTS_PER_BUCKET == CACHE_LINE_SIZE, "a bucket must fill a cache line");
+    static const size_t MAX_SHARDS = 16;
+    //! Shards are only split off while each keeps this many buckets
+    static const size_t MIN_SHARD_BUCKETS = 1024;
+    //! Number of entries an insert may move before evicting one
+    static const int MAX_KICKS = 8;
+
+    struct Shard
+    {
+        Slot* slots;
+        std::atomic<uint32_t> nGeneration;
+        std::atomic<uint32_t> nGenerationInserts;
+        std::atomic<uint64_t> nHits;
+        std::atomic<uint64_t> nMisses;
+        std::atomic<uint64_t> nEvictions;
+        //! Keeps the counters of neighbouring shards off each other's cache
+        //! lines.
+        char padding[CACHE_LINE_SIZE];
+
+        Shard() : slots(NULL), nGeneration(1), nGenerationInserts(0), nHits(0), nMisses(0), nEvictions(0) {}
+    };
+
+    std::unique_ptr<unsigned char[]> buffer;
+    std::unique_ptr<Shard[]> shards;
+    size_t nShards;
+    size_t nBucketsPerShard;
+    uint32_t nGenerationSize;
+
+    static void GetKeyWords(const uint256& key, uint64_t words[4])
+    {
+        for (int i = 0; i < 4; i++)
+            words[i] = ReadLE64(key.begin() + 8 * i);
+    }
+
+    Shard& GetShard(const uint64_t words[4]) const
+    {
+        return shards[words[3] & (nShards - 1)];
+    }
+
+    size_t GetBucket(uint64_t word) const
+    {
+        return MapIntoRange(word, nBucketsPerShard);
+    }
+
+    //! Copy a slot. Returns false if it is being written.
+    static bool ReadSlot(const Slot& slot, uint32_t& nSequence, uint32_t& nGeneration, uint64_t key[3])
+    {
+        nSequence = slot.nSequence.load(std::memory_order_acquire);
+        if (nSequence & 1)
+            return false;
+        nGeneration = slot.nGeneration.load(std::memory_order_relaxed);
+        for (int i = 0; i < 3; i++)
+            key[i] = slot.key[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.nSequence.load(std::memory_order_relaxed) == nSequence;
+    }
+
+    //! Take a slot for writing, if it has not changed since it was read with
+    //! sequence number nSequence.
+    static bool LockSlot(Slot& slot, uint32_t nSequence)
+    {
+        if (!slot.nSequence.compare_exchange_strong(nSequence, nSequence + 1, std::memory_order_acquire))
+            return false;
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    static void WriteSlot(Slot& slot, uint32_t nSequence, uint32_t nGeneration, const uint64_t key[3])
+    {
+        slot.nGeneration.store(nGeneration, std::memory_order_relaxed);
+        for (int i = 0; i < 3; i++)
+            slot.key[i].store(key[i], std::memory_order_relaxed);
+        slot.nSequence.store(nSequence + 2, std::memory_order_release);
+    }
+
+public:
+    //! A cache taking about nBytes of memory; 0 disables it.
+    explicit CCuckooCache(size_t nBytes) : nShards(0), nBucketsPerShard(0), nGenerationSize(0)
+    {
+        size_t nBuckets = nBytes / CACHE_LINE_SIZE;
+        if (nBuckets == 0)
+            return;
+        nShards = MAX_SHARDS;
+        while (nShards > 1 && nBuckets / nShards < MIN_SHARD_BUCKETS)
+            nShards /= 2;
+        nBucketsPerShard = nBuckets / nShards;
+        size_t nSlotsPerShard = nBucketsPerShard * SLOTS_PER_BUCKET;
+        nGenerationSize = std::max<size_t>(1, nSlotsPerShard / 4);
+
+        // One allocation for all shards, aligned to a cache line.
+        size_t nSlots = nSlotsPerShard * nShards;
+        buffer.reset(new unsigned char[nSlots * sizeof(Slot) + CACHE_LINE_SIZE]);
+        uintptr_t nAddress = reinterpret_cast<uintptr_t>(buffer.get());
+        Slot* slots = reinterpret_cast<Slot*>((nAddress + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+        for (size_t i = 0; i < nSlots; i++)
+            new (&slots[i]) Slot();
+
+        shards.reset(new Shard[nShards]);
+        for (size_t i = 0; i < nShards; i++)
+            shards[i].slots = slots + i * nSlotsPerShard;
+    }
+
+    /**
+     * Whether key is in the cache. If fErase is set and it is, the entry is
+     * dropped, freeing its slot for another key.
+     */
+    bool Contains(const uint256& key, bool fErase)
+    {
+        if (nShards == 0)
+            return false;
+        uint64_t words[4];
+        GetKeyWords(key, words);
+        Shard& shard = GetShard(words);
+        size_t vBuckets[2] = {GetBucket(words[0]), GetBucket(words[1])};
+        for (int b = 0; b < 2; b++) {
+            for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+                Slot& slot = shard.slots[vBuckets[b] * SLOTS_PER_BUCKET + i];
+                uint32_t nSequence, nGeneration;
+                uint64_t slotKey[3];
+                if (!ReadSlot(slot, nSequence, nGeneration, slotKey) || nGeneration == 0 ||
+                    slotKey[0] != words[0] || slotKey[1] != words[1] || slotKey[2] != words[2])
+                    continue;
+                if (fErase && LockSlot(slot, nSequence))
+                    WriteSlot(slot, nSequence, 0, slotKey);
+                shard.nHits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        shard.nMisses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    //! Add key to the cache, which may evict an older entry.
+    void Insert(const uint256& key)
+    {
+        if (nShards == 0)
+            return;
+        uint64_t words[4];
+        GetKeyWords(key, words);
+        Shard& shard = GetShard(words);
+        const uint32_t nCurrentGeneration = shard.nGeneration.load(std::memory_order_relaxed);
+
+        uint64_t entryKey[3] = {words[0], words[1], words[2]};
+        uint32_t nEntryGeneration = nCurrentGeneration;
+        //! Bucket the entry was moved out of, which it must not go back to
+        size_t nFromBucket = nBucketsPerShard;
+        for (int nKicks = 0; nKicks <= MAX_KICKS; nKicks++) {
+            size_t vBuckets[2] = {GetBucket(entryKey[0]), GetBucket(entryKey[1])};
+
+            // Take a free or stale slot, or else the one with the oldest entry.
+            Slot* pslot = NULL;
+            uint32_t nSlotSequence = 0, nSlotGeneration = 0;
+            uint64_t slotKey[3];
+            size_t nSlotBucket = 0;
+            bool fFree = false;
+            for (int b = 0; b < 2 && !fFree; b++) {
+                if (vBuckets[b] == nFromBucket)
+                    continue;
+                for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+                    Slot& slot = shard.slots[vBuckets[b] * SLOTS_PER_BUCKET + i];
+                    uint32_t nSequence, nGeneration;
+                    uint64_t key[3];
+                    if (!ReadSlot(slot, nSequence, nGeneration, key))
+                        continue;
+                    fFree = nGeneration == 0 || nGeneration + 2 <= nCurrentGeneration;
+                    if (fFree || !pslot || nGeneration < nSlotGeneration) {
+                        pslot = &slot;
+                        nSlotSequence = nSequence;
+                        nSlotGeneration = nGeneration;
+                        nSlotBucket = vBuckets[b];
+                        for (int j = 0; j < 3; j++)
+                            slotKey[j] = key[j];
+                    }
+                    if (fFree)
+                        break;
+                }
+            }
+            if (!pslot || !LockSlot(*pslot, nSlotSequence)) {
+                // The entry moved out of its slot, if any, is lost.
+                if (nKicks > 0)
+                    shard.nEvictions.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            WriteSlot(*pslot, nSlotSequence, nEntryGeneration, entryKey);
+
+            if (nKicks == 0 &&
+                shard.nGenerationInserts.fetch_add(1, std::memory_order_relaxed) + 1 == nGenerationSize) {
+                shard.nGenerationInserts.store(0, std::memory_order_relaxed);
+                shard.nGeneration.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (fFree)
+                return;
+
+            // Move the displaced entry to its other bucket.
+            for (int j = 0; j < 3; j++)
+                entryKey[j] = slotKey[j];
+            nEntryGeneration = nSlotGeneration;
+            nFromBucket = nSlotBucket;
+        }
+        shard.nEvictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    CCuckooCacheStats GetStats() const
+    {
+        CCuckooCacheStats stats;
+        stats.nSlots = nShards * nBucketsPerShard * SLOTS_PER_BUCKET;
+        stats.nBytes = stats.nSlots * sizeof(Slot);
+        for (size_t i = 0; i < nShards; i++) {
+            stats.nHits += shards[i].nHits.load(std::memory_order_relaxed);
+            stats.nMisses += shards[i].nMisses.load(std::memory_order_relaxed);
+            stats.nEvictions += shards[i].nEvictions.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+};
+
+/**
+ * CCuckooCache of checks that have passed, keyed by a hash of what was
+ * checked with a random salt, so that peers cannot aim collisions or
+ * evictions at particular entries.
+ */
+class CSaltedCuckooCache
+{
+private:
+    //! SHA256 state after the salt, which is one full block
+    CSHA256 saltedHasher;
+    CCuckooCache cache;
+
+public:
+    explicit CSaltedCuckooCache(size_t nBytes) : cache(nBytes)
+    {
+        uint256 nonce = GetRandHash();
+        saltedHasher.Write(nonce.begin(), 32);
+        saltedHasher.Write(nonce.begin(), 32);
+    }
+
+    //! A hasher to write what is checked to, and finalize into the entry
+    CSHA256 SaltedHasher() const
+    {
+        return saltedHasher;
+    }
+
+    //! Whether entry has passed, dropping it if mode is CACHE_ERASE
+    bool Get(const uint256& entry, CacheMode mode)
+    {
+        return cache.Contains(entry, mode == CACHE_ERASE);
+    }
+
+    //! Remember that entry passed, if mode is CACHE_STORE
+    void Set(const uint256& entry, CacheMode mode)
+    {
+        if (mode == CACHE_STORE)
+            cache.Insert(entry);
+    }
+
+    CCuckooCacheStats GetStats() const
+    {
+        return cache.GetStats();
+    }
+};
+
+#endif // BITCOIN_CUCKOOCACHE_H
@@ -15,6 +15,8 @@
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
+/** Size of the pieces large JSON-RPC replies are streamed in */
+static const size_t JSONRPC_REPLY_CHUNK_SIZE = 64 * 1024;
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wellet.
@@ -75,6 +77,27 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/** JSONStreamWriter sink for a successful JSON-RPC reply. A reply that fits in
+ * one chunk is sent as a normal response; anything larger is streamed while
+ * it is still being serialized.
+ */
+static bool JSONReplySink(HTTPRequest* req, bool& fStreaming, const std::string& strChunk, bool fFinal)
+{
+    if (!fStreaming) {
+        req->WriteHeader("Content-Type", "application/json");
+        if (fFinal) {
+            req->WriteReply(HTTP_OK, strChunk);
+            return true;
+        }
+        req->StartChunkedReply(HTTP_OK);
+        fStreaming = true;
+    }
+    bool fOk = strChunk.empty() || req->WriteReplyChunk(strChunk);
+    if (fFinal)
+        req->EndChunkedReply();
+    return fOk;
+}
+
 static bool RPCAuthorized(const std::string& strAuth)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -122,7 +145,11 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (!valRequest.read(req->ReadBody()))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
-        std::string strReply;
+        bool fStreaming = false;
+        JSONStreamWriter writer(JSONRPC_REPLY_CHUNK_SIZE,
+            [req, &fStreaming](const std::string& strChunk, bool fFinal) {
+                return JSONReplySink(req, fStreaming, strChunk, fFinal);
+            });
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -130,16 +157,16 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            JSONRPCReplyStream(writer, result, NullUniValue, jreq.id);
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            writer.Write(JSONRPCExecBatch(valRequest.get_array()));
+            writer.WriteRaw("\n");
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        writer.Finish();
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -535,13 +535,70 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** Reply bytes a streamed reply may have queued but not yet written to the
+ * client before the worker thread waits for it to catch up. */
+static const size_t MAX_HTTP_REPLY_IN_FLIGHT = 4 * 1024 * 1024;
+
+/** Flow control state of a streamed reply. */
+struct HTTPChunkedReply
+{
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    //! Bytes handed over by the worker thread
+    size_t nQueued;
+    //! Bytes handed to libevent, on the event thread
+    size_t nSent;
+    //! Bytes known to be written to the connection
+    size_t nWritten;
+    //! Seconds to wait for progress before giving up on the client
+    int64_t nTimeout;
+    bool fAbandoned;
+
+    explicit HTTPChunkedReply(int64_t nTimeoutIn) :
+        nQueued(0), nSent(0), nWritten(0), nTimeout(nTimeoutIn), fAbandoned(false) {}
+};
+
+/** Called by libevent once the connection's output buffer has drained. */
+static void http_reply_chunk_written(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    boost::unique_lock<boost::mutex> lock(reply->cs);
+    reply->nWritten = reply->nSent;
+    reply->cond.notify_all();
+}
+
+static void http_send_reply_chunk(struct evhttp_request* req, struct evbuffer* evb, std::shared_ptr<HTTPChunkedReply> reply)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(reply->cs);
+        reply->nSent += evbuffer_get_length(evb);
+    }
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+    evhttp_send_reply_chunk_with_cb(req, evb, http_reply_chunk_written, reply.get());
+#else
+    // No completion callback: count the chunk as written straight away
+    evhttp_send_reply_chunk(req, evb);
+    http_reply_chunk_written(NULL, reply.get());
+#endif
+    evbuffer_free(evb);
+}
+
+static void http_send_reply_end(struct evhttp_request* req, std::shared_ptr<HTTPChunkedReply> reply)
+{
+    evhttp_send_reply_end(req);
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
                                                        replySent(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (!replySent && chunkedReply) {
+        // A streamed reply can't be turned into an error any more; just end it
+        LogPrintf("%s: Unfinished streamed reply\n", __func__);
+        EndChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -606,6 +663,53 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && req && !chunkedReply);
+    chunkedReply = std::make_shared<HTTPChunkedReply>(GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(evhttp_send_reply_start, req, nStatus, (const char*)NULL));
+    ev->trigger(0);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(!replySent && req && chunkedReply);
+    {
+        // Wait for the client to catch up before queueing more
+        boost::unique_lock<boost::mutex> lock(chunkedReply->cs);
+        while (!chunkedReply->fAbandoned &&
+               chunkedReply->nQueued - chunkedReply->nWritten > MAX_HTTP_REPLY_IN_FLIGHT) {
+            if (!chunkedReply->cond.timed_wait(lock, boost::posix_time::seconds(chunkedReply->nTimeout))) {
+                LogPrint("http", "Abandoning streamed reply to %s: client stopped reading\n", GetPeer().ToString());
+                chunkedReply->fAbandoned = true;
+            }
+        }
+        if (chunkedReply->fAbandoned)
+            return false;
+        chunkedReply->nQueued += strChunk.size();
+    }
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(http_send_reply_chunk, req, evb, chunkedReply));
+    ev->trigger(0);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(!replySent && req && chunkedReply);
+    // Binding chunkedReply keeps it alive until libevent has dropped the
+    // write callback that points to it.
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(http_send_reply_end, req, chunkedReply));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
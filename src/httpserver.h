@@ -5,6 +5,7 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <memory>
 #include <string>
 #include <stdint.h>
 #include <boost/thread.hpp>
@@ -19,6 +20,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -56,6 +58,8 @@ class HTTPRequest
 {
 private:
     struct evhttp_request* req;
+    /** Flow control for a streamed reply in progress, shared with the event thread. */
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
 
     // For test access
 protected:
@@ -115,6 +119,29 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a streamed HTTP reply with status nStatus. Send the body with
+     * WriteReplyChunk and complete it with EndChunkedReply; HTTP/1.1 clients
+     * receive it with chunked transfer encoding.
+     *
+     * @note Use either this or WriteReply, not both. Call WriteHeader first.
+     */
+    virtual void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next piece of a streamed reply. Blocks while too much earlier
+     * output is still waiting to be written to the client, so a slow reader
+     * cannot make us buffer the whole reply. Returns false once the client has
+     * stopped reading; the rest of the body may then be skipped.
+     */
+    virtual bool WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Finish a streamed reply. As with WriteReply, this gives the request
+     * back to the main thread.
+     */
+    virtual void EndChunkedReply();
 };
 
 /** Event handler closure.
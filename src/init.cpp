@@ -9,8 +9,10 @@
 
 #include "init.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "addrman.h"
 #include "amount.h"
+#include "asyncrpcqueue.h"
 #ifdef ENABLE_MINING
 #include "base58.h"
 #endif
@@ -20,6 +22,7 @@
 #include "consensus/validation.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "joinsplitcache.h"
 #include "key.h"
 #include "main.h"
 #include "metrics.h"
@@ -28,6 +31,7 @@
 #include "rpcserver.h"
 #include "script/standard.h"
 #include "scheduler.h"
+#include "snapshot.h"
 #include "txdb.h"
 #include "torcontrol.h"
 #include "ui_interface.h"
@@ -162,7 +166,6 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -226,14 +229,24 @@ void Shutdown()
         if (pcoinsTip != NULL) {
             FlushStateToDisk();
         }
+    }
+    // Nothing else will be validated; let the wallet process what it has
+    // been sent, including the SetBestChain of the flush above.
+    SyncWithValidationInterfaceQueue();
+    {
+        LOCK(cs_main);
         delete pcoinsTip;
         pcoinsTip = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
+        delete pcoinsWriter;
+        pcoinsWriter = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
         delete pblocktree;
         pblocktree = NULL;
+        delete pblockfilterdb;
+        pblockfilterdb = NULL;
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -325,6 +338,12 @@ void OnRPCPreCommand(const CRPCCommand& cmd)
     if (strWarning != "" && !GetBoolArg("-disablesafemode", false) &&
         !cmd.okSafeMode)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, string("Safe mode: ") + strWarning);
+#ifdef ENABLE_WALLET
+    // The wallet processes blocks and transactions on its own thread; make
+    // sure it has caught up with everything validated before the call.
+    if (pwalletMain && (cmd.category == "wallet" || cmd.name == "getinfo"))
+        SyncWithValidationInterfaceQueue();
+#endif
 }
 
 std::string HelpMessage(HelpMessageMode mode)
@@ -336,8 +355,11 @@ std::string HelpMessage(HelpMessageMode mode)
 
     string strUsage = HelpMessageGroup(_("Options:"));
     strUsage += HelpMessageOpt("-?", _("This help message"));
+    strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain an index of transparent addresses, used by the getaddressutxos, getaddresstxids and getaddressbalance rpc calls (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-backgroundflush", strprintf(_("Write the in-memory UTXO set to disk from a background thread, keeping recently used entries cached (default: %u)"), DEFAULT_BACKGROUND_FLUSH));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain an index of compact block filters and shielded block data for light wallets, used by the getblockfilter and getcompactshieldedblock rpc calls and the REST interface (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
@@ -354,6 +376,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-loadsnapshot=<file>", _("Start a new node from a chainstate snapshot written by dumptxoutset, instead of validating the chain up to it (requires -prune, and the snapshot must be named by -assumesnapshot)"));
+    strUsage += HelpMessageOpt("-assumesnapshot=<height>:<hash>:<snapshothash>", _("Trust a snapshot of the block with this height and hash whose hash_snapshot from dumptxoutset is <snapshothash>; only name snapshots you have checked against a node you trust (can be specified multiple times)"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
@@ -365,9 +389,11 @@ std::string HelpMessage(HelpMessageMode mode)
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
+    strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain an index of spent transparent outputs, used by the getspentinfo rpc call (default: %u)"), DEFAULT_SPENTINDEX));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
+    strUsage += HelpMessageOpt("-txoutsetstats", strprintf(_("Keep running UTXO set statistics so that gettxoutsetinfo answers without scanning the coin database, at the cost of a database read for each changed coin on every flush (default: %u)"), DEFAULT_TXOUTSET_STATS));
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
@@ -422,6 +448,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
         " " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)"));
+    strUsage += HelpMessageOpt("-zproverthreads=<n>", strprintf(_("Number of JoinSplit proofs of one z_sendmany operation to generate in parallel; each needs about 1 GB of memory (default: %u)"), DEFAULT_JOINSPLIT_PROVER_THREADS));
 #endif
 
 #if ENABLE_ZMQ
@@ -430,6 +457,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqqueuepolicy=<policy>", _("What to do with notifications when the queue is full: \"drop\" them (default) or \"block\" validation until there is room"));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf(_("Maximum size of the notifications waiting to be published in MiB (default: %u)"), DEFAULT_NOTIFICATION_QUEUE_SIZE));
 #endif
 
 #if ENABLE_PROTON
@@ -438,6 +467,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-amqpqueuepolicy=<policy>", _("What to do with notifications when the queue is full: \"drop\" them (default) or \"block\" validation until there is room"));
+    strUsage += HelpMessageOpt("-amqpqueuesize=<n>", strprintf(_("Maximum size of the notifications waiting to be published in MiB (default: %u)"), DEFAULT_NOTIFICATION_QUEUE_SIZE));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -465,7 +496,9 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries (default: %u)", 50000));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> megabytes, at most %u (default: %u)", MAX_MAX_SIG_CACHE_SIZE, DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxsighashcachesize=<n>", strprintf("Limit size of the per-transaction signature hash cache to <n> megabytes (default: %u)", DEFAULT_MAX_SIGHASH_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxjoinsplitcachesize=<n>", strprintf("Limit size of the cache of verified JoinSplit proofs to <n> megabytes, at most %u (default: %u)", MAX_MAX_JOINSPLIT_CACHE_SIZE, DEFAULT_MAX_JOINSPLIT_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying (default: %s)"),
         CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -516,6 +549,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 8232, 18232));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchconcurrency=<n>", strprintf(_("Set the maximum number of calls from one JSON-RPC batch request to run in parallel; batches with any call that is not read-only always run one call at a time, in order (default: %d)"), DEFAULT_RPC_BATCH_CONCURRENCY));
+    strUsage += HelpMessageOpt("-zoperationhistory=<n>", strprintf(_("Keep the results of up to <n> finished async operations, such as z_sendmany, until they are fetched (default: %u)"), DEFAULT_ASYNC_RPC_OPERATION_HISTORY));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
@@ -873,6 +908,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetArg("-prune", 0)) {
         if (GetBoolArg("-txindex", false))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex and -spentindex."));
+        if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
 #ifdef ENABLE_WALLET
         if (!GetBoolArg("-disablewallet", false)) {
             if (SoftSetBoolArg("-disablewallet", true))
@@ -883,6 +922,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif
     }
 
+    // a node started from a snapshot has no blocks below it, just like a pruned node
+    if (mapArgs.count("-loadsnapshot")) {
+        if (!GetArg("-prune", 0))
+            return InitError(_("-loadsnapshot requires -prune."));
+        if (GetBoolArg("-reindex", false))
+            return InitError(_("-loadsnapshot is incompatible with -reindex."));
+    }
+
     // ********************************************************* Step 3: parameter-to-internal-flags
 
     fDebug = !mapMultiArgs["-debug"].empty();
@@ -943,6 +990,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         fPruneMode = true;
     }
 
+    // -maxsigcachesize used to count entries (default 50000); it is now in
+    // megabytes, so refuse the old-style values rather than allocate gigabytes
+    if (GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) > MAX_MAX_SIG_CACHE_SIZE) {
+        return InitError(strprintf(_("-maxsigcachesize is now given in megabytes, not entries; it must be at most %d (default: %d)."),
+            MAX_MAX_SIG_CACHE_SIZE, DEFAULT_MAX_SIG_CACHE_SIZE));
+    }
+    if (GetArg("-maxjoinsplitcachesize", DEFAULT_MAX_JOINSPLIT_CACHE_SIZE) > MAX_MAX_JOINSPLIT_CACHE_SIZE) {
+        return InitError(strprintf(_("-maxjoinsplitcachesize must be at most %d megabytes (default: %d)."),
+            MAX_MAX_JOINSPLIT_CACHE_SIZE, DEFAULT_MAX_JOINSPLIT_CACHE_SIZE));
+    }
+
 #ifdef ENABLE_WALLET
     bool fDisableWallet = GetBoolArg("-disablewallet", false);
 #endif
@@ -1079,6 +1137,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    // Select the fastest SHA-256 implementation for this CPU
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1127,6 +1189,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
     std::ostringstream strErrors;
 
+    InitSignatureCache();
+    InitJoinSplitCache();
+
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
@@ -1296,6 +1361,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         AddOneShot(strDest);
 
 #if ENABLE_ZMQ
+    NotificationQueuePolicy zmqQueuePolicy;
+    if (mapArgs.count("-zmqqueuepolicy") && !ParseNotificationQueuePolicy(mapArgs["-zmqqueuepolicy"], zmqQueuePolicy))
+        return InitError(strprintf(_("Unknown -zmqqueuepolicy: '%s'"), mapArgs["-zmqqueuepolicy"]));
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
     if (pzmqNotificationInterface) {
@@ -1304,6 +1372,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif
 
 #if ENABLE_PROTON
+    NotificationQueuePolicy amqpQueuePolicy;
+    if (mapArgs.count("-amqpqueuepolicy") && !ParseNotificationQueuePolicy(mapArgs["-amqpqueuepolicy"], amqpQueuePolicy))
+        return InitError(strprintf(_("Unknown -amqpqueuepolicy: '%s'"), mapArgs["-amqpqueuepolicy"]));
     pAMQPNotificationInterface = AMQPNotificationInterface::CreateWithArguments(mapArgs);
 
     if (pAMQPNotificationInterface) {
@@ -1357,11 +1428,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nBlockTreeDBCache > (1 << 21) && !GetBoolArg("-txindex", false))
         nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nBlockFilterDBCache = 0;
+    if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+        nBlockFilterDBCache = std::min(nTotalCache / 8, (int64_t)(1 << 24)); // filters are served to light wallets; up to 16 MiB
+    nTotalCache -= nBlockFilterDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nBlockFilterDBCache > 0)
+        LogPrintf("* Using %.1fMiB for block filter index database\n", nBlockFilterDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
@@ -1377,15 +1454,41 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
+                delete pcoinsWriter;
+                pcoinsWriter = NULL;
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
+                delete pblockfilterdb;
+                pblockfilterdb = NULL;
+                fBlockFilterIndex = false;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
+                if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+                    pblockfilterdb = new CBlockFilterDB(nBlockFilterDBCache, false, fReindex);
+                    fBlockFilterIndex = true;
+                }
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                if (GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH)) {
+                    pcoinsWriter = new CCoinsViewBackgroundWriter(pcoinsdbview);
+                    pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsWriter);
+                } else {
+                    pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                }
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                // Only an empty chainstate is loaded from a snapshot; once
+                // the load has completed the option has no effect.
+                if (mapArgs.count("-loadsnapshot") && !fReindex && pcoinsdbview->GetBestBlock().IsNull()) {
+                    uiInterface.InitMessage(_("Loading snapshot..."));
+                    boost::filesystem::path pathSnapshot = boost::filesystem::absolute(GetArg("-loadsnapshot", ""), GetDataDir());
+                    std::string strError;
+                    if (!LoadSnapshot(pathSnapshot, pblocktree, pcoinsdbview, strError)) {
+                        strLoadError = strError;
+                        break;
+                    }
+                }
+
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
                     //If we're reindexing in prune mode, wipe away unusable block files and all undo data files
@@ -1415,6 +1518,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // The address indexes can be built later on, but not dropped
+                if ((fAddressIndex && !GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) ||
+                    (fSpentIndex && !GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))) {
+                    strLoadError = _("You need to rebuild the database using -reindex to disable -addressindex or -spentindex");
+                    break;
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1440,6 +1550,24 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     strLoadError = _("Corrupted block database detected");
                     break;
                 }
+
+                bool fBuildAddressIndex = !fAddressIndex && GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+                bool fBuildSpentIndex = !fSpentIndex && GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+                if (fBuildAddressIndex || fBuildSpentIndex) {
+                    uiInterface.InitMessage(_("Building address indexes..."));
+                    if (!BuildAddressIndexes(fBuildAddressIndex, fBuildSpentIndex)) {
+                        strLoadError = _("Error building address indexes");
+                        break;
+                    }
+                }
+
+                if (fBlockFilterIndex) {
+                    uiInterface.InitMessage(_("Building block filter index..."));
+                    if (!BuildBlockFilterIndex()) {
+                        strLoadError = _("Error building block filter index");
+                        break;
+                    }
+                }
             } catch (const std::exception& e) {
                 if (fDebug) LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
@@ -1571,7 +1699,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf("%s", strErrors.str());
         LogPrintf(" wallet      %15dms\n", GetTimeMillis() - nStart);
 
-        RegisterValidationInterface(pwalletMain);
+        RegisterValidationInterface(pwalletMain, true);
 
         CBlockIndex *pindexRescan = chainActive.Tip();
         if (GetBoolArg("-rescan", false))
@@ -1741,6 +1869,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         // Add wallet transactions that aren't already in a block to mapTransactions
         pwalletMain->ReacceptWalletTransactions();
 
+        // Queue the z_sendmany and z_shieldcoinbase operations left unfinished by the last run
+        ResumeAsyncRPCOperations();
+
         // Run a thread to flush wallet periodically
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
     }
@@ -0,0 +1,88 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "joinsplitcache.h"
+
+#include "cuckoocache.h"
+#include "primitives/transaction.h"
+#include "streams.h"
+#include "util.h"
+#include "version.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+/**
+ * Cache of JoinSplit proofs that have verified, so that a shielded
+ * transaction checked when it enters the mempool does not have its proofs
+ * checked again when its block is connected.
+ */
+class CJoinSplitCache : public CSaltedCuckooCache
+{
+public:
+    explicit CJoinSplitCache(size_t nBytes) : CSaltedCuckooCache(nBytes) {}
+
+    uint256 ComputeEntry(const JSDescription& joinsplit, const uint256& joinSplitPubKey) const
+    {
+        // The public inputs of the proof, from which h_sig and the primary
+        // input are derived, and the proof itself. The note ciphertexts are
+        // not covered by the proof, so are left out.
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << joinSplitPubKey;
+        ss << joinsplit.anchor;
+        ss << joinsplit.nullifiers;
+        ss << joinsplit.commitments;
+        ss << joinsplit.randomSeed;
+        ss << joinsplit.macs;
+        ss << joinsplit.vpub_old;
+        ss << joinsplit.vpub_new;
+        ss << joinsplit.proof;
+
+        uint256 entry;
+        SaltedHasher().Write((const unsigned char*)&ss[0], ss.size()).Finalize(entry.begin());
+        return entry;
+    }
+};
+
+//! Set up once at startup, before any transaction is checked
+std::unique_ptr<CJoinSplitCache> joinSplitCache;
+
+}
+
+void InitJoinSplitCache()
+{
+    // -maxjoinsplitcachesize is in MiB.
+    int64_t nMaxSize = std::min(std::max((int64_t)0, GetArg("-maxjoinsplitcachesize", DEFAULT_MAX_JOINSPLIT_CACHE_SIZE)), MAX_MAX_JOINSPLIT_CACHE_SIZE);
+    joinSplitCache.reset(new CJoinSplitCache((size_t)nMaxSize << 20));
+    CCuckooCacheStats stats = joinSplitCache->GetStats();
+    LogPrintf("Using %.1fMiB for the JoinSplit cache, able to store %u proofs\n",
+        stats.nBytes * (1.0 / 1024 / 1024), (unsigned int)stats.nSlots);
+}
+
+CCuckooCacheStats GetJoinSplitCacheStats()
+{
+    if (!joinSplitCache)
+        return CCuckooCacheStats();
+    return joinSplitCache->GetStats();
+}
+
+bool VerifyJoinSplitCached(const JSDescription& joinsplit, ZCJoinSplit& params,
+                           libzcash::ProofVerifier& verifier, const uint256& joinSplitPubKey,
+                           CacheMode mode)
+{
+    if (!joinSplitCache || !verifier.IsStrict())
+        return joinsplit.Verify(params, verifier, joinSplitPubKey);
+
+    uint256 entry = joinSplitCache->ComputeEntry(joinsplit, joinSplitPubKey);
+    if (joinSplitCache->Get(entry, mode))
+        return true;
+
+    if (!joinsplit.Verify(params, verifier, joinSplitPubKey))
+        return false;
+
+    joinSplitCache->Set(entry, mode);
+    return true;
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_JOINSPLITCACHE_H
+#define BITCOIN_JOINSPLITCACHE_H
+
+#include "cuckoocache.h"
+#include "uint256.h"
+#include "zcash/JoinSplit.hpp"
+#include "zcash/Proof.hpp"
+
+#include <stdint.h>
+
+class JSDescription;
+
+/** Default for -maxjoinsplitcachesize, in megabytes. */
+static const int64_t DEFAULT_MAX_JOINSPLIT_CACHE_SIZE = 2;
+/** Largest -maxjoinsplitcachesize accepted, in megabytes. */
+static const int64_t MAX_MAX_JOINSPLIT_CACHE_SIZE = 1024;
+
+/**
+ * Verify the proof of a JoinSplit, unless it is in the cache of proofs that
+ * have already verified. Under CACHE_STORE a proof that verifies is added to
+ * the cache; under CACHE_ERASE a cached entry is dropped when it is found,
+ * since the JoinSplit will not be checked again; CACHE_LOOKUP does neither.
+ * A verifier that does not check proofs leaves the cache alone.
+ */
+bool VerifyJoinSplitCached(const JSDescription& joinsplit, ZCJoinSplit& params,
+                           libzcash::ProofVerifier& verifier, const uint256& joinSplitPubKey,
+                           CacheMode mode);
+
+/** Allocate the JoinSplit cache according to -maxjoinsplitcachesize. Until it
+ *  is called, proofs are not cached. */
+void InitJoinSplitCache();
+
+/** Size and hit counters of the JoinSplit cache. */
+CCuckooCacheStats GetJoinSplitCacheStats();
+
+#endif // BITCOIN_JOINSPLITCACHE_H
@@ -49,6 +49,19 @@ public:
         batch.Put(slKey, slValue);
     }
 
+    //! Write a key and value that are already serialized, such as those
+    //! read back from a snapshot of the database.
+    void WriteRaw(const std::string& key, const std::string& value)
+    {
+        batch.Put(key, value);
+    }
+
+    //! Erase a key that is already serialized.
+    void EraseRaw(const std::string& key)
+    {
+        batch.Delete(key);
+    }
+
     template <typename K>
     void Erase(const K& key)
     {
@@ -10,6 +10,7 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockfilter.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
@@ -17,6 +18,7 @@
 #include "consensus/validation.h"
 #include "deprecation.h"
 #include "init.h"
+#include "joinsplitcache.h"
 #include "merkleblock.h"
 #include "metrics.h"
 #include "net.h"
@@ -31,7 +33,9 @@
 #include "wallet/asyncrpcoperation_sendmany.h"
 #include "wallet/asyncrpcoperation_shieldcoinbase.h"
 
+#include <atomic>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -54,6 +58,8 @@ CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
 CChain chainActive;
+/** The tip last published to GetChainSnapshot() readers. */
+static std::atomic<const CBlockIndex*> pindexTipPublished(NULL);
 CBlockIndex *pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
@@ -63,7 +69,11 @@ bool fExperimentalMode = false;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = false;
+bool fAddressIndex = false;
+bool fSpentIndex = false;
+bool fBlockFilterIndex = false;
 bool fHavePruned = false;
+CBlockIndex *pindexAssumedValid = NULL;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
@@ -553,7 +563,10 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewBackgroundWriter *pcoinsWriter = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CBlockFilterDB *pblockfilterdb = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -841,7 +854,7 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& in
 }
 
 bool CheckTransaction(const CTransaction& tx, CValidationState &state,
-                      libzcash::ProofVerifier& verifier)
+                      libzcash::ProofVerifier& verifier, CacheMode cacheMode)
 {
     // Don't count coinbase transactions because mining skews the count
     if (!tx.IsCoinBase()) {
@@ -853,7 +866,7 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state,
     } else {
         // Ensure that zk-SNARKs verify
         BOOST_FOREACH(const JSDescription &joinsplit, tx.vjoinsplit) {
-            if (!joinsplit.Verify(*pzcashParams, verifier, tx.joinSplitPubKey)) {
+            if (!VerifyJoinSplitCached(joinsplit, *pzcashParams, verifier, tx.joinSplitPubKey, cacheMode)) {
                 return state.DoS(100, error("CheckTransaction(): joinsplit does not verify"),
                                     REJECT_INVALID, "bad-txns-joinsplit-verification-failed");
             }
@@ -999,15 +1012,10 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
                                  REJECT_INVALID, "bad-txns-prevout-null");
 
         if (tx.vjoinsplit.size() > 0) {
-            // Empty output script.
-            CScript scriptCode;
-            uint256 dataToBeSigned;
-            try {
-                dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL);
-            } catch (std::logic_error ex) {
-                return state.DoS(100, error("CheckTransaction(): error computing signature hash"),
-                                 REJECT_INVALID, "error-computing-signature-hash");
-            }
+            // The signature hash over an empty output script, as computed by
+            // SignatureHash(CScript(), tx, NOT_AN_INPUT, SIGHASH_ALL). It is
+            // cached along with the rest of the transaction's sighash data.
+            uint256 dataToBeSigned = GetPrecomputedTransactionData(tx)->JoinSplitSigHash();
 
             BOOST_STATIC_ASSERT(crypto_sign_PUBLICKEYBYTES == 32);
 
@@ -1262,7 +1270,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         pool.addUnchecked(hash, entry, !IsInitialBlockDownload());
     }
 
-    SyncWithWallets(tx, NULL);
+    SyncWithWallets(std::make_shared<const CTransaction>(tx));
 
     return true;
 }
@@ -1618,7 +1626,7 @@ void UpdateCoins(const CTransaction& tx, CValidationState &state, CCoinsViewCach
 
 bool CScriptCheck::operator()() {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore), &error)) {
+    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore, txdata.get()), &error)) {
         return ::error("CScriptCheck(): %s:%d VerifySignature failed: %s", ptxTo->GetHash().ToString(), nIn, ScriptErrorString(error));
     }
     return true;
@@ -1720,13 +1728,17 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, cons
         // before the last block chain checkpoint. This is safe because block merkle hashes are
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
+            // Shared by the checks of all inputs, and by the mempool and
+            // block checks of this transaction.
+            std::shared_ptr<const PrecomputedTransactionData> txdata = GetPrecomputedTransactionData(tx);
+
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
                 const CCoins* coins = inputs.AccessCoins(prevout.hash);
                 assert(coins);
 
                 // Verify signature
-                CScriptCheck check(*coins, tx, i, flags, cacheStore);
+                CScriptCheck check(*coins, tx, i, flags, cacheStore, txdata);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1739,7 +1751,7 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, cons
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
                         CScriptCheck check(*coins, tx, i,
-                                flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore);
+                                flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, txdata);
                         if (check())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
                     }
@@ -1835,6 +1847,166 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // anon namespace
 
+/** The address index type of an output script, and its address hash. */
+static uint8_t GetAddressIndexType(const CScript& script, uint160& hashBytes)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(script, dest))
+        return ADDRESSINDEX_NONE;
+    if (const CKeyID* keyID = boost::get<CKeyID>(&dest)) {
+        hashBytes = *keyID;
+        return ADDRESSINDEX_P2PKH;
+    }
+    if (const CScriptID* scriptID = boost::get<CScriptID>(&dest)) {
+        hashBytes = *scriptID;
+        return ADDRESSINDEX_P2SH;
+    }
+    return ADDRESSINDEX_NONE;
+}
+
+/**
+ * Collect the address and spent index entries of a block from the block and
+ * its undo data, which holds the outputs its inputs spend. Changes to the
+ * unspent index are in the order they must be applied in: for each
+ * transaction, the outputs it spends and then those it creates.
+ */
+static void GetBlockIndexEntries(const CBlock& block, const CBlockUndo& blockundo, int nHeight,
+                                 std::vector<std::pair<CAddressIndexKey, CAmount> >* pAddressIndex,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >* pAddressUnspentIndex,
+                                 std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >* pSpentIndex)
+{
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i-1];
+            for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const CTxOut& prev = txundo.vprevout[j].txout;
+                uint160 hashBytes;
+                uint8_t type = GetAddressIndexType(prev.scriptPubKey, hashBytes);
+                if (type != ADDRESSINDEX_NONE) {
+                    if (pAddressIndex)
+                        pAddressIndex->push_back(std::make_pair(CAddressIndexKey(type, hashBytes, nHeight, i, txhash, j, true), prev.nValue * -1));
+                    if (pAddressUnspentIndex)
+                        pAddressUnspentIndex->push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n), CAddressUnspentValue()));
+                }
+                if (pSpentIndex)
+                    pSpentIndex->push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue(txhash, j, nHeight, prev.nValue, type, hashBytes)));
+            }
+        }
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            uint160 hashBytes;
+            uint8_t type = GetAddressIndexType(out.scriptPubKey, hashBytes);
+            if (type == ADDRESSINDEX_NONE)
+                continue;
+            if (pAddressIndex)
+                pAddressIndex->push_back(std::make_pair(CAddressIndexKey(type, hashBytes, nHeight, i, txhash, k, false), out.nValue));
+            if (pAddressUnspentIndex)
+                pAddressUnspentIndex->push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+        }
+    }
+}
+
+/** Add the entries of a connected block to the enabled indexes. */
+static bool ConnectBlockIndexEntries(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    GetBlockIndexEntries(block, blockundo, pindex->nHeight,
+                         fAddressIndex ? &addressIndex : NULL,
+                         fAddressIndex ? &addressUnspentIndex : NULL,
+                         fSpentIndex ? &spentIndex : NULL);
+
+    if (fAddressIndex) {
+        if (!pblocktree->WriteAddressIndex(addressIndex) ||
+            !pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+            return false;
+    }
+    if (fSpentIndex && !pblocktree->UpdateSpentIndex(spentIndex))
+        return false;
+    return true;
+}
+
+/**
+ * Add a connected block to the block filter index. The filter header chains
+ * to that of the previous block, so the previous block must be indexed; the
+ * genesis block is not, and the header before the first block is zero.
+ */
+static bool ConnectBlockFilter(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    uint256 hashPrevHeader;
+    if (pindex->pprev && pindex->pprev->pprev &&
+        !pblockfilterdb->ReadFilterHeader(pindex->pprev->GetBlockHash(), hashPrevHeader))
+        return error("%s: block %s is not in the block filter index", __func__, pindex->pprev->GetBlockHash().ToString());
+
+    CBlockFilter filter(block, blockundo);
+    return pblockfilterdb->WriteBlock(filter, filter.ComputeHeader(hashPrevHeader),
+                                      BuildCompactShieldedBlock(block, pindex->nHeight));
+}
+
+/**
+ * Remove the entries of a disconnected block from the enabled indexes. view
+ * must already have the spent outputs restored, as the unspent index needs
+ * their heights.
+ */
+static bool DisconnectBlockIndexEntries(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex, CCoinsViewCache& view)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    GetBlockIndexEntries(block, blockundo, pindex->nHeight,
+                         fAddressIndex ? &addressIndex : NULL,
+                         NULL,
+                         fSpentIndex ? &spentIndex : NULL);
+
+    if (fAddressIndex) {
+        // Undo the unspent index changes of ConnectBlockIndexEntries in
+        // reverse, so that outputs created and spent within the block end up
+        // erased.
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+        for (int i = block.vtx.size() - 1; i >= 0; i--) {
+            const CTransaction& tx = block.vtx[i];
+            const uint256 txhash = tx.GetHash();
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                uint160 hashBytes;
+                uint8_t type = GetAddressIndexType(tx.vout[k].scriptPubKey, hashBytes);
+                if (type != ADDRESSINDEX_NONE)
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, txhash, k), CAddressUnspentValue()));
+            }
+            if (i == 0)
+                continue;
+            const CTxUndo& txundo = blockundo.vtxundo[i-1];
+            for (unsigned int j = tx.vin.size(); j-- > 0;) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const CTxOut& prev = txundo.vprevout[j].txout;
+                uint160 hashBytes;
+                uint8_t type = GetAddressIndexType(prev.scriptPubKey, hashBytes);
+                if (type == ADDRESSINDEX_NONE)
+                    continue;
+                // The undo data only has the height of the last output of a
+                // transaction to be spent, but the restored coins always do.
+                const CCoins* coins = view.AccessCoins(prevout.hash);
+                int nPrevHeight = coins ? coins->nHeight : pindex->nHeight;
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n), CAddressUnspentValue(prev.nValue, prev.scriptPubKey, nPrevHeight)));
+            }
+        }
+        if (!pblocktree->EraseAddressIndex(addressIndex) ||
+            !pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+            return false;
+    }
+    if (fSpentIndex) {
+        for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >::iterator it = spentIndex.begin(); it != spentIndex.end(); it++)
+            it->second.SetNull();
+        if (!pblocktree->UpdateSpentIndex(spentIndex))
+            return false;
+    }
+    return true;
+}
+
 /**
  * Apply the undo operation of a CTxInUndo to the given chain state.
  * @param undo The undo object.
@@ -1868,7 +2040,7 @@ static bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const CO
     return fClean;
 }
 
-bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
+bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean, bool fUpdateIndexes)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
@@ -1932,6 +2104,11 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         }
     }
 
+    if (fUpdateIndexes && (fAddressIndex || fSpentIndex)) {
+        if (!DisconnectBlockIndexEntries(block, blockUndo, pindex, view))
+            return AbortNode(state, "Failed to write address index");
+    }
+
     // set the old best anchor back
     view.PopAnchor(blockUndo.old_tree_root);
 
@@ -2046,7 +2223,7 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
-bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck)
+bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck, bool fUpdateIndexes)
 {
     const CChainParams& chainparams = Params();
     AssertLockHeld(cs_main);
@@ -2063,8 +2240,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     auto verifier = libzcash::ProofVerifier::Strict();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
 
-    // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in
-    if (!CheckBlock(block, state, fExpensiveChecks ? verifier : disabledVerifier, !fJustCheck, !fJustCheck))
+    // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in.
+    // Proofs already verified in the mempool are taken from the JoinSplit cache, and dropped from
+    // it unless we are only checking the block.
+    if (!CheckBlock(block, state, fExpensiveChecks ? verifier : disabledVerifier, !fJustCheck, !fJustCheck,
+                    fJustCheck ? CACHE_STORE : CACHE_ERASE))
         return false;
 
     // verify that the view's current state corresponds to the previous block
@@ -2160,8 +2340,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
             nFees += view.GetValueIn(tx)-tx.GetValueOut();
 
+            // As for JoinSplits above, signature cache entries are dropped
+            // only when the block is connected for real
             std::vector<CScriptCheck> vChecks;
-            if (!ContextualCheckInputs(tx, state, view, fExpensiveChecks, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
+            if (!ContextualCheckInputs(tx, state, view, fExpensiveChecks, flags, fJustCheck, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
                 return false;
             control.Add(vChecks);
         }
@@ -2242,6 +2424,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fUpdateIndexes && (fAddressIndex || fSpentIndex))
+        if (!ConnectBlockIndexEntries(block, blockundo, pindex))
+            return AbortNode(state, "Failed to write address index");
+
+    // Filter index entries are keyed by block hash, so they stay valid when
+    // the block is disconnected.
+    if (fUpdateIndexes && fBlockFilterIndex)
+        if (!ConnectBlockFilter(block, blockundo, pindex))
+            return AbortNode(state, "Failed to write block filter index");
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2303,6 +2495,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         nLastSetChain = nNow;
     }
     size_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+    // Entries handed to the background writer stay in memory until written.
+    if (pcoinsWriter)
+        cacheSize += pcoinsWriter->PendingMemoryUsage();
     // The cache is large and close to the limit, but we have time now (not in the middle of a block processing).
     bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize * (10.0/9) > nCoinCacheUsage;
     // The cache is over the limit, we have to write now.
@@ -2337,6 +2532,10 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                 return AbortNode(state, "Files to write to block index database");
             }
+            // The solutions are now on disk; stop keeping them resident.
+            BOOST_FOREACH(const CBlockIndex* pindex, vBlocks) {
+                mapBlockIndex[pindex->GetBlockHash()]->TrimSolution();
+            }
         }
         // Finally remove any pruned files
         if (fFlushForPrune)
@@ -2353,8 +2552,18 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
-        if (!pcoinsTip->Flush())
+        if (pcoinsWriter) {
+            // Hand the modified entries to the background writer and keep
+            // the most recently modified ones cached, so that validation
+            // neither stalls on the write nor restarts from a cold cache.
+            // A write that is still in flight is waited for first.
+            if (!pcoinsTip->Sync(nCoinCacheUsage / 2))
+                return AbortNode(state, "Failed to write to coin database");
+            if (mode == FLUSH_STATE_ALWAYS && !pcoinsWriter->Wait())
+                return AbortNode(state, "Failed to write to coin database");
+        } else if (!pcoinsTip->Flush()) {
             return AbortNode(state, "Failed to write to coin database");
+        }
         nLastFlush = nNow;
     }
     if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
@@ -2379,10 +2588,25 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+CChainSnapshot GetChainSnapshot()
+{
+    return CChainSnapshot(pindexTipPublished.load(std::memory_order_acquire));
+}
+
+/**
+ * Make the current chainActive tip visible to GetChainSnapshot(). Must be
+ * called after every chainActive.SetTip(), once the new tip's fields are final.
+ */
+static void PublishChainSnapshot()
+{
+    pindexTipPublished.store(chainActive.Tip(), std::memory_order_release);
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     const CChainParams& chainParams = Params();
     chainActive.SetTip(pindexNew);
+    PublishChainSnapshot();
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -2425,7 +2649,8 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
     assert(pindexDelete);
     mempool.check(pcoinsTip);
     // Read block from disk.
-    CBlock block;
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    CBlock& block = *pblock;
     if (!ReadBlockFromDisk(block, pindexDelete))
         return AbortNode(state, "Failed to read block");
     // Apply the block atomically to the chain state.
@@ -2464,15 +2689,15 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev);
     // Get the current commitment tree
-    ZCIncrementalMerkleTree newTree;
-    assert(pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), newTree));
+    std::shared_ptr<ZCIncrementalMerkleTree> newTree = std::make_shared<ZCIncrementalMerkleTree>();
+    assert(pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), *newTree));
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     BOOST_FOREACH(const CTransaction &tx, block.vtx) {
-        SyncWithWallets(tx, NULL);
+        SyncWithWallets(std::shared_ptr<const CTransaction>(pblock, &tx));
     }
     // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexDelete, &block, newTree, false);
+    GetMainSignals().ChainTip(pindexDelete, pblock, newTree, false);
     return true;
 }
 
@@ -2491,15 +2716,18 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     mempool.check(pcoinsTip);
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
-    CBlock block;
+    // Listeners share the block, and may still be using it after we return.
+    std::shared_ptr<const CBlock> pblockShared;
     if (!pblock) {
-        if (!ReadBlockFromDisk(block, pindexNew))
+        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*pblockRead, pindexNew))
             return AbortNode(state, "Failed to read block");
-        pblock = &block;
+        pblock = pblockRead.get();
+        pblockShared = pblockRead;
     }
     // Get the current commitment tree
-    ZCIncrementalMerkleTree oldTree;
-    assert(pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), oldTree));
+    std::shared_ptr<ZCIncrementalMerkleTree> oldTree = std::make_shared<ZCIncrementalMerkleTree>();
+    assert(pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), *oldTree));
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
@@ -2534,14 +2762,16 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     // Tell wallet about transactions that went from mempool
     // to conflicted:
     BOOST_FOREACH(const CTransaction &tx, txConflicted) {
-        SyncWithWallets(tx, NULL);
+        SyncWithWallets(std::make_shared<const CTransaction>(tx));
     }
     // ... and about transactions that got confirmed:
-    BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
-        SyncWithWallets(tx, pblock);
+    if (!pblockShared)
+        pblockShared = std::make_shared<const CBlock>(*pblock);
+    BOOST_FOREACH(const CTransaction &tx, pblockShared->vtx) {
+        SyncWithWallets(std::shared_ptr<const CTransaction>(pblockShared, &tx), pblockShared);
     }
     // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexNew, pblock, oldTree, true);
+    GetMainSignals().ChainTip(pindexNew, pblockShared, oldTree, true);
 
     EnforceNodeDeprecation(pindexNew->nHeight);
 
@@ -2700,6 +2930,9 @@ bool ActivateBestChain(CValidationState &state, CBlock *pblock) {
     const CChainParams& chainParams = Params();
     do {
         boost::this_thread::interruption_point();
+        // Don't let asynchronous wallets fall too far behind, holding on to
+        // the blocks they have yet to process.
+        LimitValidationInterfaceQueue();
 
         bool fInitialDownload;
         {
@@ -3028,7 +3261,7 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
 
 bool CheckBlock(const CBlock& block, CValidationState& state,
                 libzcash::ProofVerifier& verifier,
-                bool fCheckPOW, bool fCheckMerkleRoot)
+                bool fCheckPOW, bool fCheckMerkleRoot, CacheMode cacheMode)
 {
     // These are checks that are independent of context.
 
@@ -3073,7 +3306,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
 
     // Check transactions
     BOOST_FOREACH(const CTransaction& tx, block.vtx)
-        if (!CheckTransaction(tx, state, verifier))
+        if (!CheckTransaction(tx, state, verifier, cacheMode))
             return error("CheckBlock(): CheckTransaction failed");
 
     unsigned int nSigOps = 0;
@@ -3540,18 +3773,23 @@ bool static LoadBlockIndexDB()
 
     boost::this_thread::interruption_point();
 
-    // Calculate nChainWork
-    vector<pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
+    // Calculate nChainWork. A parent always has a lower height than its
+    // children, so bucketing the entries by height gives a topological order
+    // in linear time, and everything below is a single pass over it.
+    int64_t nStart = GetTimeMicros();
+    int nMaxHeight = 0;
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
+        nMaxHeight = std::max(nMaxHeight, item.second->nHeight);
+    vector<size_t> vHeightOffset(nMaxHeight + 2, 0);
+    BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
+        vHeightOffset[item.second->nHeight + 1]++;
+    for (int nHeight = 1; nHeight <= nMaxHeight + 1; nHeight++)
+        vHeightOffset[nHeight] += vHeightOffset[nHeight - 1];
+    vector<CBlockIndex*> vSortedByHeight(mapBlockIndex.size());
+    BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
+        vSortedByHeight[vHeightOffset[item.second->nHeight]++] = item.second;
+    BOOST_FOREACH(CBlockIndex* pindex, vSortedByHeight)
     {
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
-    }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    BOOST_FOREACH(const PAIRTYPE(int, CBlockIndex*)& item, vSortedByHeight)
-    {
-        CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
@@ -3595,9 +3833,14 @@ bool static LoadBlockIndexDB()
             pindex->BuildSkip();
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == NULL || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
+        if (pindex->nStatus & BLOCK_ASSUMED_VALID)
+            pindexAssumedValid = pindex;
     }
+    LogPrintf("%s: computed chain work for %u entries in %dms\n", __func__,
+        vSortedByHeight.size(), (GetTimeMicros() - nStart) / 1000);
 
     // Load block file info
+    nStart = GetTimeMicros();
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
     LogPrintf("%s: last block file = %i\n", __func__, nLastBlockFile);
@@ -3631,6 +3874,8 @@ bool static LoadBlockIndexDB()
             return false;
         }
     }
+    LogPrintf("%s: loaded block file info and checked %u blk files in %dms\n", __func__,
+        setBlkDataFiles.size(), (GetTimeMicros() - nStart) / 1000);
 
     // Check whether we have ever pruned block & undo files
     pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
@@ -3646,6 +3891,12 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have the address and spent indexes
+    pblocktree->ReadFlag("addressindex", fAddressIndex);
+    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
+    pblocktree->ReadFlag("spentindex", fSpentIndex);
+    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+
     // Fill in-memory data
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
     {
@@ -3667,6 +3918,7 @@ bool static LoadBlockIndexDB()
     chainActive.SetTip(it->second);
     // Set hashAnchorEnd for the end of best chain
     it->second->hashAnchorEnd = pcoinsTip->GetBestAnchor();
+    PublishChainSnapshot();
 
     PruneBlockIndexCandidates();
 
@@ -3716,12 +3968,16 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
         uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
         if (pindex->nHeight < chainActive.Height()-nCheckDepth)
             break;
+        // Pruned nodes, including those started from a snapshot, only
+        // have the most recent blocks.
+        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA))
+            break;
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex))
             return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, verifier))
+        // check level 1: verify block validity, leaving the caches alone
+        if (nCheckLevel >= 1 && !CheckBlock(block, state, verifier, true, true, CACHE_LOOKUP))
             return error("VerifyDB(): *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
         // check level 2: verify undo validity
         if (nCheckLevel >= 2 && pindex) {
@@ -3735,7 +3991,7 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             bool fClean = true;
-            if (!DisconnectBlock(block, state, pindex, coins, &fClean))
+            if (!DisconnectBlock(block, state, pindex, coins, &fClean, false))
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             pindexState = pindex->pprev;
             if (!fClean) {
@@ -3760,7 +4016,7 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex))
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins))
+            if (!ConnectBlock(block, state, pindex, coins, false, false))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         }
     }
@@ -3770,6 +4026,175 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
     return true;
 }
 
+namespace {
+
+/** Blocks claimed by an address index build worker at a time. */
+const int ADDRESS_INDEX_BUILD_BATCH = 100;
+/** Unspent index entries written by the chainstate scan at a time. */
+const size_t ADDRESS_UNSPENT_BUILD_BATCH = 10000;
+
+/**
+ * Address and spent index build worker. The entries of a block only depend
+ * on the block and its undo data, so workers claim batches of heights from a
+ * shared counter and write each batch independently.
+ */
+void BuildBlockIndexEntriesThread(const std::vector<CBlockIndex*>* pvChain, bool fBuildAddressIndex, bool fBuildSpentIndex,
+                                  std::atomic<int>* pnNextHeight, std::atomic<bool>* pfFailed)
+{
+    const std::vector<CBlockIndex*>& vChain = *pvChain;
+    while (!*pfFailed && !ShutdownRequested()) {
+        int nStart = pnNextHeight->fetch_add(ADDRESS_INDEX_BUILD_BATCH);
+        if (nStart >= (int)vChain.size())
+            break;
+        int nEnd = std::min((int)vChain.size(), nStart + ADDRESS_INDEX_BUILD_BATCH);
+
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+        for (int nHeight = nStart; nHeight < nEnd; nHeight++) {
+            const CBlockIndex* pindex = vChain[nHeight];
+            CBlock block;
+            CBlockUndo blockundo;
+            CDiskBlockPos pos = pindex->GetUndoPos();
+            if (!ReadBlockFromDisk(block, pindex) || pos.IsNull() ||
+                !UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash()) ||
+                blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+                LogPrintf("%s: unable to read block or undo data at height %d\n", __func__, nHeight);
+                *pfFailed = true;
+                return;
+            }
+            GetBlockIndexEntries(block, blockundo, nHeight,
+                                 fBuildAddressIndex ? &addressIndex : NULL,
+                                 NULL,
+                                 fBuildSpentIndex ? &spentIndex : NULL);
+        }
+        if ((fBuildAddressIndex && !pblocktree->WriteAddressIndex(addressIndex)) ||
+            (fBuildSpentIndex && !pblocktree->UpdateSpentIndex(spentIndex))) {
+            *pfFailed = true;
+            return;
+        }
+    }
+}
+
+/** Build the unspent index from the outputs in the coin database. */
+void BuildAddressUnspentIndexThread(std::atomic<bool>* pfFailed)
+{
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    bool fRet = pcoinsdbview->ForEachCoins([&](const uint256& txhash, const CCoins& coins) {
+        for (unsigned int i = 0; i < coins.vout.size(); i++) {
+            const CTxOut& out = coins.vout[i];
+            if (out.IsNull())
+                continue;
+            uint160 hashBytes;
+            uint8_t type = GetAddressIndexType(out.scriptPubKey, hashBytes);
+            if (type != ADDRESSINDEX_NONE)
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(type, hashBytes, txhash, i), CAddressUnspentValue(out.nValue, out.scriptPubKey, coins.nHeight)));
+        }
+        if (addressUnspentIndex.size() >= ADDRESS_UNSPENT_BUILD_BATCH) {
+            if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+                return false;
+            addressUnspentIndex.clear();
+        }
+        return !*pfFailed && !ShutdownRequested();
+    });
+    if (!fRet || !pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+        *pfFailed = true;
+}
+
+} // anon namespace
+
+bool BuildAddressIndexes(bool fBuildAddressIndex, bool fBuildSpentIndex)
+{
+    LOCK(cs_main);
+    int64_t nStart = GetTimeMillis();
+
+    // The unspent index is read from the coin database, which has to be at
+    // the tip. Holding cs_main keeps it there until the build is done.
+    FlushStateToDisk();
+    if (pcoinsWriter && !pcoinsWriter->Wait())
+        return error("%s: failed to write the coin database", __func__);
+    if (pcoinsdbview->GetBestBlock() != chainActive.Tip()->GetBlockHash())
+        return error("%s: the coin database is not at the tip", __func__);
+
+    // Start from scratch, in case an earlier build was interrupted.
+    if (!pblocktree->WipeAddressIndexes(fBuildAddressIndex, fBuildSpentIndex))
+        return error("%s: failed to wipe the address indexes", __func__);
+
+    LogPrintf("Building%s%s up to height %d\n", fBuildAddressIndex ? " address index" : "",
+        fBuildSpentIndex ? " spent index" : "", chainActive.Height());
+
+    // The genesis block's outputs are not in the chainstate, so it is not
+    // indexed.
+    std::vector<CBlockIndex*> vChain(chainActive.Height() + 1);
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex; pindex = pindex->pprev)
+        vChain[pindex->nHeight] = pindex;
+    std::atomic<int> nNextHeight(1);
+    std::atomic<bool> fFailed(false);
+
+    int nWorkers = std::max(1, GetNumCores());
+    std::vector<std::thread> workers;
+    if (fBuildAddressIndex)
+        workers.emplace_back(BuildAddressUnspentIndexThread, &fFailed);
+    for (int i = 0; i < nWorkers; i++)
+        workers.emplace_back(BuildBlockIndexEntriesThread, &vChain, fBuildAddressIndex, fBuildSpentIndex, &nNextHeight, &fFailed);
+    BOOST_FOREACH(std::thread& worker, workers) {
+        worker.join();
+    }
+
+    if (ShutdownRequested())
+        return true;
+    if (fFailed)
+        return error("%s: failed to build the address indexes", __func__);
+
+    // Only mark the indexes as built once every entry has been written.
+    if (fBuildAddressIndex) {
+        if (!pblocktree->WriteFlag("addressindex", true))
+            return false;
+        fAddressIndex = true;
+    }
+    if (fBuildSpentIndex) {
+        if (!pblocktree->WriteFlag("spentindex", true))
+            return false;
+        fSpentIndex = true;
+    }
+    LogPrintf("Built address indexes in %dms using %d threads\n", GetTimeMillis() - nStart, (int)workers.size());
+    return true;
+}
+
+bool BuildBlockFilterIndex()
+{
+    LOCK(cs_main);
+    int64_t nStart = GetTimeMillis();
+
+    // A block is only indexed after its parent, so every block below the
+    // last indexed block of the active chain is indexed too.
+    CBlockIndex* pindex = chainActive.Tip();
+    while (pindex && pindex->nHeight > 0 && !pblockfilterdb->HaveBlock(pindex->GetBlockHash()))
+        pindex = pindex->pprev;
+    if (!pindex || pindex == chainActive.Tip())
+        return true;
+
+    LogPrintf("Building block filter index from height %d to %d\n", pindex->nHeight + 1, chainActive.Height());
+    int nBlocks = 0;
+    for (pindex = chainActive.Next(pindex); pindex; pindex = chainActive.Next(pindex)) {
+        // What has been written is kept, and the build resumes from there
+        // on the next start.
+        if (ShutdownRequested())
+            return true;
+        CBlock block;
+        CBlockUndo blockundo;
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (!ReadBlockFromDisk(block, pindex) || pos.IsNull() ||
+            !UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash()) ||
+            blockundo.vtxundo.size() + 1 != block.vtx.size())
+            return error("%s: unable to read block or undo data at height %d", __func__, pindex->nHeight);
+        if (!ConnectBlockFilter(block, blockundo, pindex))
+            return error("%s: failed to write the block filter index", __func__);
+        nBlocks++;
+    }
+    LogPrintf("Built block filter index of %d blocks in %dms\n", nBlocks, GetTimeMillis() - nStart);
+    return true;
+}
+
 bool RewindBlockIndex(const CChainParams& params)
 {
     LOCK(cs_main);
@@ -3884,6 +4309,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishChainSnapshot();
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -3908,6 +4334,7 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     fHavePruned = false;
+    pindexAssumedValid = NULL;
 }
 
 bool LoadBlockIndex()
@@ -3933,6 +4360,10 @@ bool InitBlockIndex() {
     // Use the provided setting for -txindex in the new database
     fTxIndex = GetBoolArg("-txindex", false);
     pblocktree->WriteFlag("txindex", fTxIndex);
+    fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    pblocktree->WriteFlag("addressindex", fAddressIndex);
+    fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    pblocktree->WriteFlag("spentindex", fSpentIndex);
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -16,10 +16,8 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
     header = block.GetBlockHeader();
 
     vector<bool> vMatch;
-    vector<uint256> vHashes;
 
     vMatch.reserve(block.vtx.size());
-    vHashes.reserve(block.vtx.size());
 
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
@@ -31,10 +29,9 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
         }
         else
             vMatch.push_back(false);
-        vHashes.push_back(hash);
     }
 
-    txn = CPartialMerkleTree(vHashes, vMatch);
+    txn = CPartialMerkleTree(block, vMatch);
 }
 
 CMerkleBlock::CMerkleBlock(const CBlock& block, const std::set<uint256>& txids)
@@ -42,10 +39,8 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, const std::set<uint256>& txids)
     header = block.GetBlockHeader();
 
     vector<bool> vMatch;
-    vector<uint256> vHashes;
 
     vMatch.reserve(block.vtx.size());
-    vHashes.reserve(block.vtx.size());
 
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
@@ -54,16 +49,21 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, const std::set<uint256>& txids)
             vMatch.push_back(true);
         else
             vMatch.push_back(false);
-        vHashes.push_back(hash);
     }
 
-    txn = CPartialMerkleTree(vHashes, vMatch);
+    txn = CPartialMerkleTree(block, vMatch);
 }
 
 uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256> &vTxid) {
     if (height == 0) {
         // hash at height 0 is the txids themself
         return vTxid[pos];
+    } else if (vTxid.size() > nTransactions) {
+        // a complete tree: skip over the levels below this one
+        unsigned int offset = 0;
+        for (int h = 0; h < height; h++)
+            offset += CalcTreeWidth(h);
+        return vTxid[offset + pos];
     } else {
         // calculate left hash
         uint256 left = CalcHash(height-1, pos*2, vTxid), right;
@@ -145,6 +145,16 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256> &vTxid, const
     TraverseAndBuild(nHeight, 0, vTxid, vMatch);
 }
 
+CPartialMerkleTree::CPartialMerkleTree(const CBlock &block, const std::vector<bool> &vMatch) : nTransactions(block.vtx.size()), fBad(false) {
+    block.BuildMerkleTree();
+
+    int nHeight = 0;
+    while (CalcTreeWidth(nHeight) > 1)
+        nHeight++;
+
+    TraverseAndBuild(nHeight, 0, block.vMerkleTree, vMatch);
+}
+
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
 
 uint256 CPartialMerkleTree::ExtractMatches(std::vector<uint256> &vMatch) {
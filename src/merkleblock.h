@@ -67,7 +67,11 @@ protected:
         return (nTransactions+(1 << height)-1) >> height;
     }
 
-    /** calculate the hash of a node in the merkle tree (at leaf level: the txid's themselves) */
+    /**
+     * calculate the hash of a node in the merkle tree (at leaf level: the txid's themselves).
+     * vTxid may also be a complete tree as laid out by CBlock::BuildMerkleTree, in which
+     * case the node is looked up rather than recomputed.
+     */
     uint256 CalcHash(int height, unsigned int pos, const std::vector<uint256> &vTxid);
 
     /** recursive function that traverses tree nodes, storing the data as bits and hashes */
@@ -107,6 +111,9 @@ public:
     /** Construct a partial merkle tree from a list of transaction ids, and a mask that selects a subset of them */
     CPartialMerkleTree(const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
 
+    /** Construct a partial merkle tree for a block, reusing the block's cached merkle tree */
+    CPartialMerkleTree(const CBlock &block, const std::vector<bool> &vMatch);
+
     CPartialMerkleTree();
 
     /**
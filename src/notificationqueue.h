@@ -0,0 +1,195 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NOTIFICATIONQUEUE_H
+#define BITCOIN_NOTIFICATIONQUEUE_H
+
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/** A block or transaction to publish to external subscribers. */
+struct CNotificationData
+{
+    uint256 hash;
+    //! Network serialization, if a notifier publishes it. It is serialized
+    //! once, from the copy validation already has, and shared by all
+    //! notifiers.
+    std::shared_ptr<const std::vector<unsigned char> > data;
+    //! Position in the stream of notifications of this kind. Dropped
+    //! notifications still use up their number, so that subscribers can
+    //! detect gaps.
+    uint64_t nSequence;
+
+    CNotificationData() : nSequence(0) {}
+};
+
+/** What to do with a notification when the queue is full. */
+enum NotificationQueuePolicy
+{
+    //! Drop it, leaving a gap in the sequence numbers.
+    NOTIFY_DROP,
+    //! Wait for room, holding up validation.
+    NOTIFY_BLOCK,
+};
+
+//! Default limit of the data waiting in a notification queue (MiB)
+static const int64_t DEFAULT_NOTIFICATION_QUEUE_SIZE = 64;
+//! Notifications are charged this much on top of their data (bytes)
+static const size_t NOTIFICATION_OVERHEAD = 128;
+
+inline bool ParseNotificationQueuePolicy(const std::string& str, NotificationQueuePolicy& policy)
+{
+    if (str == "drop") {
+        policy = NOTIFY_DROP;
+        return true;
+    }
+    if (str == "block") {
+        policy = NOTIFY_BLOCK;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Bounded queue of notifications, published in order by a background
+ * thread so that slow subscribers and large messages do not hold up the
+ * validation thread that produces them.
+ */
+class CNotificationQueue
+{
+private:
+    typedef std::pair<std::function<void()>, size_t> Job;
+
+    std::mutex mutex;
+    std::condition_variable condWorker;
+    std::condition_variable condProducer;
+    std::deque<Job> queue;
+    size_t nQueuedBytes;
+    const size_t nMaxBytes;
+    const NotificationQueuePolicy policy;
+    bool fQuit;
+    uint64_t nDropped;
+    std::thread worker;
+
+    void Loop()
+    {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condWorker.wait(lock, [this]{ return fQuit || !queue.empty(); });
+                // Whatever is queued on shutdown is still published.
+                if (queue.empty())
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            job.first();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                nQueuedBytes -= job.second;
+            }
+            condProducer.notify_all();
+        }
+    }
+
+public:
+    CNotificationQueue(size_t nMaxBytesIn, NotificationQueuePolicy policyIn) :
+        nQueuedBytes(0), nMaxBytes(nMaxBytesIn), policy(policyIn), fQuit(false), nDropped(0) {}
+
+    ~CNotificationQueue()
+    {
+        Stop();
+    }
+
+    void Start()
+    {
+        worker = std::thread(&CNotificationQueue::Loop, this);
+    }
+
+    //! Publish what is queued and stop the background thread.
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fQuit = true;
+        }
+        condWorker.notify_all();
+        condProducer.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    /**
+     * Queue a job publishing nBytes of data. If the queue is full the job
+     * is dropped or this waits, according to the policy; a job is always
+     * accepted into an empty queue, however large. Returns false if the job
+     * was dropped.
+     */
+    bool Push(std::function<void()> job, size_t nBytes)
+    {
+        nBytes += NOTIFICATION_OVERHEAD;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (policy == NOTIFY_BLOCK) {
+                condProducer.wait(lock, [&]{ return fQuit || nQueuedBytes == 0 || nQueuedBytes + nBytes <= nMaxBytes; });
+            }
+            if (fQuit || (nQueuedBytes > 0 && nQueuedBytes + nBytes > nMaxBytes)) {
+                nDropped++;
+                return false;
+            }
+            queue.push_back(Job(std::move(job), nBytes));
+            nQueuedBytes += nBytes;
+        }
+        condWorker.notify_one();
+        return true;
+    }
+
+    /**
+     * Wait until the jobs queued before the call have been run, whatever
+     * the size limit. Must not be called from a job, or while holding a
+     * lock that the jobs take.
+     */
+    void Sync()
+    {
+        std::promise<void> done;
+        std::future<void> future = done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fQuit)
+                return;
+            queue.push_back(Job([&done]{ done.set_value(); }, 0));
+        }
+        condWorker.notify_one();
+        future.wait();
+    }
+
+    //! Number of jobs waiting to be run.
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    //! Number of notifications dropped so far.
+    uint64_t GetDropped()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nDropped;
+    }
+};
+
+#endif // BITCOIN_NOTIFICATIONQUEUE_H
@@ -9,12 +9,15 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 
 uint256 CBlockHeader::GetHash() const
 {
     return SerializeHash(*this);
 }
 
+static_assert(sizeof(uint256) == 32, "BuildMerkleTree hashes adjacent uint256s as one 64-byte block");
+
 uint256 CBlock::BuildMerkleTree(bool* fMutated) const
 {
     /* WARNING! If you're reading this because you're learning about crypto
@@ -52,26 +55,45 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
        known ways of changing the transactions without affecting the merkle
        root.
     */
-    vMerkleTree.clear();
-    vMerkleTree.reserve(vtx.size() * 2 + 16); // Safe upper bound for the number of total nodes.
-    for (std::vector<CTransaction>::const_iterator it(vtx.begin()); it != vtx.end(); ++it)
-        vMerkleTree.push_back(it->GetHash());
-    int j = 0;
+    size_t nNodes = 0;
+    for (size_t nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+        nNodes += nSize;
+    nNodes += vtx.empty() ? 0 : 1;
+
+    // Reuse the tree from an earlier call if the leaves still match.
+    if (vMerkleTree.size() == nNodes && !vtx.empty()) {
+        bool fCached = true;
+        for (size_t i = 0; i < vtx.size() && fCached; i++)
+            fCached = vMerkleTree[i] == vtx[i].GetHash();
+        if (fCached) {
+            if (fMutated) {
+                *fMutated = fMerkleMutated;
+            }
+            return vMerkleTree.back();
+        }
+    }
+
+    vMerkleTree.resize(nNodes);
+    for (size_t i = 0; i < vtx.size(); i++)
+        vMerkleTree[i] = vtx[i].GetHash();
+    size_t j = 0;
     bool mutated = false;
-    for (int nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+    for (size_t nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        // Each level is a contiguous run of 32-byte hashes, so its pairs can
+        // be fed straight to the batched double-SHA256.
+        size_t nPairs = nSize / 2;
+        SHA256D64(vMerkleTree[j + nSize].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize & 1) {
+            const uint256& last = vMerkleTree[j + nSize - 1];
+            vMerkleTree[j + nSize + nPairs] = Hash(BEGIN(last), END(last), BEGIN(last), END(last));
+        } else if (vMerkleTree[j + nSize - 2] == vMerkleTree[j + nSize - 1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
         }
         j += nSize;
     }
+    fMerkleMutated = mutated;
     if (fMutated) {
         *fMutated = mutated;
     }
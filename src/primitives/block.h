@@ -86,6 +86,7 @@ public:
 
     // memory only
     mutable std::vector<uint256> vMerkleTree;
+    mutable bool fMerkleMutated;
 
     CBlock()
     {
@@ -103,7 +104,11 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(*(CBlockHeader*)this);
-        READWRITE(vtx);
+        // The txids are computed together once the whole block has been
+        // read, rather than one by one as each transaction is parsed.
+        ::SerReadWrite(s, vtx, nType | SER_TXHASH_DEFERRED, nVersion, ser_action);
+        if (ser_action.ForRead())
+            CTransaction::UpdateHashes(vtx);
     }
 
     void SetNull()
@@ -111,6 +116,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         vMerkleTree.clear();
+        fMerkleMutated = false;
     }
 
     CBlockHeader GetBlockHeader() const
@@ -131,6 +137,9 @@ public:
     // If non-NULL, *mutated is set to whether mutation was detected in the merkle
     // tree (a duplication of transactions in the block leading to an identical
     // merkle root).
+    // The tree is kept in vMerkleTree and reused by later calls for as long as
+    // the transaction list is unchanged, so CheckBlock, ConnectBlock and
+    // CMerkleBlock only hash it once.
     uint256 BuildMerkleTree(bool* mutated = NULL) const;
 
     std::vector<uint256> GetMerkleBranch(int nIndex) const;
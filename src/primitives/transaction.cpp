@@ -9,6 +9,9 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 
+#include <algorithm>
+#include <thread>
+
 JSDescription::JSDescription(ZCJoinSplit& params,
             const uint256& pubKeyHash,
             const uint256& anchor,
@@ -17,7 +20,8 @@ JSDescription::JSDescription(ZCJoinSplit& params,
             CAmount vpub_old,
             CAmount vpub_new,
             bool computeProof,
-            uint256 *esk // payment disclosure
+            uint256 *esk, // payment disclosure
+            ZCJSProofWitness *witness
             ) : vpub_old(vpub_old), vpub_new(vpub_new), anchor(anchor)
 {
     boost::array<libzcash::Note, ZC_NUM_JS_OUTPUTS> notes;
@@ -37,7 +41,8 @@ JSDescription::JSDescription(ZCJoinSplit& params,
         vpub_new,
         anchor,
         computeProof,
-        esk // payment disclosure
+        esk, // payment disclosure
+        witness
     );
 }
 
@@ -53,7 +58,8 @@ JSDescription JSDescription::Randomized(
             CAmount vpub_new,
             bool computeProof,
             uint256 *esk, // payment disclosure
-            std::function<int(int)> gen
+            std::function<int(int)> gen,
+            ZCJSProofWitness *witness
         )
 {
     // Randomize the order of the inputs and outputs
@@ -68,7 +74,8 @@ JSDescription JSDescription::Randomized(
     return JSDescription(
         params, pubKeyHash, anchor, inputs, outputs,
         vpub_old, vpub_new, computeProof,
-        esk // payment disclosure
+        esk, // payment disclosure
+        witness
     );
 }
 
@@ -163,6 +170,72 @@ void CTransaction::UpdateHash() const
     *const_cast<uint256*>(&hash) = SerializeHash(*this);
 }
 
+/** Below this much serialized data, starting threads costs more than it saves. */
+static const size_t TXHASH_PARALLEL_MIN_BYTES = 256 * 1024;
+/** Amount of serialized data given to each hashing thread. */
+static const size_t TXHASH_BYTES_PER_THREAD = 128 * 1024;
+static const unsigned int TXHASH_MAX_THREADS = 8;
+
+/**
+ * Approximate serialized size of a transaction, from its scripts and its
+ * count of fixed-size JoinSplits, without serializing it.
+ */
+static size_t EstimateHashedSize(const CTransaction& tx)
+{
+    static const size_t nJoinSplitSize = ::GetSerializeSize(JSDescription(), SER_GETHASH, PROTOCOL_VERSION);
+    size_t nBytes = tx.vjoinsplit.size() * nJoinSplitSize;
+    for (const CTxIn& txin : tx.vin) {
+        nBytes += 41 + txin.scriptSig.size();
+    }
+    for (const CTxOut& txout : tx.vout) {
+        nBytes += 9 + txout.scriptPubKey.size();
+    }
+    return nBytes;
+}
+
+void CTransaction::UpdateHashes(const std::vector<CTransaction>& vtx)
+{
+    size_t nBytes = 0;
+    for (const CTransaction& tx : vtx) {
+        nBytes += EstimateHashedSize(tx);
+    }
+
+    unsigned int nThreads = 1;
+    if (nBytes >= TXHASH_PARALLEL_MIN_BYTES) {
+        nThreads = std::min<size_t>({
+            std::max(std::thread::hardware_concurrency(), 1u),
+            nBytes / TXHASH_BYTES_PER_THREAD,
+            vtx.size(),
+            TXHASH_MAX_THREADS});
+    }
+
+    // Transactions are dealt out round-robin so that runs of large
+    // JoinSplit transactions are shared between the threads.
+    auto worker = [&vtx, nThreads](unsigned int nOffset) {
+        for (size_t i = nOffset; i < vtx.size(); i += nThreads) {
+            vtx[i].UpdateHash();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    try {
+        for (unsigned int n = 1; n < nThreads; n++) {
+            threads.emplace_back(worker, n);
+        }
+        worker(0);
+    } catch (...) {
+        // Threads that did start must be joined before the vector goes.
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        throw;
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
 CTransaction::CTransaction() : nVersion(CTransaction::MIN_CURRENT_VERSION), vin(), vout(), nLockTime(0), vjoinsplit(), joinSplitPubKey(), joinSplitSig() { }
 
 CTransaction::CTransaction(const CMutableTransaction &tx) : nVersion(tx.nVersion), vin(tx.vin), vout(tx.vout), nLockTime(tx.nLockTime), vjoinsplit(tx.vjoinsplit),
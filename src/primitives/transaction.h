@@ -78,7 +78,8 @@ public:
             CAmount vpub_old,
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
-            uint256 *esk = nullptr // payment disclosure
+            uint256 *esk = nullptr, // payment disclosure
+            ZCJSProofWitness *witness = nullptr // to compute the proof later
     );
 
     static JSDescription Randomized(
@@ -93,7 +94,8 @@ public:
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
             uint256 *esk = nullptr, // payment disclosure
-            std::function<int(int)> gen = GetRandInt
+            std::function<int(int)> gen = GetRandInt,
+            ZCJSProofWitness *witness = nullptr // to compute the proof later
     );
 
     // Verifies that the JoinSplit proof is correct.
@@ -363,10 +365,16 @@ public:
                 READWRITE(*const_cast<joinsplit_sig_t*>(&joinSplitSig));
             }
         }
-        if (ser_action.ForRead())
+        if (ser_action.ForRead() && !(nType & SER_TXHASH_DEFERRED))
             UpdateHash();
     }
 
+    /**
+     * Compute the txids of transactions that were deserialized with
+     * SER_TXHASH_DEFERRED. Large batches are split across threads.
+     */
+    static void UpdateHashes(const std::vector<CTransaction>& vtx);
+
     bool IsNull() const {
         return vin.empty() && vout.empty();
     }
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "blockfilter.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
@@ -10,6 +11,7 @@
 #include "rpcserver.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "utilstrencodings.h"
 #include "version.h"
@@ -61,7 +63,9 @@ extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex,
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
-extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
+extern UniValue blockheaderToJSON(const CBlockIndex* blockindex, const CBlockHeader& header);
+extern UniValue blockFilterToJSON(const CBlockFilter& filter, const uint256& hashHeader);
+extern UniValue compactShieldedBlockToJSON(const CCompactShieldedBlock& compact);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
 {
@@ -137,14 +141,19 @@ static bool rest_headers(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    // The headers are copied under cs_main, since a flush may trim the
+    // resident solutions (see CBlockIndex::TrimSolution).
     std::vector<const CBlockIndex *> headers;
+    std::vector<CBlockHeader> blockHeaders;
     headers.reserve(count);
+    blockHeaders.reserve(count);
     {
         LOCK(cs_main);
         BlockMap::const_iterator it = mapBlockIndex.find(hash);
         const CBlockIndex *pindex = (it != mapBlockIndex.end()) ? it->second : NULL;
         while (pindex != NULL && chainActive.Contains(pindex)) {
             headers.push_back(pindex);
+            blockHeaders.push_back(pindex->GetBlockHeader());
             if (headers.size() == (unsigned long)count)
                 break;
             pindex = chainActive.Next(pindex);
@@ -152,8 +161,8 @@ static bool rest_headers(HTTPRequest* req,
     }
 
     CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-    BOOST_FOREACH(const CBlockIndex *pindex, headers) {
-        ssHeader << pindex->GetBlockHeader();
+    BOOST_FOREACH(const CBlockHeader &header, blockHeaders) {
+        ssHeader << header;
     }
 
     switch (rf) {
@@ -172,8 +181,8 @@ static bool rest_headers(HTTPRequest* req,
     }
     case RF_JSON: {
         UniValue jsonHeaders(UniValue::VARR);
-        BOOST_FOREACH(const CBlockIndex *pindex, headers) {
-            jsonHeaders.push_back(blockheaderToJSON(pindex));
+        for (size_t i = 0; i < headers.size(); i++) {
+            jsonHeaders.push_back(blockheaderToJSON(headers[i], blockHeaders[i]));
         }
         string strJSON = jsonHeaders.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
@@ -263,6 +272,93 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+/**
+ * Reply with block filter index data. It is keyed by block hash and never
+ * changes, so caches in front of the server may keep it indefinitely.
+ */
+static bool rest_filter_reply(HTTPRequest* req, RetFormat rf, const CDataStream& ssData, const UniValue& objJSON)
+{
+    req->WriteHeader("Cache-Control", "public, max-age=31536000");
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryData = ssData.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryData);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssData.begin(), ssData.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    case RF_JSON: {
+        string strJSON = objJSON.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_blockfilter(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fBlockFilterIndex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Block filter index not enabled");
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    string hashStr = params[0];
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    CBlockFilter filter;
+    uint256 hashHeader;
+    if (!pblockfilterdb->ReadFilter(hash, filter, hashHeader))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+
+    // The binary and hex formats are the filter header followed by the
+    // encoded filter.
+    CDataStream ssFilter(SER_NETWORK, PROTOCOL_VERSION);
+    ssFilter << hashHeader << filter.GetEncoded();
+    return rest_filter_reply(req, rf, ssFilter, rf == RF_JSON ? blockFilterToJSON(filter, hashHeader) : UniValue());
+}
+
+static bool rest_compactblock(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!fBlockFilterIndex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Block filter index not enabled");
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    string hashStr = params[0];
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    CCompactShieldedBlock compact;
+    if (!pblockfilterdb->ReadCompactBlock(hash, compact))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << compact;
+    return rest_filter_reply(req, rf, ssBlock, rf == RF_JSON ? compactShieldedBlockToJSON(compact) : UniValue());
+}
+
 static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -598,6 +694,8 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blockfilter/", rest_blockfilter},
+      {"/rest/compactblock/", rest_compactblock},
       {"/rest/getutxos", rest_getutxos},
 };
 
@@ -4,14 +4,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "blockfilter.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "consensus/validation.h"
+#include "cuckoocache.h"
+#include "joinsplitcache.h"
 #include "main.h"
 #include "primitives/transaction.h"
 #include "rpcserver.h"
+#include "snapshot.h"
 #include "sync.h"
+#include "txdb.h"
 #include "util.h"
 
 #include <stdint.h>
@@ -31,10 +36,9 @@ double GetDifficultyINTERNAL(const CBlockIndex* blockindex, bool networkDifficul
     // minimum difficulty = 1.0.
     if (blockindex == NULL)
     {
-        if (chainActive.Tip() == NULL)
+        blockindex = GetChainSnapshot().Tip();
+        if (blockindex == NULL)
             return 1.0;
-        else
-            blockindex = chainActive.Tip();
     }
 
     uint32_t bits;
@@ -96,28 +100,29 @@ static UniValue ValuePoolDesc(
     return rv;
 }
 
-UniValue blockheaderToJSON(const CBlockIndex* blockindex)
+UniValue blockheaderToJSON(const CBlockIndex* blockindex, const CBlockHeader& header)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
+    CChainSnapshot chain = GetChainSnapshot();
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain.Contains(blockindex))
+        confirmations = chain.Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("version", blockindex->nVersion));
     result.push_back(Pair("merkleroot", blockindex->hashMerkleRoot.GetHex()));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution)));
+    result.push_back(Pair("solution", HexStr(header.nSolution)));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    const CBlockIndex *pnext = chain.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -127,10 +132,11 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash().GetHex()));
+    CChainSnapshot chain = GetChainSnapshot();
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain.Contains(blockindex))
+        confirmations = chain.Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->nHeight));
@@ -163,7 +169,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    const CBlockIndex *pnext = chain.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -182,8 +188,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot().Height();
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -199,8 +204,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainSnapshot().Tip()->GetBlockHash().GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -216,7 +220,6 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getdifficulty", "")
         );
 
-    LOCK(cs_main);
     return GetNetworkDifficulty();
 }
 
@@ -224,6 +227,7 @@ UniValue mempoolToJSON(bool fVerbose = false)
 {
     if (fVerbose)
     {
+        int nHeight = GetChainSnapshot().Height();
         LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
         BOOST_FOREACH(const PAIRTYPE(uint256, CTxMemPoolEntry)& entry, mempool.mapTx)
@@ -236,7 +240,7 @@ UniValue mempoolToJSON(bool fVerbose = false)
             info.push_back(Pair("time", e.GetTime()));
             info.push_back(Pair("height", (int)e.GetHeight()));
             info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
+            info.push_back(Pair("currentpriority", e.GetPriority(nHeight)));
             const CTransaction& tx = e.GetTx();
             set<string> setDepends;
             BOOST_FOREACH(const CTxIn& txin, tx.vin)
@@ -301,8 +305,6 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawmempool", "true")
         );
 
-    LOCK(cs_main);
-
     bool fVerbose = false;
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
@@ -325,13 +327,13 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    CChainSnapshot chain = GetChainSnapshot();
 
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > chain.Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    const CBlockIndex* pblockindex = chain[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -366,8 +368,6 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -375,20 +375,174 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    // The header is copied under cs_main, since the resident solution may be
+    // trimmed by a flush (see CBlockIndex::TrimSolution). The other fields
+    // read afterwards are fixed once the entry is indexed.
+    const CBlockIndex* pblockindex;
+    CBlockHeader header;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
+        header = pblockindex->GetBlockHeader();
+    }
 
     if (!fVerbose)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << pblockindex->GetBlockHeader();
+        ssBlock << header;
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
         return strHex;
     }
 
-    return blockheaderToJSON(pblockindex);
+    return blockheaderToJSON(pblockindex, header);
+}
+
+UniValue blockFilterToJSON(const CBlockFilter& filter, const uint256& hashHeader)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("blockhash", filter.GetBlockHash().GetHex()));
+    result.push_back(Pair("n", (int64_t)filter.GetFilter().GetN()));
+    result.push_back(Pair("filter", HexStr(filter.GetEncoded())));
+    result.push_back(Pair("header", hashHeader.GetHex()));
+    return result;
+}
+
+UniValue compactShieldedBlockToJSON(const CCompactShieldedBlock& compact)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("hash", compact.hashBlock.GetHex()));
+    result.push_back(Pair("previousblockhash", compact.hashPrevBlock.GetHex()));
+    result.push_back(Pair("height", compact.nHeight));
+    result.push_back(Pair("time", (int64_t)compact.nTime));
+    UniValue txs(UniValue::VARR);
+    BOOST_FOREACH(const CCompactTx& ctx, compact.vtx) {
+        UniValue tx(UniValue::VOBJ);
+        tx.push_back(Pair("txid", ctx.txid.GetHex()));
+        tx.push_back(Pair("index", (int)ctx.index));
+        UniValue vjoinsplit(UniValue::VARR);
+        BOOST_FOREACH(const CCompactJoinSplit& cjs, ctx.vjoinsplit) {
+            UniValue joinsplit(UniValue::VOBJ);
+            UniValue nullifiers(UniValue::VARR);
+            BOOST_FOREACH(const uint256& nf, cjs.nullifiers) {
+                nullifiers.push_back(nf.GetHex());
+            }
+            joinsplit.push_back(Pair("nullifiers", nullifiers));
+            UniValue commitments(UniValue::VARR);
+            BOOST_FOREACH(const uint256& cm, cjs.commitments) {
+                commitments.push_back(cm.GetHex());
+            }
+            joinsplit.push_back(Pair("commitments", commitments));
+            joinsplit.push_back(Pair("ephemeralKey", cjs.ephemeralKey.GetHex()));
+            joinsplit.push_back(Pair("hSig", cjs.h_sig.GetHex()));
+            UniValue ciphertexts(UniValue::VARR);
+            BOOST_FOREACH(const std::vector<unsigned char>& prefix, cjs.ciphertextPrefixes) {
+                ciphertexts.push_back(HexStr(prefix));
+            }
+            joinsplit.push_back(Pair("ciphertextPrefixes", ciphertexts));
+            vjoinsplit.push_back(joinsplit);
+        }
+        tx.push_back(Pair("vjoinsplit", vjoinsplit));
+        txs.push_back(tx);
+    }
+    result.push_back(Pair("tx", txs));
+    return result;
+}
+
+UniValue getblockfilter(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getblockfilter \"hash\"\n"
+            "\nReturns the compact filter of the transparent scripts of block 'hash', which a light wallet\n"
+            "can match against its own scripts to tell whether it needs the block.\n"
+            "Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"hash\"          (string, required) The block hash\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blockhash\" : \"hash\", (string) the block hash (same as provided)\n"
+            "  \"n\" : n,               (numeric) The number of scripts in the filter\n"
+            "  \"filter\" : \"xxxx\",    (string) The hex-encoded Golomb-coded set\n"
+            "  \"header\" : \"hash\"     (string) The filter header, chaining the filter to those of earlier blocks\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    if (!fBlockFilterIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block filter index not enabled");
+
+    uint256 hash(uint256S(params[0].get_str()));
+    CBlockFilter filter;
+    uint256 hashHeader;
+    if (!pblockfilterdb->ReadFilter(hash, filter, hashHeader))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found in the block filter index");
+
+    return blockFilterToJSON(filter, hashHeader);
+}
+
+UniValue getcompactshieldedblock(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "getcompactshieldedblock \"hash\" ( verbose )\n"
+            "\nReturns what a light wallet needs of the JoinSplits of block 'hash' to find and spend its notes:\n"
+            "their nullifiers, commitments, ephemeral keys, hSig values and the leading bytes of the note\n"
+            "ciphertexts, without memos or proofs. Requires -blockfilterindex.\n"
+            "\nArguments:\n"
+            "1. \"hash\"          (string, required) The block hash\n"
+            "2. verbose           (boolean, optional, default=true) true for a json object, false for the hex encoded data\n"
+            "\nResult (for verbose = true):\n"
+            "{\n"
+            "  \"hash\" : \"hash\",              (string) the block hash (same as provided)\n"
+            "  \"previousblockhash\" : \"hash\", (string) The hash of the previous block\n"
+            "  \"height\" : n,                   (numeric) The block height\n"
+            "  \"time\" : ttt,                   (numeric) The block time in seconds since epoch (Jan 1 1970 GMT)\n"
+            "  \"tx\" : [                        (array) The transactions with JoinSplits\n"
+            "    {\n"
+            "      \"txid\" : \"id\",              (string) The transaction id\n"
+            "      \"index\" : n,                (numeric) The position of the transaction in the block\n"
+            "      \"vjoinsplit\" : [\n"
+            "        {\n"
+            "          \"nullifiers\" : [ \"hash\", ... ],\n"
+            "          \"commitments\" : [ \"hash\", ... ],\n"
+            "          \"ephemeralKey\" : \"hash\",\n"
+            "          \"hSig\" : \"hash\",\n"
+            "          \"ciphertextPrefixes\" : [ \"hex\", ... ]  (array) The first " + strprintf("%u", COMPACT_CIPHERTEXT_SIZE) + " bytes of each note ciphertext\n"
+            "        }, ...\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nResult (for verbose=false):\n"
+            "\"data\"             (string) A string that is serialized, hex-encoded data for the compact block\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcompactshieldedblock", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getcompactshieldedblock", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    if (!fBlockFilterIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block filter index not enabled");
+
+    uint256 hash(uint256S(params[0].get_str()));
+    bool fVerbose = true;
+    if (params.size() > 1)
+        fVerbose = params[1].get_bool();
+
+    CCompactShieldedBlock compact;
+    if (!pblockfilterdb->ReadCompactBlock(hash, compact))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found in the block filter index");
+
+    if (!fVerbose) {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << compact;
+        return HexStr(ssBlock.begin(), ssBlock.end());
+    }
+    return compactShieldedBlockToJSON(compact);
 }
 
 UniValue getblock(const UniValue& params, bool fHelp)
@@ -429,8 +583,6 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "12800")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
 
     // If height is supplied, find the hash
@@ -449,10 +601,11 @@ UniValue getblock(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
         }
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
+        CChainSnapshot chain = GetChainSnapshot();
+        if (nHeight < 0 || nHeight > chain.Height()) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
         }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
+        strHash = chain[nHeight]->GetBlockHash().GetHex();
     }
 
     uint256 hash(uint256S(strHash));
@@ -461,16 +614,24 @@ UniValue getblock(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    // Hold cs_main only to find the block on disk; reading and decoding it
+    // can take a while and does not touch any state cs_main protects.
+    const CBlockIndex* pblockindex;
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        pos = pblockindex->GetBlockPos();
+    }
 
-    if(!ReadBlockFromDisk(block, pblockindex))
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pos) || block.GetHash() != hash)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
     if (!fVerbose)
@@ -490,7 +651,7 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
         throw runtime_error(
             "gettxoutsetinfo\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time unless the node runs with -txoutsetstats.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
@@ -498,8 +659,9 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
             "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
             "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
-            "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"hash_serialized\": \"hash\",   (string) Order-independent hash (MuHash3072) of the unspent outputs\n"
+            "  \"total_amount\": x.xxx,         (numeric) The total amount\n"
+            "  \"nullifiers\": n                (numeric) The number of spent nullifiers\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
@@ -518,10 +680,55 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
         ret.push_back(Pair("bytes_serialized", (int64_t)stats.nSerializedSize));
         ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
         ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+        ret.push_back(Pair("nullifiers", (int64_t)stats.nNullifiers));
     }
     return ret;
 }
 
+UniValue dumptxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the chainstate at the current tip to a snapshot file, from which a new\n"
+            "node can be started with -loadsnapshot.\n"
+            "\nArguments:\n"
+            "1. \"path\"    (string, required) The snapshot file; a relative path is taken relative to the data directory\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"path\",              (string) The absolute path of the snapshot\n"
+            "  \"base_hash\": \"hash\",         (string) The block the snapshot was taken at\n"
+            "  \"base_height\": n,            (numeric) The height of that block\n"
+            "  \"hash_serialized\": \"hash\",   (string) The set hash of the snapshot, as in gettxoutsetinfo\n"
+            "  \"hash_snapshot\": \"hash\",     (string) The hash of the coins, nullifiers and anchors, for -assumesnapshot\n"
+            "  \"txouts\": n,                 (numeric) The number of unspent outputs\n"
+            "  \"nullifiers\": n              (numeric) The number of spent nullifiers\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.snapshot\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.snapshot\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(params[0].get_str(), GetDataDir());
+    if (boost::filesystem::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    CSnapshotMetadata metadata;
+    std::string strError;
+    if (!DumpSnapshot(path, metadata, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("path", path.string()));
+    ret.push_back(Pair("base_hash", metadata.hashBlock.GetHex()));
+    ret.push_back(Pair("base_height", metadata.nHeight));
+    ret.push_back(Pair("hash_serialized", metadata.hashSerialized.GetHex()));
+    ret.push_back(Pair("hash_snapshot", metadata.GetSnapshotHash().GetHex()));
+    ret.push_back(Pair("txouts", (int64_t)metadata.nTransactionOutputs));
+    ret.push_back(Pair("nullifiers", (int64_t)metadata.nNullifiers));
+    return ret;
+}
+
 UniValue gettxout(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 2 || params.size() > 3)
@@ -675,6 +882,9 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
+            "  \"assumedvalid\": xx,       (boolean) if the chainstate was loaded from a snapshot, so blocks up to it were not validated\n"
+            "  \"assumedvalidheight\": xxxxxx, (numeric) height of the snapshot block, present if assumedvalid is true\n"
             "  \"commitments\": xxxxxx,    (numeric) the current number of note commitments in the commitment tree\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
             "     {\n"
@@ -706,6 +916,10 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("verificationprogress",  Checkpoints::GuessVerificationProgress(Params().Checkpoints(), chainActive.Tip())));
     obj.push_back(Pair("chainwork",             chainActive.Tip()->nChainWork.GetHex()));
     obj.push_back(Pair("pruned",                fPruneMode));
+    bool fAssumedValid = pindexAssumedValid && chainActive.Contains(pindexAssumedValid);
+    obj.push_back(Pair("assumedvalid",          fAssumedValid));
+    if (fAssumedValid)
+        obj.push_back(Pair("assumedvalidheight", pindexAssumedValid->nHeight));
 
     ZCIncrementalMerkleTree tree;
     pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), tree);
@@ -839,6 +1053,17 @@ UniValue getchaintips(const UniValue& params, bool fHelp)
     return res;
 }
 
+static UniValue cacheStatsToJSON(const CCuckooCacheStats& stats)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("bytes", (int64_t) stats.nBytes));
+    obj.push_back(Pair("capacity", (int64_t) stats.nSlots));
+    obj.push_back(Pair("hits", (int64_t) stats.nHits));
+    obj.push_back(Pair("misses", (int64_t) stats.nMisses));
+    obj.push_back(Pair("evictions", (int64_t) stats.nEvictions));
+    return obj;
+}
+
 UniValue mempoolInfoToJSON()
 {
     UniValue ret(UniValue::VOBJ);
@@ -846,6 +1071,11 @@ UniValue mempoolInfoToJSON()
     ret.push_back(Pair("bytes", (int64_t) mempool.GetTotalTxSize()));
     ret.push_back(Pair("usage", (int64_t) mempool.DynamicMemoryUsage()));
 
+    // Signatures and JoinSplit proofs of mempool transactions are cached
+    // for block validation.
+    ret.push_back(Pair("sigcache", cacheStatsToJSON(GetSignatureCacheStats())));
+    ret.push_back(Pair("joinsplitcache", cacheStatsToJSON(GetJoinSplitCacheStats())));
+
     return ret;
 }
 
@@ -860,6 +1090,20 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"sigcache\": {                (object) The cache of verified signatures\n"
+            "    \"bytes\": xxxxx             (numeric) Memory allocated to the cache (see -maxsigcachesize)\n"
+            "    \"capacity\": xxxxx          (numeric) Number of signatures the cache can hold\n"
+            "    \"hits\": xxxxx              (numeric) Signature checks answered by the cache since startup\n"
+            "    \"misses\": xxxxx            (numeric) Signature checks not found in the cache since startup\n"
+            "    \"evictions\": xxxxx         (numeric) Cached signatures dropped to make room for newer ones\n"
+            "  }\n"
+            "  \"joinsplitcache\": {          (object) The cache of verified JoinSplit proofs\n"
+            "    \"bytes\": xxxxx             (numeric) Memory allocated to the cache (see -maxjoinsplitcachesize)\n"
+            "    \"capacity\": xxxxx          (numeric) Number of proofs the cache can hold\n"
+            "    \"hits\": xxxxx              (numeric) Proof checks answered by the cache since startup\n"
+            "    \"misses\": xxxxx            (numeric) Proof checks not found in the cache since startup\n"
+            "    \"evictions\": xxxxx         (numeric) Cached proofs dropped to make room for newer ones\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmempoolinfo", "")
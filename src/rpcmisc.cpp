@@ -11,6 +11,7 @@
 #include "netbase.h"
 #include "rpcserver.h"
 #include "timedata.h"
+#include "txdb.h"
 #include "util.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -430,6 +431,276 @@ UniValue verifymessage(const UniValue& params, bool fHelp)
     return (pubkey.GetID() == keyID);
 }
 
+/** The address index type and hash of a transparent address. */
+static bool GetAddressIndexKey(const CBitcoinAddress& address, uint160& hashBytes, int& type)
+{
+    CTxDestination dest = address.Get();
+    if (const CKeyID* keyID = boost::get<CKeyID>(&dest)) {
+        hashBytes = *keyID;
+        type = ADDRESSINDEX_P2PKH;
+        return true;
+    }
+    if (const CScriptID* scriptID = boost::get<CScriptID>(&dest)) {
+        hashBytes = *scriptID;
+        type = ADDRESSINDEX_P2SH;
+        return true;
+    }
+    return false;
+}
+
+static std::string GetAddressFromIndexKey(const uint160& hashBytes, int type)
+{
+    if (type == ADDRESSINDEX_P2SH)
+        return CBitcoinAddress(CScriptID(hashBytes)).ToString();
+    return CBitcoinAddress(CKeyID(hashBytes)).ToString();
+}
+
+/** Parse a single address, or an object with an "addresses" array. */
+static std::vector<std::pair<uint160, int> > GetAddressesFromParam(const UniValue& param)
+{
+    std::vector<UniValue> values;
+    if (param.isStr()) {
+        values.push_back(param);
+    } else if (param.isObject()) {
+        UniValue addressValues = find_value(param.get_obj(), "addresses");
+        if (!addressValues.isArray())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Addresses is expected to be an array");
+        values = addressValues.getValues();
+    } else {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Expected an address or an object with an addresses array");
+    }
+
+    std::vector<std::pair<uint160, int> > addresses;
+    BOOST_FOREACH(const UniValue& value, values) {
+        CBitcoinAddress address(value.get_str());
+        uint160 hashBytes;
+        int type = 0;
+        if (!address.IsValid() || !GetAddressIndexKey(address, hashBytes, type))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+        addresses.push_back(std::make_pair(hashBytes, type));
+    }
+    return addresses;
+}
+
+UniValue getaddressutxos(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressutxos {\"addresses\": [\"taddr\", ...]}\n"
+            "\nReturns the unspent outputs of the given transparent addresses (requires -addressindex).\n"
+            "\nArguments:\n"
+            "1. \"address\"            (string or object, required) An address, or an object with\n"
+            "  {\n"
+            "    \"addresses\": [      (array of strings) The addresses\n"
+            "      \"taddr\"\n"
+            "      ,...\n"
+            "    ]\n"
+            "  }\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\": \"taddr\",     (string) The address\n"
+            "    \"txid\": \"hash\",         (string) The transaction id\n"
+            "    \"outputIndex\": n,       (numeric) The index of the output\n"
+            "    \"script\": \"hex\",        (string) The output script\n"
+            "    \"satoshis\": n,          (numeric) The value of the output in zatoshis\n"
+            "    \"height\": n             (numeric) The height of the block containing the output\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"t1LmJqtT37e6b9NaNuoa4kS3Jsy8nfcNnvm\"]}'")
+            + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"t1LmJqtT37e6b9NaNuoa4kS3Jsy8nfcNnvm\"]}")
+        );
+
+    if (!fAddressIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled");
+
+    std::vector<std::pair<uint160, int> > addresses = GetAddressesFromParam(params[0]);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!pblocktree->ReadAddressUnspentIndex(it->first, it->second, unspentOutputs))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+    std::sort(unspentOutputs.begin(), unspentOutputs.end(),
+        [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a,
+           const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+            return a.second.blockHeight < b.second.blockHeight;
+        });
+
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it = unspentOutputs.begin(); it != unspentOutputs.end(); it++) {
+        UniValue output(UniValue::VOBJ);
+        output.push_back(Pair("address", GetAddressFromIndexKey(it->first.hashBytes, it->first.type)));
+        output.push_back(Pair("txid", it->first.txhash.GetHex()));
+        output.push_back(Pair("outputIndex", (int)it->first.index));
+        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
+        output.push_back(Pair("satoshis", it->second.satoshis));
+        output.push_back(Pair("height", it->second.blockHeight));
+        result.push_back(output);
+    }
+    return result;
+}
+
+UniValue getaddresstxids(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddresstxids {\"addresses\": [\"taddr\", ...], \"start\": n, \"end\": n}\n"
+            "\nReturns the ids of the transactions involving the given transparent addresses, in chain\n"
+            "order (requires -addressindex).\n"
+            "\nArguments:\n"
+            "1. \"address\"            (string or object, required) An address, or an object with\n"
+            "  {\n"
+            "    \"addresses\": [      (array of strings) The addresses\n"
+            "      \"taddr\"\n"
+            "      ,...\n"
+            "    ],\n"
+            "    \"start\": n,         (numeric, optional) The first block height to include\n"
+            "    \"end\": n            (numeric, optional) The last block height to include\n"
+            "  }\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"transactionid\"       (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"t1LmJqtT37e6b9NaNuoa4kS3Jsy8nfcNnvm\"]}'")
+            + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"t1LmJqtT37e6b9NaNuoa4kS3Jsy8nfcNnvm\"], \"start\": 1000, \"end\": 2000}")
+        );
+
+    if (!fAddressIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled");
+
+    std::vector<std::pair<uint160, int> > addresses = GetAddressesFromParam(params[0]);
+
+    int nStart = 0;
+    int nEnd = 0;
+    if (params[0].isObject()) {
+        UniValue startValue = find_value(params[0].get_obj(), "start");
+        UniValue endValue = find_value(params[0].get_obj(), "end");
+        if (!startValue.isNull())
+            nStart = startValue.get_int();
+        if (!endValue.isNull())
+            nEnd = endValue.get_int();
+        if (nStart < 0 || nEnd < 0 || (nEnd > 0 && nEnd < nStart))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid start or end height");
+    }
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!pblocktree->ReadAddressIndex(it->first, it->second, addressIndex, nStart, nEnd))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+
+    // The entries of each address are in chain order already; merge those
+    // of several addresses and drop the transactions seen more than once.
+    std::vector<std::pair<std::pair<int, unsigned int>, uint256> > txids;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+        txids.push_back(std::make_pair(std::make_pair(it->first.blockHeight, it->first.txindex), it->first.txhash));
+    }
+    std::sort(txids.begin(), txids.end());
+    txids.erase(std::unique(txids.begin(), txids.end()), txids.end());
+
+    UniValue result(UniValue::VARR);
+    for (std::vector<std::pair<std::pair<int, unsigned int>, uint256> >::const_iterator it = txids.begin(); it != txids.end(); it++) {
+        result.push_back(it->second.GetHex());
+    }
+    return result;
+}
+
+UniValue getaddressbalance(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getaddressbalance {\"addresses\": [\"taddr\", ...]}\n"
+            "\nReturns the balance of the given transparent addresses (requires -addressindex).\n"
+            "\nArguments:\n"
+            "1. \"address\"            (string or object, required) An address, or an object with\n"
+            "  {\n"
+            "    \"addresses\": [      (array of strings) The addresses\n"
+            "      \"taddr\"\n"
+            "      ,...\n"
+            "    ]\n"
+            "  }\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\": n,         (numeric) The current balance in zatoshis\n"
+            "  \"received\": n         (numeric) The total number of zatoshis received, including change\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"t1LmJqtT37e6b9NaNuoa4kS3Jsy8nfcNnvm\"]}'")
+            + HelpExampleRpc("getaddressbalance", "{\"addresses\": [\"t1LmJqtT37e6b9NaNuoa4kS3Jsy8nfcNnvm\"]}")
+        );
+
+    if (!fAddressIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled");
+
+    std::vector<std::pair<uint160, int> > addresses = GetAddressesFromParam(params[0]);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        if (!pblocktree->ReadAddressIndex(it->first, it->second, addressIndex))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+
+    CAmount nBalance = 0;
+    CAmount nReceived = 0;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin(); it != addressIndex.end(); it++) {
+        if (it->second > 0)
+            nReceived += it->second;
+        nBalance += it->second;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("balance", nBalance));
+    result.push_back(Pair("received", nReceived));
+    return result;
+}
+
+UniValue getspentinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1 || !params[0].isObject())
+        throw runtime_error(
+            "getspentinfo {\"txid\": \"hash\", \"index\": n}\n"
+            "\nReturns the input that spends a transparent output (requires -spentindex).\n"
+            "\nArguments:\n"
+            "1. \"outpoint\"           (object, required)\n"
+            "  {\n"
+            "    \"txid\": \"hash\",     (string) The id of the transaction with the output\n"
+            "    \"index\": n          (numeric) The index of the output\n"
+            "  }\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\": \"hash\",       (string) The id of the spending transaction\n"
+            "  \"index\": n,           (numeric) The index of the spending input\n"
+            "  \"height\": n           (numeric) The height of the block containing the spending transaction\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getspentinfo", "'{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}'")
+            + HelpExampleRpc("getspentinfo", "{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}")
+        );
+
+    if (!fSpentIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled");
+
+    uint256 txid = ParseHashV(find_value(params[0].get_obj(), "txid"), "txid");
+    UniValue indexValue = find_value(params[0].get_obj(), "index");
+    if (!indexValue.isNum() || indexValue.get_int() < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid index");
+
+    CSpentIndexValue value;
+    if (!pblocktree->ReadSpentIndex(CSpentIndexKey(txid, indexValue.get_int()), value))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("txid", value.txid.GetHex()));
+    result.push_back(Pair("index", (int)value.inputIndex));
+    result.push_back(Pair("height", value.blockHeight));
+    return result;
+}
+
 UniValue setmocktime(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
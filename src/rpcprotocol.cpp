@@ -61,6 +61,77 @@ UniValue JSONRPCError(int code, const string& message)
     return error;
 }
 
+JSONStreamWriter::JSONStreamWriter(size_t nChunkSizeIn, const Sink& sinkIn) :
+    nChunkSize(nChunkSizeIn), sink(sinkIn), fAbandoned(false)
+{
+    buffer.reserve(nChunkSize);
+}
+
+void JSONStreamWriter::Write(const UniValue& val)
+{
+    if (fAbandoned)
+        return;
+
+    switch (val.getType()) {
+    case UniValue::VARR: {
+        const std::vector<UniValue>& values = val.getValues();
+        buffer += '[';
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i > 0)
+                buffer += ',';
+            Write(values[i]);
+        }
+        buffer += ']';
+        break;
+    }
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& keys = val.getKeys();
+        const std::vector<UniValue>& values = val.getValues();
+        buffer += '{';
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (i > 0)
+                buffer += ',';
+            buffer += UniValue(keys[i]).write();
+            buffer += ':';
+            Write(values[i]);
+        }
+        buffer += '}';
+        break;
+    }
+    default:
+        buffer += val.write();
+        break;
+    }
+
+    if (buffer.size() >= nChunkSize && !fAbandoned) {
+        fAbandoned = !sink(buffer, false);
+        buffer.clear();
+    }
+}
+
+void JSONStreamWriter::WriteRaw(const std::string& str)
+{
+    if (!fAbandoned)
+        buffer += str;
+}
+
+void JSONStreamWriter::Finish()
+{
+    sink(fAbandoned ? std::string() : buffer, true);
+    buffer.clear();
+}
+
+void JSONRPCReplyStream(JSONStreamWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    writer.WriteRaw("{\"result\":");
+    writer.Write(error.isNull() ? result : NullUniValue);
+    writer.WriteRaw(",\"error\":");
+    writer.Write(error);
+    writer.WriteRaw(",\"id\":");
+    writer.Write(id);
+    writer.WriteRaw("}\n");
+}
+
 /** Username used when cookie authentication is in use (arbitrary, only for
  * recognizability in debugging/logging purposes)
  */
@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <string>
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
 
 #include <univalue.h>
 
@@ -81,6 +82,41 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
+/**
+ * Serializes JSON incrementally, handing the text to a sink in pieces of
+ * about nChunkSize bytes. Arrays and objects are walked element by element,
+ * so the largest temporary string is a single scalar rather than the whole
+ * document. The output is the same as UniValue::write() without indentation.
+ */
+class JSONStreamWriter
+{
+public:
+    /**
+     * Receives each piece of output; fFinal is set on the last call. Returning
+     * false means the output is no longer wanted, and the writer stops
+     * serializing until Finish().
+     */
+    typedef boost::function<bool(const std::string& strChunk, bool fFinal)> Sink;
+
+    JSONStreamWriter(size_t nChunkSizeIn, const Sink& sinkIn);
+
+    /** Append the serialization of val. */
+    void Write(const UniValue& val);
+    /** Append text that is already valid JSON (or whitespace). */
+    void WriteRaw(const std::string& str);
+    /** Pass whatever is still buffered to the sink as the final piece. */
+    void Finish();
+
+private:
+    size_t nChunkSize;
+    Sink sink;
+    std::string buffer;
+    bool fAbandoned;
+};
+
+/** Stream the same text as JSONRPCReply() without building the reply object. */
+void JSONRPCReplyStream(JSONStreamWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id);
+
 /** Get name of RPC authentication cookie file */
 boost::filesystem::path GetAuthCookieFile();
 /** Generate a new RPC authentication cookie and write it to disk */
@@ -14,7 +14,10 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <set>
 
 #include <univalue.h>
 
@@ -41,6 +44,14 @@ static std::vector<RPCTimerInterface*> timerInterfaces;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+/* Helper threads that run elements of JSON-RPC batches alongside the HTTP
+ * worker that received the batch (see JSONRPCExecBatch). */
+static CWaitableCriticalSection cs_rpcBatch;
+static CConditionVariable condRPCBatch;
+static std::deque<boost::function<void()> > rpcBatchTasks;
+static bool fRPCBatchStopping = false;
+static std::vector<boost::thread> rpcBatchThreads;
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -284,6 +295,8 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getblock",               &getblock,               true  },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true  },
+    { "blockchain",         "getcompactshieldedblock", &getcompactshieldedblock, true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
@@ -292,8 +305,15 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
+    /* Address index */
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        true  },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      true  },
+    { "addressindex",       "getspentinfo",           &getspentinfo,           true  },
+
     /* Mining */
     { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
     { "mining",             "getmininginfo",          &getmininginfo,          true  },
@@ -427,12 +447,55 @@ const CRPCCommand *CRPCTable::operator[](const std::string &name) const
     return (*it).second;
 }
 
+static void ThreadRPCBatch()
+{
+    RenameThread("zcash-rpcbatch");
+    while (true) {
+        boost::function<void()> task;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_rpcBatch);
+            while (!fRPCBatchStopping && rpcBatchTasks.empty())
+                condRPCBatch.wait(lock);
+            if (rpcBatchTasks.empty())
+                return;
+            task = rpcBatchTasks.front();
+            rpcBatchTasks.pop_front();
+        }
+        task();
+    }
+}
+
+void StartRPCBatchThreads(int nBatchConcurrency)
+{
+    // The thread serving a batch takes part too, so it needs one helper fewer
+    LogPrint("rpc", "Running up to %d calls of each read-only JSON-RPC batch in parallel\n", nBatchConcurrency);
+    fRPCBatchStopping = false;
+    for (int i = 1; i < nBatchConcurrency; i++)
+        rpcBatchThreads.emplace_back(&ThreadRPCBatch);
+}
+
+void StopRPCBatchThreads()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_rpcBatch);
+        fRPCBatchStopping = true;
+        condRPCBatch.notify_all();
+    }
+    for (boost::thread& thread : rpcBatchThreads)
+        thread.join();
+    rpcBatchThreads.clear();
+}
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
 
+    StartRPCBatchThreads(std::max((int)GetArg("-rpcbatchconcurrency", DEFAULT_RPC_BATCH_CONCURRENCY), 1));
+
+    getAsyncRPCQueue()->setMaxFinishedOperations(std::max<int64_t>(GetArg("-zoperationhistory", DEFAULT_ASYNC_RPC_OPERATION_HISTORY), 1));
+
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
 /*
@@ -463,6 +526,8 @@ void StopRPC()
     deadlineTimers.clear();
     g_rpcSignals.Stopped();
 
+    StopRPCBatchThreads();
+
     // Tells async queue to cancel all operations and shutdown.
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
@@ -524,10 +589,11 @@ void JSONRequest::parse(const UniValue& valRequest)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array");
 }
 
-static UniValue JSONRPCExecOne(const UniValue& req)
+static UniValue JSONRPCExecOne(const UniValue& req, size_t nIndex)
 {
     UniValue rpc_result(UniValue::VOBJ);
 
+    int64_t nTimeStart = GetTimeMicros();
     JSONRequest jreq;
     try {
         jreq.parse(req);
@@ -544,17 +610,96 @@ static UniValue JSONRPCExecOne(const UniValue& req)
         rpc_result = JSONRPCReplyObj(NullUniValue,
                                      JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
     }
+    LogPrint("rpc", "batch call %u (%s) took %.2fms\n", nIndex, jreq.strMethod, (GetTimeMicros() - nTimeStart) * 0.001);
 
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+/** Shared state of a batch whose calls are spread over several threads. */
+struct JSONRPCBatch
+{
+    const UniValue& vReq;
+    std::vector<UniValue> vResults;
+    //! Index of the next call to start
+    std::atomic<size_t> nNext;
+
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    size_t nDone;
+
+    JSONRPCBatch(const UniValue& vReqIn) :
+        vReq(vReqIn), vResults(vReqIn.size()), nNext(0), nDone(0) {}
+
+    /** Run calls until none are left to start. */
+    void Work()
+    {
+        size_t nIndex;
+        while ((nIndex = nNext++) < vResults.size()) {
+            vResults[nIndex] = JSONRPCExecOne(vReq[nIndex], nIndex);
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (++nDone == vResults.size())
+                cond.notify_all();
+        }
+    }
+};
+
+/**
+ * Methods that only read state, and so may run alongside each other. A batch
+ * is free to depend on the effects of its own earlier calls (a send followed
+ * by gettransaction, setban followed by listbanned), so anything else keeps
+ * the whole batch serial and in request order.
+ */
+static const std::set<std::string> setParallelBatchMethods = {
+    "getbestblockhash", "getblock", "getblockchaininfo", "getblockcount",
+    "getblockfilter", "getblockhash", "getblockheader", "getchaintips",
+    "getcompactshieldedblock", "getdifficulty", "getmempoolinfo",
+    "getrawmempool", "gettxout", "gettxoutproof", "verifytxoutproof",
+    "getaddressutxos", "getaddresstxids", "getaddressbalance", "getspentinfo",
+    "getconnectioncount", "getnettotals", "getnetworkinfo", "getpeerinfo",
+    "getmininginfo", "getblocksubsidy", "decoderawtransaction", "decodescript",
+    "getrawtransaction", "validateaddress", "z_validateaddress",
+    "verifymessage", "estimatefee", "estimatepriority",
+};
+
+static bool IsParallelBatch(const UniValue& vReq)
 {
+    for (size_t i = 0; i < vReq.size(); i++) {
+        if (!vReq[i].isObject())
+            return false;
+        const UniValue& method = find_value(vReq[i].get_obj(), "method");
+        if (!method.isStr() || !setParallelBatchMethods.count(method.get_str()))
+            return false;
+    }
+    return true;
+}
+
+UniValue JSONRPCExecBatch(const UniValue& vReq)
+{
+    // Calls are claimed in order from a shared counter by this thread and,
+    // when every call is read-only, by up to -rpcbatchconcurrency - 1
+    // helpers; results keep request order either way. Helpers that only get
+    // to run after every call has been claimed return straight away, and
+    // never touch vReq after this function returns.
+    std::shared_ptr<JSONRPCBatch> batch = std::make_shared<JSONRPCBatch>(vReq);
+    if (vReq.size() > 1 && IsParallelBatch(vReq)) {
+        boost::unique_lock<boost::mutex> lock(cs_rpcBatch);
+        size_t nHelpers = std::min((size_t)rpcBatchThreads.size(), vReq.size() - 1);
+        for (size_t i = 0; i < nHelpers; i++)
+            rpcBatchTasks.push_back(boost::bind(&JSONRPCBatch::Work, batch));
+        condRPCBatch.notify_all();
+    }
+    batch->Work();
+    {
+        boost::unique_lock<boost::mutex> lock(batch->cs);
+        while (batch->nDone < vReq.size())
+            batch->cond.wait(lock);
+    }
+
     UniValue ret(UniValue::VARR);
     for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+        ret.push_back(batch->vResults[reqIdx]);
 
-    return ret.write() + "\n";
+    return ret;
 }
 
 UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
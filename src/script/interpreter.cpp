@@ -1023,6 +1023,13 @@ public:
         ::WriteCompactSize(s, nInputs);
         for (unsigned int nInput = 0; nInput < nInputs; nInput++)
              SerializeInput(s, nInput, nType, nVersion);
+        SerializeTail(s, nType, nVersion);
+    }
+
+    /** Serialize everything after vin. This does not depend on the input being signed
+     *  unless the hash type is SIGHASH_SINGLE. */
+    template<typename S>
+    void SerializeTail(S &s, int nType, int nVersion) const {
         // Serialize vout
         unsigned int nOutputs = fHashNone ? 0 : (fHashSingle ? nIn+1 : txTo.vout.size());
         ::WriteCompactSize(s, nOutputs);
@@ -1050,9 +1057,107 @@ public:
     }
 };
 
+/** Serialization stream that appends to a byte vector. */
+class CByteVectorWriter
+{
+private:
+    std::vector<unsigned char>& vch;
+
+public:
+    explicit CByteVectorWriter(std::vector<unsigned char>& vchIn) : vch(vchIn) {}
+    void write(const char* pch, size_t size) { vch.insert(vch.end(), pch, pch + size); }
+};
+
+/** Serialization stream that feeds a SHA-256 hasher. */
+class CSHA256Writer
+{
+private:
+    CSHA256& ctx;
+
+public:
+    explicit CSHA256Writer(CSHA256& ctxIn) : ctx(ctxIn) {}
+    void write(const char* pch, size_t size) { ctx.Write((const unsigned char*)pch, size); }
+};
+
+/** A blanked-out input: prevout, an empty script and nSequence. */
+const size_t BLANKED_INPUT_SIZE = 32 + 4 + 1 + 4;
+
+/** Whether SignatureHash serializes this hash type like SIGHASH_ALL. */
+bool IsSigHashAllLike(int nHashType)
+{
+    return !(nHashType & SIGHASH_ANYONECANPAY) &&
+           (nHashType & 0x1f) != SIGHASH_SINGLE &&
+           (nHashType & 0x1f) != SIGHASH_NONE;
+}
+
 } // anon namespace
 
-uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+{
+    const CScript scriptCode;
+    CTransactionSignatureSerializer txTmp(txTo, scriptCode, NOT_AN_INPUT, SIGHASH_ALL);
+
+    CSHA256 hasher;
+    CSHA256Writer hw(hasher);
+    ::Serialize(hw, txTo.nVersion, SER_GETHASH, 0);
+    ::WriteCompactSize(hw, txTo.vin.size());
+
+    CByteVectorWriter inputs(vBlankedInputs);
+    vBlankedInputs.reserve(txTo.vin.size() * BLANKED_INPUT_SIZE);
+    vMidstate.reserve(txTo.vin.size() + 1);
+    vMidstate.push_back(hasher);
+    for (unsigned int i = 0; i < txTo.vin.size(); i++) {
+        txTmp.SerializeInput(inputs, i, SER_GETHASH, 0);
+        assert(vBlankedInputs.size() == (i + 1) * BLANKED_INPUT_SIZE);
+        hasher.Write(&vBlankedInputs[i * BLANKED_INPUT_SIZE], BLANKED_INPUT_SIZE);
+        vMidstate.push_back(hasher);
+    }
+
+    CByteVectorWriter tail(vTail);
+    txTmp.SerializeTail(tail, SER_GETHASH, 0);
+
+    if (txTo.nVersion >= 2 && !txTo.vjoinsplit.empty()) {
+        hashJoinSplit = ComputeSigHashAll(scriptCode, NOT_AN_INPUT, SIGHASH_ALL);
+    }
+    vSigHash.resize(txTo.vin.size());
+}
+
+uint256 PrecomputedTransactionData::ComputeSigHashAll(const CScript& scriptCode, unsigned int nIn, int nHashType) const
+{
+    CSHA256 hasher(nIn == NOT_AN_INPUT ? vMidstate.back() : vMidstate[nIn]);
+    if (nIn != NOT_AN_INPUT) {
+        // The input being signed carries scriptCode in place of the empty
+        // script; the inputs after it are blanked as usual.
+        const unsigned char* input = &vBlankedInputs[nIn * BLANKED_INPUT_SIZE];
+        CSHA256Writer hw(hasher);
+        hasher.Write(input, 32 + 4);
+        ::WriteCompactSize(hw, scriptCode.size());
+        hasher.Write(scriptCode.data(), scriptCode.size());
+        hasher.Write(input + 32 + 4 + 1, 4);
+        hasher.Write(input + BLANKED_INPUT_SIZE, vBlankedInputs.size() - (nIn + 1) * BLANKED_INPUT_SIZE);
+    }
+    hasher.Write(vTail.data(), vTail.size());
+    unsigned char hashtype[4];
+    WriteLE32(hashtype, nHashType);
+    hasher.Write(hashtype, sizeof(hashtype));
+
+    unsigned char buf[CSHA256::OUTPUT_SIZE];
+    uint256 result;
+    hasher.Finalize(buf);
+    CSHA256().Write(buf, sizeof(buf)).Finalize(result.begin());
+    return result;
+}
+
+size_t PrecomputedTransactionData::DynamicMemoryUsage() const
+{
+    // Each remembered signature hash keeps a copy of a scriptCode of at
+    // most MAX_SIGHASH_MEMO_SCRIPT_SIZE bytes.
+    return vMidstate.capacity() * sizeof(CSHA256) +
+           vBlankedInputs.capacity() + vTail.capacity() +
+           vSigHash.capacity() * (sizeof(SigHashEntry) + MAX_SIGHASH_MEMO_SCRIPT_SIZE);
+}
+
+uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache)
 {
     if (nIn >= txTo.vin.size() && nIn != NOT_AN_INPUT) {
         //  nIn out of range
@@ -1067,6 +1172,31 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
         }
     }
 
+    if (cache && IsSigHashAllLike(nHashType)) {
+        // The cache must have been built from txTo.
+        assert(cache->vMidstate.size() == txTo.vin.size() + 1);
+        if (nIn == NOT_AN_INPUT) {
+            return cache->ComputeSigHashAll(scriptCode, nIn, nHashType);
+        }
+        PrecomputedTransactionData::SigHashEntry& entry = cache->vSigHash[nIn];
+        {
+            std::lock_guard<std::mutex> lock(cache->cs_sighash);
+            if (entry.fSet && entry.nHashType == nHashType && entry.scriptCode == scriptCode) {
+                return entry.hash;
+            }
+        }
+        uint256 hash = cache->ComputeSigHashAll(scriptCode, nIn, nHashType);
+        if (scriptCode.size() > MAX_SIGHASH_MEMO_SCRIPT_SIZE) {
+            return hash;
+        }
+        std::lock_guard<std::mutex> lock(cache->cs_sighash);
+        entry.fSet = true;
+        entry.nHashType = nHashType;
+        entry.scriptCode = scriptCode;
+        entry.hash = hash;
+        return hash;
+    }
+
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
@@ -1096,7 +1226,7 @@ bool TransactionSignatureChecker::CheckSig(const vector<unsigned char>& vchSigIn
 
     uint256 sighash;
     try {
-        sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType);
+        sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, txdata);
     } catch (logic_error ex) {
         return false;
     }
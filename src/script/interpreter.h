@@ -7,12 +7,15 @@
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
 #include "script_error.h"
+#include "crypto/sha256.h"
 #include "primitives/transaction.h"
+#include "script/script.h"
 
 #include <vector>
 #include <stdint.h>
 #include <string>
 #include <climits>
+#include <mutex>
 
 class CPubKey;
 class CScript;
@@ -88,7 +91,65 @@ enum
     SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY = (1U << 9),
 };
 
-uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
+class PrecomputedTransactionData;
+
+/** Longest scriptCode whose signature hash PrecomputedTransactionData remembers. */
+static const size_t MAX_SIGHASH_MEMO_SCRIPT_SIZE = 128;
+
+uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache = NULL);
+
+/**
+ * The parts of a transaction's signature hashes that every input shares,
+ * computed once and reused by each SignatureHash() call for that transaction.
+ *
+ * The signature hash serializes the input being signed in the middle of the
+ * transaction, so the shared parts cannot be reduced to fixed-size digests
+ * without changing consensus rules. For SIGHASH_ALL this instead keeps the
+ * SHA-256 midstate in front of each input, the serialized blanked-out inputs,
+ * and the serialized tail (outputs, nLockTime and the JoinSplit section), so
+ * nothing is serialized again and the prefix is not rehashed. The finished
+ * hashes are remembered, so a transaction checked for the mempool does not
+ * hash again when its block is connected. Other hash types use the
+ * uncached path.
+ */
+class PrecomputedTransactionData
+{
+public:
+    explicit PrecomputedTransactionData(const CTransaction& tx);
+
+    /** The JoinSplit signature hash (SIGHASH_ALL over NOT_AN_INPUT), if the transaction has JoinSplits. */
+    const uint256& JoinSplitSigHash() const { return hashJoinSplit; }
+
+    /**
+     * Approximate heap usage, for bounding caches of these objects. This
+     * includes the signature hashes that may be remembered later, so it
+     * does not change once the object is built.
+     */
+    size_t DynamicMemoryUsage() const;
+
+private:
+    friend uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache);
+
+    uint256 ComputeSigHashAll(const CScript& scriptCode, unsigned int nIn, int nHashType) const;
+
+    //! Hash state after nVersion, the input count and blanked inputs 0..i-1.
+    std::vector<CSHA256> vMidstate;
+    //! Serialized blanked-out inputs, BLANKED_INPUT_SIZE bytes each.
+    std::vector<unsigned char> vBlankedInputs;
+    //! Serialized outputs, nLockTime and JoinSplit section.
+    std::vector<unsigned char> vTail;
+    uint256 hashJoinSplit;
+
+    struct SigHashEntry {
+        bool fSet = false;
+        int nHashType;
+        CScript scriptCode;
+        uint256 hash;
+    };
+    //! Finished signature hashes, one slot per input.
+    mutable std::vector<SigHashEntry> vSigHash;
+    mutable std::mutex cs_sighash;
+};
 
 class BaseSignatureChecker
 {
@@ -111,12 +172,13 @@ class TransactionSignatureChecker : public BaseSignatureChecker
 private:
     const CTransaction* txTo;
     unsigned int nIn;
+    const PrecomputedTransactionData* txdata;
 
 protected:
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
-    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn) : txTo(txToIn), nIn(nInIn) {}
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const PrecomputedTransactionData* txdataIn = NULL) : txTo(txToIn), nIn(nInIn), txdata(txdataIn) {}
     bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode) const;
     bool CheckLockTime(const CScriptNum& nLockTime) const;
 };
@@ -5,86 +5,151 @@
 
 #include "sigcache.h"
 
+#include "cuckoocache.h"
 #include "pubkey.h"
-#include "random.h"
 #include "uint256.h"
 #include "util.h"
 
-#include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
 
 namespace {
 
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
- * again when accepted into the block chain)
+ * again when accepted into the block chain). Entries are keyed by
+ * (signature hash, public key, signature).
  */
-class CSignatureCache
+class CSignatureCache : public CSaltedCuckooCache
+{
+public:
+    explicit CSignatureCache(size_t nBytes) : CSaltedCuckooCache(nBytes) {}
+
+    uint256 ComputeEntry(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey) const
+    {
+        uint256 entry;
+        SaltedHasher().Write(hash.begin(), 32).Write(pubKey.begin(), pubKey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+        return entry;
+    }
+};
+
+//! Set up once at startup, before script checking threads start
+std::unique_ptr<CSignatureCache> signatureCache;
+
+/**
+ * Signature hash data of recently checked transactions, by txid, evicting
+ * the least recently used once the size limit is reached. Sizes are
+ * measured when an entry is added, and cover what the entry may grow to.
+ */
+class CSigHashDataCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
-    boost::shared_mutex cs_sigcache;
+    typedef std::shared_ptr<const PrecomputedTransactionData> value_type;
+    typedef std::list<uint256> lru_type;
+    struct Entry {
+        value_type data;
+        size_t nUsage;
+        lru_type::iterator itLRU;
+    };
+    std::map<uint256, Entry> mapEntries;
+    lru_type lru;
+    size_t nUsage = 0;
+    std::atomic<size_t> nMaxUsage{(size_t)DEFAULT_MAX_SIGHASH_CACHE_SIZE << 20};
+    std::mutex cs_sighashcache;
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    void SetMaxUsage(size_t nMaxUsageIn)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+        nMaxUsage = nMaxUsageIn;
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    value_type Get(const CTransaction& tx)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
-
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+        const uint256& txid = tx.GetHash();
         {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
+            std::lock_guard<std::mutex> lock(cs_sighashcache);
+            std::map<uint256, Entry>::iterator it = mapEntries.find(txid);
+            if (it != mapEntries.end()) {
+                lru.splice(lru.begin(), lru, it->second.itLRU);
+                return it->second.data;
+            }
         }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+        value_type data = std::make_shared<const PrecomputedTransactionData>(tx);
+        size_t nEntryUsage = data->DynamicMemoryUsage() + sizeof(Entry) + sizeof(uint256);
+        if (nEntryUsage > nMaxUsage) {
+            return data;
+        }
+
+        std::lock_guard<std::mutex> lock(cs_sighashcache);
+        std::pair<std::map<uint256, Entry>::iterator, bool> ret = mapEntries.insert(std::make_pair(txid, Entry()));
+        if (!ret.second) {
+            // Another thread got there first.
+            return ret.first->second.data;
+        }
+        lru.push_front(txid);
+        ret.first->second.data = data;
+        ret.first->second.nUsage = nEntryUsage;
+        ret.first->second.itLRU = lru.begin();
+        nUsage += nEntryUsage;
+        while (nUsage > nMaxUsage) {
+            std::map<uint256, Entry>::iterator oldest = mapEntries.find(lru.back());
+            nUsage -= oldest->second.nUsage;
+            mapEntries.erase(oldest);
+            lru.pop_back();
+        }
+        return data;
     }
 };
 
+CSigHashDataCache sigHashDataCache;
+
 }
 
-bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+std::shared_ptr<const PrecomputedTransactionData> GetPrecomputedTransactionData(const CTransaction& tx)
+{
+    return sigHashDataCache.Get(tx);
+}
+
+void InitSignatureCache()
 {
-    static CSignatureCache signatureCache;
+    // -maxsigcachesize is in MiB.
+    int64_t nMaxSize = std::min(std::max((int64_t)0, GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE);
+    signatureCache.reset(new CSignatureCache((size_t)nMaxSize << 20));
+    CCuckooCacheStats stats = signatureCache->GetStats();
+    LogPrintf("Using %.1fMiB for the signature cache, able to store %u signatures\n",
+        stats.nBytes * (1.0 / 1024 / 1024), (unsigned int)stats.nSlots);
+
+    // -maxsighashcachesize is in MiB too.
+    sigHashDataCache.SetMaxUsage((size_t)std::max((int64_t)0, GetArg("-maxsighashcachesize", DEFAULT_MAX_SIGHASH_CACHE_SIZE)) << 20);
+}
 
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+CCuckooCacheStats GetSignatureCacheStats()
+{
+    if (!signatureCache)
+        return CCuckooCacheStats();
+    return signatureCache->GetStats();
+}
+
+bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    if (!signatureCache)
+        return TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash);
+
+    // Signatures checked for a block are not needed again once it is
+    // connected, so their entries are dropped to make room.
+    CacheMode mode = store ? CACHE_STORE : CACHE_ERASE;
+    uint256 entry = signatureCache->ComputeEntry(sighash, vchSig, pubkey);
+    if (signatureCache->Get(entry, mode))
         return true;
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
-    if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+    signatureCache->Set(entry, mode);
     return true;
 }
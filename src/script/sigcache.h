@@ -8,9 +8,18 @@
 
 #include "script/interpreter.h"
 
+#include <memory>
 #include <vector>
 
 class CPubKey;
+struct CCuckooCacheStats;
+
+/** Default for -maxsigcachesize, in megabytes. */
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+/** Largest -maxsigcachesize accepted, in megabytes. */
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+/** Default for -maxsighashcachesize, in megabytes. */
+static const unsigned int DEFAULT_MAX_SIGHASH_CACHE_SIZE = 32;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
@@ -18,9 +27,23 @@ private:
     bool store;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, bool storeIn=true) : TransactionSignatureChecker(txToIn, nInIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, bool storeIn=true, const PrecomputedTransactionData* txdataIn=NULL) : TransactionSignatureChecker(txToIn, nInIn, txdataIn), store(storeIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/**
+ * Return the signature hash data for tx, computing it on first use. Entries
+ * are kept by txid in a bounded cache, so a transaction checked when it
+ * enters the mempool does not repeat the work when its block is connected.
+ */
+std::shared_ptr<const PrecomputedTransactionData> GetPrecomputedTransactionData(const CTransaction& tx);
+
+/** Allocate the signature cache according to -maxsigcachesize, and apply
+ *  -maxsighashcachesize. Until it is called, signatures are not cached. */
+void InitSignatureCache();
+
+/** Size and hit counters of the signature cache. */
+CCuckooCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
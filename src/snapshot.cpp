@@ -0,0 +1,305 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "snapshot.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "main.h"
+#include "pow.h"
+#include "random.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <deque>
+#include <string.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+CSnapshotMetadata::CSnapshotMetadata() : nVersion(CURRENT_VERSION), nHeight(0), nTransactionOutputs(0), nTotalAmount(0), nNullifiers(0)
+{
+    memset(pchMessageStart, 0, sizeof(pchMessageStart));
+}
+
+uint256 CSnapshotMetadata::GetSnapshotHash() const
+{
+    return Hash(hashSerialized.begin(), hashSerialized.end(), hashShielded.begin(), hashShielded.end());
+}
+
+void ReadSnapshotChunk(CAutoFile& file, char& chType, CDataStream& payload)
+{
+    std::vector<char> vch;
+    uint256 hashChecksum;
+    file >> chType >> vch >> hashChecksum;
+    CHashWriter hasher(SER_GETHASH, 0);
+    hasher << chType << vch;
+    if (hasher.GetHash() != hashChecksum)
+        throw std::runtime_error("snapshot chunk checksum mismatch");
+    payload = CDataStream(vch, SER_DISK, CLIENT_VERSION);
+}
+
+bool DumpSnapshot(const boost::filesystem::path& path, CSnapshotMetadata& metadata, std::string& strError)
+{
+    int64_t nStart = GetTimeMillis();
+    std::vector<CBlockIndex*> vChain;
+    boost::scoped_ptr<CCoinsViewDBCursor> pcursor;
+    {
+        LOCK(cs_main);
+        if (!pcoinsdbview || !chainActive.Tip()) {
+            strError = "The chainstate is not loaded";
+            return false;
+        }
+        FlushStateToDisk();
+        // Hashing the coins takes a full scan, so only the cursor is taken
+        // here, once a background write has finished.
+        if ((pcoinsWriter && !pcoinsWriter->Wait()) || pcoinsdbview->GetBestBlock() != chainActive.Tip()->GetBlockHash()) {
+            strError = "Unable to write the coin database";
+            return false;
+        }
+        pcursor.reset(pcoinsdbview->Cursor());
+
+        metadata = CSnapshotMetadata();
+        memcpy(metadata.pchMessageStart, Params().MessageStart(), sizeof(metadata.pchMessageStart));
+        metadata.hashBlock = chainActive.Tip()->GetBlockHash();
+        metadata.nHeight = chainActive.Height();
+        metadata.hashAnchor = pcoinsTip->GetBestAnchor();
+
+        vChain.resize(chainActive.Height() + 1);
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex; pindex = pindex->pprev)
+            vChain[pindex->nHeight] = pindex;
+    }
+
+    unsigned short randv = 0;
+    GetRandBytes((unsigned char*)&randv, sizeof(randv));
+    boost::filesystem::path pathTmp = path.string() + strprintf(".%04x.incomplete", randv);
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        strError = strprintf("Unable to create %s", pathTmp.string());
+        return false;
+    }
+
+    size_t nRecords = 0;
+    try {
+        fileout << metadata;
+
+        // Block index entries are immutable once on the active chain apart
+        // from their status, which is read under cs_main a chunk at a time.
+        for (size_t nPos = 0; nPos < vChain.size(); nPos += SNAPSHOT_BLOCK_INDEX_CHUNK) {
+            boost::this_thread::interruption_point();
+            std::vector<CDiskBlockIndex> vIndex;
+            {
+                LOCK(cs_main);
+                size_t nEnd = std::min(vChain.size(), nPos + SNAPSHOT_BLOCK_INDEX_CHUNK);
+                for (size_t i = nPos; i < nEnd; i++) {
+                    CDiskBlockIndex diskindex(vChain[i]);
+                    // The loading node has none of the block or undo data,
+                    // and marks the entries assumed valid itself.
+                    diskindex.nStatus &= ~(BLOCK_HAVE_MASK | BLOCK_ASSUMED_VALID);
+                    diskindex.nFile = 0;
+                    diskindex.nDataPos = 0;
+                    diskindex.nUndoPos = 0;
+                    vIndex.push_back(diskindex);
+                }
+            }
+            WriteSnapshotChunk(fileout, SNAPSHOT_CHUNK_BLOCK_INDEX, vIndex);
+        }
+
+        SnapshotRecords vRecords;
+        while (pcursor->ReadChunk(vRecords, SNAPSHOT_CHUNK_SIZE)) {
+            boost::this_thread::interruption_point();
+            WriteSnapshotChunk(fileout, SNAPSHOT_CHUNK_CHAINSTATE, vRecords);
+            nRecords += vRecords.size();
+        }
+        WriteSnapshotChunk(fileout, SNAPSHOT_CHUNK_END, metadata.hashBlock);
+
+        // The header has a fixed size, so it is filled in where it was
+        // written now that the cursor has hashed every record.
+        const CCoinsDBStats& stats = pcursor->GetStats();
+        stats.muhash.Finalize(metadata.hashSerialized.begin());
+        metadata.hashShielded = pcursor->GetShieldedHash(metadata.hashAnchor);
+        metadata.nTransactionOutputs = stats.nTransactionOutputs;
+        metadata.nTotalAmount = stats.nTotalAmount;
+        metadata.nNullifiers = stats.nNullifiers;
+        if (fseek(fileout.Get(), 0, SEEK_SET))
+            throw std::runtime_error("unable to seek to the header");
+        fileout << metadata;
+    } catch (const std::exception& e) {
+        fileout.fclose();
+        boost::filesystem::remove(pathTmp);
+        strError = strprintf("Error writing snapshot: %s", e.what());
+        return false;
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path)) {
+        boost::filesystem::remove(pathTmp);
+        strError = strprintf("Unable to rename %s to %s", pathTmp.string(), path.string());
+        return false;
+    }
+    LogPrintf("Wrote snapshot of block %s (%u block index entries, %u records) to %s in %dms\n",
+        metadata.hashBlock.ToString(), (unsigned int)vChain.size(), (unsigned int)nRecords, path.string(), GetTimeMillis() - nStart);
+    return true;
+}
+
+/**
+ * Check that the snapshot described by metadata is one the node was told to
+ * trust, either by the chain parameters or by -assumesnapshot. Its own
+ * hashes only show that the file is intact, not that its contents are right.
+ */
+static bool CheckExpectedSnapshot(const CChainParams& chainparams, const CSnapshotMetadata& metadata, std::string& strError)
+{
+    std::vector<CSnapshotData> vExpected = chainparams.Snapshots();
+    BOOST_FOREACH(const std::string& strArg, mapMultiArgs["-assumesnapshot"]) {
+        std::vector<std::string> vParts;
+        boost::split(vParts, strArg, boost::is_any_of(":"));
+        int32_t nHeight;
+        if (vParts.size() != 3 || !ParseInt32(vParts[0], &nHeight) || nHeight < 0 ||
+            vParts[1].size() != 64 || !IsHex(vParts[1]) || vParts[2].size() != 64 || !IsHex(vParts[2])) {
+            strError = strprintf("Invalid -assumesnapshot value %s, expected <height>:<block hash>:<snapshot hash>", strArg);
+            return false;
+        }
+        CSnapshotData data = {nHeight, uint256S(vParts[1]), uint256S(vParts[2])};
+        vExpected.push_back(data);
+    }
+    BOOST_FOREACH(const CSnapshotData& data, vExpected) {
+        if (data.nHeight == metadata.nHeight && data.hashBlock == metadata.hashBlock && data.hashSnapshot == metadata.GetSnapshotHash())
+            return true;
+    }
+    strError = strprintf("The snapshot of block %s at height %d with snapshot hash %s is not one this node trusts. "
+        "Check it against the hash_snapshot that dumptxoutset reported on a node you trust, then pass -assumesnapshot=%d:%s:%s",
+        metadata.hashBlock.GetHex(), metadata.nHeight, metadata.GetSnapshotHash().GetHex(),
+        metadata.nHeight, metadata.hashBlock.GetHex(), metadata.GetSnapshotHash().GetHex());
+    return false;
+}
+
+bool LoadSnapshot(const boost::filesystem::path& path, CBlockTreeDB* blocktree, CCoinsViewDB* coinsdb, std::string& strError)
+{
+    const CChainParams& chainparams = Params();
+    int64_t nStart = GetTimeMillis();
+
+    FILE* file = fopen(path.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        strError = strprintf("Unable to open snapshot %s", path.string());
+        return false;
+    }
+
+    try {
+        CSnapshotMetadata metadata;
+        filein >> metadata;
+        if (metadata.nVersion != CSnapshotMetadata::CURRENT_VERSION) {
+            strError = strprintf("Unsupported snapshot version %d", metadata.nVersion);
+            return false;
+        }
+        if (memcmp(metadata.pchMessageStart, chainparams.MessageStart(), sizeof(metadata.pchMessageStart))) {
+            strError = "The snapshot is for a different network";
+            return false;
+        }
+        if (!CheckExpectedSnapshot(chainparams, metadata, strError))
+            return false;
+        LogPrintf("Loading snapshot of block %s at height %d with snapshot hash %s\n",
+            metadata.hashBlock.ToString(), metadata.nHeight, metadata.GetSnapshotHash().ToString());
+
+        // The most recent headers, enough for GetNextWorkRequired and the
+        // median time past; the oldest one is unlinked as it is dropped.
+        const Consensus::Params& consensusParams = chainparams.GetConsensus();
+        const MapCheckpoints& checkpoints = chainparams.Checkpoints().mapCheckpoints;
+        const size_t nWindow = consensusParams.nPowAveragingWindow + CBlockIndex::nMedianTimeSpan + 1;
+        std::deque<CBlockIndex> vWindow;
+
+        uint256 hashPrev;
+        int nBlocks = 0;
+        size_t nRecords = 0;
+        while (true) {
+            boost::this_thread::interruption_point();
+            char chType;
+            CDataStream payload(SER_DISK, CLIENT_VERSION);
+            ReadSnapshotChunk(filein, chType, payload);
+            if (chType == SNAPSHOT_CHUNK_BLOCK_INDEX) {
+                std::vector<CDiskBlockIndex> vIndex;
+                payload >> vIndex;
+                // The entries must form a chain of headers from our genesis
+                // block that would each pass ContextualCheckBlockHeader.
+                BOOST_FOREACH(CDiskBlockIndex& diskindex, vIndex) {
+                    CBlockHeader header = diskindex.GetBlockHeader();
+                    uint256 hash = header.GetHash();
+                    CBlockIndex* pindexPrev = vWindow.empty() ? NULL : &vWindow.back();
+                    MapCheckpoints::const_iterator itCheckpoint = checkpoints.find(nBlocks);
+                    if (diskindex.hashPrev != hashPrev || diskindex.nHeight != nBlocks ||
+                        (nBlocks == 0 && hash != consensusParams.hashGenesisBlock) ||
+                        (diskindex.nStatus & ~BLOCK_VALID_MASK & ~BLOCK_ACTIVATES_UPGRADE) ||
+                        !CheckProofOfWork(hash, diskindex.nBits, consensusParams) ||
+                        !CheckEquihashSolution(&header, chainparams) ||
+                        (pindexPrev && header.nBits != GetNextWorkRequired(pindexPrev, &header, consensusParams)) ||
+                        (pindexPrev && header.GetBlockTime() <= pindexPrev->GetMedianTimePast()) ||
+                        (itCheckpoint != checkpoints.end() && itCheckpoint->second != hash)) {
+                        strError = strprintf("Invalid block index entry at height %d in snapshot", nBlocks);
+                        return false;
+                    }
+                    diskindex.nStatus |= BLOCK_ASSUMED_VALID;
+
+                    vWindow.push_back(CBlockIndex());
+                    CBlockIndex& index = vWindow.back();
+                    index.nHeight = nBlocks;
+                    index.nTime = header.nTime;
+                    index.nBits = header.nBits;
+                    index.pprev = pindexPrev;
+                    if (vWindow.size() > nWindow) {
+                        vWindow.pop_front();
+                        vWindow.front().pprev = NULL;
+                    }
+
+                    hashPrev = hash;
+                    nBlocks++;
+                }
+                if (!blocktree->WriteSnapshotBlockIndex(vIndex)) {
+                    strError = "Error writing snapshot to the block index";
+                    return false;
+                }
+            } else if (chType == SNAPSHOT_CHUNK_CHAINSTATE) {
+                SnapshotRecords vRecords;
+                payload >> vRecords;
+                if (!coinsdb->WriteSnapshotRecords(vRecords)) {
+                    strError = "Error writing snapshot to the coin database";
+                    return false;
+                }
+                nRecords += vRecords.size();
+            } else if (chType == SNAPSHOT_CHUNK_END) {
+                break;
+            } else {
+                strError = strprintf("Unknown chunk type %d in snapshot", (int)chType);
+                return false;
+            }
+        }
+        if (hashPrev != metadata.hashBlock || nBlocks != metadata.nHeight + 1) {
+            strError = "The snapshot block index does not end at the snapshot block";
+            return false;
+        }
+
+        // Blocks below the snapshot are not on disk, just as if they had
+        // been pruned.
+        if (!blocktree->WriteFlag("prunedblockfiles", true) || !blocktree->Sync()) {
+            strError = "Error writing snapshot to the block index";
+            return false;
+        }
+        if (!coinsdb->FinishSnapshot(metadata.hashBlock, metadata.hashAnchor, metadata.hashSerialized, metadata.hashShielded)) {
+            strError = "The coins, nullifiers or anchors in the snapshot do not match its hashes";
+            return false;
+        }
+        LogPrintf("Loaded snapshot (%d block index entries, %u records) in %dms\n",
+            nBlocks, (unsigned int)nRecords, GetTimeMillis() - nStart);
+    } catch (const std::exception& e) {
+        strError = strprintf("Error reading snapshot: %s", e.what());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SNAPSHOT_H
+#define BITCOIN_SNAPSHOT_H
+
+#include "amount.h"
+#include "clientversion.h"
+#include "hash.h"
+#include "serialize.h"
+#include "streams.h"
+#include "txdb.h"
+#include "uint256.h"
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+/**
+ * A chainstate snapshot file holds a header followed by chunks, each with
+ * its own checksum. The block index chunks come first and cover the active
+ * chain up to the snapshot block, without block or undo positions. The
+ * chainstate chunks hold the raw coins, nullifier and anchor records of the
+ * coin database in key order, so that loading them writes sequentially.
+ */
+static const char SNAPSHOT_CHUNK_BLOCK_INDEX = 'b';
+static const char SNAPSHOT_CHUNK_CHAINSTATE = 'c';
+static const char SNAPSHOT_CHUNK_END = 'e';
+
+//! Target size of a chainstate chunk
+static const size_t SNAPSHOT_CHUNK_SIZE = 1 << 20;
+//! Number of block index entries per chunk
+static const size_t SNAPSHOT_BLOCK_INDEX_CHUNK = 1000;
+
+/** Header of a chainstate snapshot, describing the state it holds. */
+class CSnapshotMetadata
+{
+public:
+    static const int CURRENT_VERSION = 2;
+
+    int nVersion;
+    unsigned char pchMessageStart[4];
+    uint256 hashBlock;
+    int nHeight;
+    uint256 hashAnchor;
+    //! gettxoutsetinfo's hash_serialized at hashBlock
+    uint256 hashSerialized;
+    //! Hash of the nullifier and anchor records and of hashAnchor
+    uint256 hashShielded;
+    uint64_t nTransactionOutputs;
+    CAmount nTotalAmount;
+    uint64_t nNullifiers;
+
+    CSnapshotMetadata();
+
+    //! The hash a trusted snapshot is named by, covering both set hashes.
+    uint256 GetSnapshotHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(this->nVersion);
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(hashAnchor);
+        READWRITE(hashSerialized);
+        READWRITE(hashShielded);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nTotalAmount);
+        READWRITE(nNullifiers);
+    }
+};
+
+/** Write a chunk: its type, the serialized payload and a checksum of both. */
+template <typename T>
+void WriteSnapshotChunk(CAutoFile& file, char chType, const T& payload)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << payload;
+    std::vector<char> vch(ss.begin(), ss.end());
+    CHashWriter hasher(SER_GETHASH, 0);
+    hasher << chType << vch;
+    file << chType << vch << hasher.GetHash();
+}
+
+/** Read the type and payload of a chunk, throwing if its checksum does not match. */
+void ReadSnapshotChunk(CAutoFile& file, char& chType, CDataStream& payload);
+
+/**
+ * Write the current chainstate to path. The coin database is flushed and
+ * then read and hashed without holding cs_main, so the node keeps running
+ * meanwhile. The header is written again at the end, once the hashes are
+ * known.
+ */
+bool DumpSnapshot(const boost::filesystem::path& path, CSnapshotMetadata& metadata, std::string& strError);
+
+/**
+ * Load a snapshot into empty block index and coin databases. Only snapshots
+ * named by the chain parameters or -assumesnapshot are accepted, and their
+ * headers are checked as if received from a peer; the loaded entries are
+ * marked BLOCK_ASSUMED_VALID. The best block is only set once the coins,
+ * nullifiers and anchors have been checked against the snapshot hash, so an
+ * interrupted load is simply started again.
+ */
+bool LoadSnapshot(const boost::filesystem::path& path, CBlockTreeDB* blocktree, CCoinsViewDB* coinsdb, std::string& strError);
+
+#endif // BITCOIN_SNAPSHOT_H
@@ -59,6 +59,8 @@ namespace libsnark {
                                  const G2_precomp<EC_ppT> &prec_Q1,
                                  const G1_precomp<EC_ppT> &prec_P2,
                                  const G2_precomp<EC_ppT> &prec_Q2);
+  Fqk<EC_ppT> multi_miller_loop(const std::vector<std::pair<const G1_precomp<EC_ppT>*,
+                                                           const G2_precomp<EC_ppT>*> > &terms);
 
   Fqk<EC_ppT> pairing(const G1<EC_ppT> &P,
                       const G2<EC_ppT> &Q);
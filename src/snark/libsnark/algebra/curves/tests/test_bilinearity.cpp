@@ -72,6 +72,34 @@ void double_miller_loop_test()
     EXPECT_EQ(ans_1 * ans_2, ans_12);
 }
 
+template<typename ppT>
+void multi_miller_loop_test()
+{
+    std::vector<G1_precomp<ppT> > prec_P;
+    std::vector<G2_precomp<ppT> > prec_Q;
+    Fqk<ppT> expected = Fqk<ppT>::one();
+    for (size_t i = 0; i < 5; ++i)
+    {
+        prec_P.emplace_back(ppT::precompute_G1((Fr<ppT>::random_element()) * G1<ppT>::one()));
+        prec_Q.emplace_back(ppT::precompute_G2((Fr<ppT>::random_element()) * G2<ppT>::one()));
+        expected = expected * ppT::miller_loop(prec_P[i], prec_Q[i]);
+    }
+
+    std::vector<std::pair<const G1_precomp<ppT>*, const G2_precomp<ppT>*> > terms;
+    EXPECT_EQ(ppT::multi_miller_loop(terms), Fqk<ppT>::one());
+    for (size_t i = 0; i < prec_P.size(); ++i)
+    {
+        terms.emplace_back(&prec_P[i], &prec_Q[i]);
+    }
+    EXPECT_EQ(ppT::multi_miller_loop(terms), expected);
+
+    const std::vector<std::pair<const G1_precomp<ppT>*, const G2_precomp<ppT>*> > two_terms = {
+        { &prec_P[0], &prec_Q[0] },
+        { &prec_P[1], &prec_Q[1] },
+    };
+    EXPECT_EQ(ppT::multi_miller_loop(two_terms), ppT::double_miller_loop(prec_P[0], prec_Q[0], prec_P[1], prec_Q[1]));
+}
+
 template<typename ppT>
 void affine_pairing_test()
 {
@@ -112,6 +140,7 @@ TEST(algebra, bilinearity)
     alt_bn128_pp::init_public_params();
     pairing_test<alt_bn128_pp>();
     double_miller_loop_test<alt_bn128_pp>();
+    multi_miller_loop_test<alt_bn128_pp>();
 
 #ifdef CURVE_BN128       // BN128 has fancy dependencies so it may be disabled
     bn128_pp::init_public_params();
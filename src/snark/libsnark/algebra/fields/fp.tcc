@@ -22,6 +22,13 @@ namespace libsnark {
 template<mp_size_t n, const bigint<n>& modulus>
 void Fp_model<n,modulus>::mul_reduce(const bigint<n> &other)
 {
+#if defined(__x86_64__) && defined(USE_ADX)
+    if (n == 4 && modulus.data[n-1] < (1ul << 62) && cpu_supports_adx())
+    { // use MULX/ADCX/ADOX "CIOS method", selected at runtime
+        MONT_ADX_MUL_4(this->mont_repr.data, this->mont_repr.data, other.data, inv, modulus.data);
+        return;
+    }
+#endif
     /* stupid pre-processor tricks; beware */
 #if defined(__x86_64__) && defined(USE_ASM)
     if (n == 3)
@@ -576,7 +583,14 @@ Fp_model<n,modulus> Fp_model<n,modulus>::squared() const
 {
 #ifdef PROFILE_OP_COUNTS
     this->sqr_cnt++;
-    this->mul_cnt--; // zero out the upcoming mul
+#endif
+#if defined(__x86_64__) && defined(USE_ADX)
+    if (n == 4 && modulus.data[n-1] < (1ul << 62) && cpu_supports_adx())
+    { // MULX/ADCX/ADOX kernel writes straight into the result, no copy through operator*=
+        Fp_model<n, modulus> r;
+        MONT_ADX_MUL_4(r.mont_repr.data, this->mont_repr.data, this->mont_repr.data, inv, modulus.data);
+        return r;
+    }
 #endif
     /* stupid pre-processor tricks; beware */
 #if defined(__x86_64__) && defined(USE_ASM)
@@ -614,6 +628,9 @@ Fp_model<n,modulus> Fp_model<n,modulus>::squared() const
     else
 #endif
     {
+#ifdef PROFILE_OP_COUNTS
+        this->mul_cnt--; // zero out the upcoming mul
+#endif
         Fp_model<n, modulus> r(*this);
         return (r *= r);
     }
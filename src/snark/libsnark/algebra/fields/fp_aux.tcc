@@ -1,9 +1,9 @@
 /** @file
  *****************************************************************************
  Assembly code snippets for F[p] finite field arithmetic, used by fp.tcc .
- Specific to x86-64, and used only if USE_ASM is defined.
- On other architectures or without USE_ASM, fp.tcc uses a portable
- C++ implementation instead.
+ Specific to x86-64, and used only if USE_ASM (or, for the MULX/ADX
+ kernels, USE_ADX) is defined. On other architectures or without these,
+ fp.tcc uses a portable C++ implementation instead.
  *****************************************************************************
  * @author     This file is part of libsnark, developed by SCIPR Lab
  *             and contributors (see AUTHORS).
@@ -13,6 +13,10 @@
 #ifndef FP_AUX_TCC_
 #define FP_AUX_TCC_
 
+#if defined(__x86_64__) && defined(USE_ADX)
+#include <cpuid.h>
+#endif
+
 namespace libsnark {
 
 #define STR_HELPER(x) #x
@@ -385,5 +389,116 @@ namespace libsnark {
          : [modprime] "r" (inv_), [res] "r" (res_), [mod] "r" (mod_) \
          : "%rax", "%rdx", "cc", "memory")
 
+/*
+  4-limb Montgomery multiplication using the BMI2/ADX instructions MULX,
+  ADCX and ADOX. MULX does not touch the flags, so the low and high halves
+  of each partial product can be accumulated on two independent carry
+  chains (CF via ADCX, OF via ADOX) without spilling carries.
+
+  This is the CIOS method with the "no-carry" optimization: for a modulus
+  whose most significant limb is below 2^62, the running sum always fits in
+  five limbs and stays below 2*modulus, so no sixth carry word is needed and
+  a single conditional subtraction at the end suffices. Callers must check
+  this condition and that the CPU supports BMI2 and ADX (see
+  cpu_supports_adx) before using this macro.
+
+  The five accumulator registers are renamed on every iteration instead of
+  being shifted, so that after iteration i the limb that became zero is
+  reused as the new most significant limb.
+ */
+#if defined(__x86_64__) && defined(USE_ADX)
+/* CPUID leaf 7, subleaf 0: EBX bit 8 is BMI2 (MULX), EBX bit 19 is ADX */
+inline bool cpu_supports_adx()
+{
+    static const bool supported = []() {
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid_max(0, nullptr) < 7) {
+            return false;
+        }
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        return (ebx & (1u << 8)) != 0 && (ebx & (1u << 19)) != 0;
+    }();
+    return supported;
+}
+#endif
+
+#define MONT_ADX_MULROW(ofs, r0, r1, r2, r3, r4)       \
+    "xorl    %%eax, %%eax                 \n\t"       \
+    "movq    " STR(ofs) "(%[B]), %%rdx    \n\t"       \
+    "mulxq   0(%[A]), %[lo], %[hi]        \n\t"       \
+    "adoxq   %[lo], %[" #r0 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r1 "]            \n\t"       \
+    "mulxq   8(%[A]), %[lo], %[hi]        \n\t"       \
+    "adoxq   %[lo], %[" #r1 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r2 "]            \n\t"       \
+    "mulxq   16(%[A]), %[lo], %[hi]       \n\t"       \
+    "adoxq   %[lo], %[" #r2 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r3 "]            \n\t"       \
+    "mulxq   24(%[A]), %[lo], %[hi]       \n\t"       \
+    "adoxq   %[lo], %[" #r3 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r4 "]            \n\t"       \
+    "adoxq   %%rax, %[" #r4 "]            \n\t"
+
+#define MONT_ADX_REDROW(r0, r1, r2, r3, r4)            \
+    "movq    %[" #r0 "], %%rdx            \n\t"       \
+    "imulq   %[inv], %%rdx                \n\t"       \
+    "xorl    %%eax, %%eax                 \n\t"       \
+    "mulxq   0(%[M]), %[lo], %[hi]        \n\t"       \
+    "adoxq   %[lo], %[" #r0 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r1 "]            \n\t"       \
+    "mulxq   8(%[M]), %[lo], %[hi]        \n\t"       \
+    "adoxq   %[lo], %[" #r1 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r2 "]            \n\t"       \
+    "mulxq   16(%[M]), %[lo], %[hi]       \n\t"       \
+    "adoxq   %[lo], %[" #r2 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r3 "]            \n\t"       \
+    "mulxq   24(%[M]), %[lo], %[hi]       \n\t"       \
+    "adoxq   %[lo], %[" #r3 "]            \n\t"       \
+    "adcxq   %[hi], %[" #r4 "]            \n\t"       \
+    "adoxq   %%rax, %[" #r4 "]            \n\t"
+
+/* res = A * B * R^-1 mod M, where R = 2^256; res may alias A or B */
+#define MONT_ADX_MUL_4(res_, A_, B_, inv_, mod_)                           \
+    do {                                                                  \
+        mp_limb_t t0_, t1_, t2_, t3_, t4_, lo_, hi_;                      \
+        __asm__ volatile                                                  \
+            ("xorq    %[t0], %[t0]                 \n\t"                 \
+             "xorq    %[t1], %[t1]                 \n\t"                 \
+             "xorq    %[t2], %[t2]                 \n\t"                 \
+             "xorq    %[t3], %[t3]                 \n\t"                 \
+             "xorq    %[t4], %[t4]                 \n\t"                 \
+             MONT_ADX_MULROW(0, t0, t1, t2, t3, t4)                       \
+             MONT_ADX_REDROW(t0, t1, t2, t3, t4)                          \
+             MONT_ADX_MULROW(8, t1, t2, t3, t4, t0)                       \
+             MONT_ADX_REDROW(t1, t2, t3, t4, t0)                          \
+             MONT_ADX_MULROW(16, t2, t3, t4, t0, t1)                      \
+             MONT_ADX_REDROW(t2, t3, t4, t0, t1)                          \
+             MONT_ADX_MULROW(24, t3, t4, t0, t1, t2)                      \
+             MONT_ADX_REDROW(t3, t4, t0, t1, t2)                          \
+             "/* result is (t4, t0, t1, t2) < 2*mod; subtract mod if it does not borrow */ \n\t" \
+             "movq    %[t4], %[lo]                 \n\t"                 \
+             "movq    %[t0], %[hi]                 \n\t"                 \
+             "movq    %[t1], %%rax                 \n\t"                 \
+             "movq    %[t2], %%rdx                 \n\t"                 \
+             "subq    0(%[M]), %[lo]               \n\t"                 \
+             "sbbq    8(%[M]), %[hi]               \n\t"                 \
+             "sbbq    16(%[M]), %%rax              \n\t"                 \
+             "sbbq    24(%[M]), %%rdx              \n\t"                 \
+             "cmovncq %[lo], %[t4]                 \n\t"                 \
+             "cmovncq %[hi], %[t0]                 \n\t"                 \
+             "cmovncq %%rax, %[t1]                 \n\t"                 \
+             "cmovncq %%rdx, %[t2]                 \n\t"                 \
+             "movq    %[t4], 0(%[res])             \n\t"                 \
+             "movq    %[t0], 8(%[res])             \n\t"                 \
+             "movq    %[t1], 16(%[res])            \n\t"                 \
+             "movq    %[t2], 24(%[res])            \n\t"                 \
+             : [t0] "=&r" (t0_), [t1] "=&r" (t1_), [t2] "=&r" (t2_),    \
+               [t3] "=&r" (t3_), [t4] "=&r" (t4_),                        \
+               [lo] "=&r" (lo_), [hi] "=&r" (hi_)                         \
+             : [res] "r" (res_), [A] "r" (A_), [B] "r" (B_),              \
+               [inv] "m" (inv_), [M] "r" (mod_)                           \
+             : "%rax", "%rdx", "cc", "memory");                           \
+    } while (0)
+
 } // libsnark
 #endif // FP_AUX_TCC_
@@ -50,6 +50,33 @@ void test_field()
 
 }
 
+template<typename FieldT>
+void test_mul_against_mpn()
+{
+    /* Cross-check Montgomery multiplication (including any assembly kernel
+       selected at runtime) against plain GMP multiplication and division */
+    const mp_size_t n = FieldT::num_limbs;
+    const FieldT minus_one = -FieldT::one();
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        const FieldT a = (i % 10 == 0) ? minus_one : FieldT::random_element();
+        const FieldT b = (i % 10 == 1) ? minus_one : FieldT::random_element();
+        const bigint<n> a_int = a.as_bigint();
+        const bigint<n> b_int = b.as_bigint();
+
+        mp_limb_t prod[2*n];
+        mpn_mul_n(prod, a_int.data, b_int.data, n);
+        mp_limb_t q[n+1];
+        bigint<n> expected;
+        mpn_tdiv_qr(q, expected.data, 0, prod, 2*n, FieldT::mod.data, n);
+
+        EXPECT_EQ((a * b).as_bigint(), expected);
+        EXPECT_EQ(a * b, FieldT(expected));
+    }
+    EXPECT_EQ(minus_one * minus_one, FieldT::one());
+    EXPECT_EQ(minus_one.squared(), FieldT::one());
+}
+
 template<typename FieldT>
 void test_sqrt()
 {
@@ -102,6 +129,9 @@ void test_all_fields()
     test_field<Fqe<ppT> >();
     test_field<Fqk<ppT> >();
 
+    test_mul_against_mpn<Fr<ppT> >();
+    test_mul_against_mpn<Fq<ppT> >();
+
     test_sqrt<Fr<ppT> >();
     test_sqrt<Fq<ppT> >();
     test_sqrt<Fqe<ppT> >();
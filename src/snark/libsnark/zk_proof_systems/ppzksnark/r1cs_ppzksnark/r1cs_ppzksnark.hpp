@@ -241,6 +241,10 @@ public:
     G1_precomp<ppT> vk_gamma_beta_g1_precomp;
     G2_precomp<ppT> vk_gamma_beta_g2_precomp;
 
+    /* kept in non-precomputed form so the online verifier can combine them with proof elements */
+    G1<ppT> vk_alphaB_g1;
+    G1<ppT> vk_gamma_beta_g1;
+
     accumulation_vector<G1<ppT> > encoded_IC_query;
 
     bool operator==(const r1cs_ppzksnark_processed_verification_key &other) const;
@@ -447,6 +451,9 @@ r1cs_ppzksnark_processed_verification_key<ppT> r1cs_ppzksnark_verifier_process_v
  * A verifier algorithm for the R1CS ppzkSNARK that:
  * (1) accepts a processed verification key, and
  * (2) has weak input consistency.
+ *
+ * The pairing checks are batched with random coefficients into a single
+ * multi-Miller loop and final exponentiation.
  */
 template<typename ppT>
 bool r1cs_ppzksnark_online_verifier_weak_IC(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
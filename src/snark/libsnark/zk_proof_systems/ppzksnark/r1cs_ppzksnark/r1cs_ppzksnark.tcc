@@ -124,6 +124,8 @@ bool r1cs_ppzksnark_processed_verification_key<ppT>::operator==(const r1cs_ppzks
             this->vk_gamma_g2_precomp == other.vk_gamma_g2_precomp &&
             this->vk_gamma_beta_g1_precomp == other.vk_gamma_beta_g1_precomp &&
             this->vk_gamma_beta_g2_precomp == other.vk_gamma_beta_g2_precomp &&
+            this->vk_alphaB_g1 == other.vk_alphaB_g1 &&
+            this->vk_gamma_beta_g1 == other.vk_gamma_beta_g1 &&
             this->encoded_IC_query == other.encoded_IC_query);
 }
 
@@ -138,6 +140,8 @@ std::ostream& operator<<(std::ostream &out, const r1cs_ppzksnark_processed_verif
     out << pvk.vk_gamma_g2_precomp << OUTPUT_NEWLINE;
     out << pvk.vk_gamma_beta_g1_precomp << OUTPUT_NEWLINE;
     out << pvk.vk_gamma_beta_g2_precomp << OUTPUT_NEWLINE;
+    out << pvk.vk_alphaB_g1 << OUTPUT_NEWLINE;
+    out << pvk.vk_gamma_beta_g1 << OUTPUT_NEWLINE;
     out << pvk.encoded_IC_query << OUTPUT_NEWLINE;
 
     return out;
@@ -162,6 +166,10 @@ std::istream& operator>>(std::istream &in, r1cs_ppzksnark_processed_verification
     consume_OUTPUT_NEWLINE(in);
     in >> pvk.vk_gamma_beta_g2_precomp;
     consume_OUTPUT_NEWLINE(in);
+    in >> pvk.vk_alphaB_g1;
+    consume_OUTPUT_NEWLINE(in);
+    in >> pvk.vk_gamma_beta_g1;
+    consume_OUTPUT_NEWLINE(in);
     in >> pvk.encoded_IC_query;
     consume_OUTPUT_NEWLINE(in);
 
@@ -668,6 +676,8 @@ r1cs_ppzksnark_processed_verification_key<ppT> r1cs_ppzksnark_verifier_process_v
     pvk.vk_gamma_g2_precomp      = ppT::precompute_G2(vk.gamma_g2);
     pvk.vk_gamma_beta_g1_precomp = ppT::precompute_G1(vk.gamma_beta_g1);
     pvk.vk_gamma_beta_g2_precomp = ppT::precompute_G2(vk.gamma_beta_g2);
+    pvk.vk_alphaB_g1             = vk.alphaB_g1;
+    pvk.vk_gamma_beta_g1         = vk.gamma_beta_g1;
 
     pvk.encoded_IC_query = vk.encoded_IC_query;
 
@@ -691,54 +701,66 @@ bool r1cs_ppzksnark_online_verifier_weak_IC(const r1cs_ppzksnark_processed_verif
         return false;
     }
 
-    G1_precomp<ppT> proof_g_A_g_precomp      = ppT::precompute_G1(proof.g_A.g);
-    G1_precomp<ppT> proof_g_A_h_precomp = ppT::precompute_G1(proof.g_A.h);
-    Fqk<ppT> kc_A_1 = ppT::miller_loop(proof_g_A_g_precomp,      pvk.vk_alphaA_g2_precomp);
-    Fqk<ppT> kc_A_2 = ppT::miller_loop(proof_g_A_h_precomp, pvk.pp_G2_one_precomp);
-    GT<ppT> kc_A = ppT::final_exponentiation(kc_A_1 * kc_A_2.unitary_inverse());
-    if (kc_A != GT<ppT>::one())
+    /* The checks below are combined using bilinearity in the first
+       argument, which only holds if g_B.g is in the order-r subgroup of G2. */
+    if (!(Fr<ppT>::field_char() * proof.g_B.g).is_zero())
     {
         return false;
     }
 
-    G2_precomp<ppT> proof_g_B_g_precomp      = ppT::precompute_G2(proof.g_B.g);
-    G1_precomp<ppT> proof_g_B_h_precomp = ppT::precompute_G1(proof.g_B.h);
-    Fqk<ppT> kc_B_1 = ppT::miller_loop(pvk.vk_alphaB_g1_precomp, proof_g_B_g_precomp);
-    Fqk<ppT> kc_B_2 = ppT::miller_loop(proof_g_B_h_precomp,    pvk.pp_G2_one_precomp);
-    GT<ppT> kc_B = ppT::final_exponentiation(kc_B_1 * kc_B_2.unitary_inverse());
-    if (kc_B != GT<ppT>::one())
-    {
-        return false;
-    }
-
-    G1_precomp<ppT> proof_g_C_g_precomp      = ppT::precompute_G1(proof.g_C.g);
-    G1_precomp<ppT> proof_g_C_h_precomp = ppT::precompute_G1(proof.g_C.h);
-    Fqk<ppT> kc_C_1 = ppT::miller_loop(proof_g_C_g_precomp,      pvk.vk_alphaC_g2_precomp);
-    Fqk<ppT> kc_C_2 = ppT::miller_loop(proof_g_C_h_precomp, pvk.pp_G2_one_precomp);
-    GT<ppT> kc_C = ppT::final_exponentiation(kc_C_1 * kc_C_2.unitary_inverse());
-    if (kc_C != GT<ppT>::one())
+    /*
+      The verifier has five pairing product checks (knowledge commitments
+      for A, B and C, the QAP divisibility check, and the same-coefficient
+      check for K). Each one has the form prod_j e(P_j, Q_j) = 1. Instead of
+      evaluating them separately, raise check i to a random 128-bit
+      exponent r_i (r_1 = 1) and test that the product of all of them is 1.
+      Since GT has prime order r, a failing check makes the product equal 1
+      with probability at most 2^-128.
+
+      Raising e(P, Q) to r_i is done by scaling P, and pairings that share
+      the same Q are merged. This leaves a single multi-Miller loop over
+      seven pairs and a single final exponentiation.
+    */
+    const mp_size_t coeff_limbs = 128 / GMP_NUMB_BITS;
+    bigint<coeff_limbs> r2, r3, r4, r5;
+    for (bigint<coeff_limbs> *r : { &r2, &r3, &r4, &r5 })
     {
-        return false;
-    }
-
-    // check that g^((A+acc)*B)=g^(H*\Prod(t-\sigma)+C)
-    // equivalently, via pairings, that e(g^(A+acc), g^B) = e(g^H, g^Z) + e(g^C, g^1)
-    G1_precomp<ppT> proof_g_A_g_acc_precomp = ppT::precompute_G1(proof.g_A.g + acc);
-    G1_precomp<ppT> proof_g_H_precomp       = ppT::precompute_G1(proof.g_H);
-    Fqk<ppT> QAP_1  = ppT::miller_loop(proof_g_A_g_acc_precomp,  proof_g_B_g_precomp);
-    Fqk<ppT> QAP_23  = ppT::double_miller_loop(proof_g_H_precomp, pvk.vk_rC_Z_g2_precomp, proof_g_C_g_precomp, pvk.pp_G2_one_precomp);
-    GT<ppT> QAP = ppT::final_exponentiation(QAP_1 * QAP_23.unitary_inverse());
-    if (QAP != GT<ppT>::one())
-    {
-        return false;
+        do
+        {
+            r->randomize();
+        } while (r->is_zero());
     }
 
-    G1_precomp<ppT> proof_g_K_precomp = ppT::precompute_G1(proof.g_K);
-    G1_precomp<ppT> proof_g_A_g_acc_C_precomp = ppT::precompute_G1((proof.g_A.g + acc) + proof.g_C.g);
-    Fqk<ppT> K_1 = ppT::miller_loop(proof_g_K_precomp, pvk.vk_gamma_g2_precomp);
-    Fqk<ppT> K_23 = ppT::double_miller_loop(proof_g_A_g_acc_C_precomp, pvk.vk_gamma_beta_g2_precomp, pvk.vk_gamma_beta_g1_precomp, proof_g_B_g_precomp);
-    GT<ppT> K = ppT::final_exponentiation(K_1 * K_23.unitary_inverse());
-    if (K != GT<ppT>::one())
+    const G1<ppT> A_g_acc = proof.g_A.g + acc;
+
+    /* e(A_g, alpha_A) / e(A_h, 1) */
+    G1_precomp<ppT> kc_A_g_precomp = ppT::precompute_G1(proof.g_A.g);
+    /* e(C_g, alpha_C) / e(C_h, 1), scaled by r3 */
+    G1_precomp<ppT> kc_C_g_precomp = ppT::precompute_G1(r3 * proof.g_C.g);
+    /* e(A_g + acc, B_g) / (e(H, rC_Z) e(C_g, 1)), scaled by r4 */
+    G1_precomp<ppT> QAP_H_precomp = ppT::precompute_G1(-(r4 * proof.g_H));
+    /* e(K, gamma) / (e(A_g + acc + C_g, gamma_beta_g2) e(gamma_beta_g1, B_g)), scaled by r5 */
+    G1_precomp<ppT> K_K_precomp = ppT::precompute_G1(r5 * proof.g_K);
+    G1_precomp<ppT> K_A_g_acc_C_precomp = ppT::precompute_G1(-(r5 * (A_g_acc + proof.g_C.g)));
+    /* all terms paired with B_g: e(alpha_B, B_g) from kc_B, scaled by r2, and the QAP and K terms */
+    G1_precomp<ppT> B_g_terms_precomp = ppT::precompute_G1(r2 * pvk.vk_alphaB_g1 + r4 * A_g_acc - r5 * pvk.vk_gamma_beta_g1);
+    /* all terms paired with the G2 generator: A_h, B_h (scaled by r2), C_h (scaled by r3) and C_g from the QAP check (scaled by r4) */
+    G1_precomp<ppT> one_terms_precomp = ppT::precompute_G1(-(proof.g_A.h + r2 * proof.g_B.h + r3 * proof.g_C.h + r4 * proof.g_C.g));
+
+    G2_precomp<ppT> proof_g_B_g_precomp = ppT::precompute_G2(proof.g_B.g);
+
+    const std::vector<std::pair<const G1_precomp<ppT>*, const G2_precomp<ppT>*> > terms = {
+        { &kc_A_g_precomp,      &pvk.vk_alphaA_g2_precomp },
+        { &kc_C_g_precomp,      &pvk.vk_alphaC_g2_precomp },
+        { &QAP_H_precomp,       &pvk.vk_rC_Z_g2_precomp },
+        { &K_K_precomp,         &pvk.vk_gamma_g2_precomp },
+        { &K_A_g_acc_C_precomp, &pvk.vk_gamma_beta_g2_precomp },
+        { &B_g_terms_precomp,   &proof_g_B_g_precomp },
+        { &one_terms_precomp,   &pvk.pp_G2_one_precomp },
+    };
+
+    GT<ppT> result = ppT::final_exponentiation(ppT::multi_miller_loop(terms));
+    if (result != GT<ppT>::one())
     {
         return false;
     }
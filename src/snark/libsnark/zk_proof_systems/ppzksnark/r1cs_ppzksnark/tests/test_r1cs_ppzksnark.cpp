@@ -10,6 +10,8 @@
  *****************************************************************************/
 #include <cassert>
 #include <cstdio>
+#include <functional>
+#include <vector>
 
 #include "algebra/curves/alt_bn128/alt_bn128_pp.hpp"
 #include "common/profiling.hpp"
@@ -36,6 +38,48 @@ void test_r1cs_ppzksnark(size_t num_constraints,
     print_header("(leave) Test R1CS ppzkSNARK");
 }
 
+template<typename ppT>
+void test_r1cs_ppzksnark_rejects_tampered_proof(size_t num_constraints,
+                                                size_t input_size)
+{
+    r1cs_example<Fr<ppT> > example = generate_r1cs_example_with_binary_input<Fr<ppT> >(num_constraints, input_size);
+    example.constraint_system.swap_AB_if_beneficial();
+    r1cs_ppzksnark_keypair<ppT> keypair = r1cs_ppzksnark_generator<ppT>(example.constraint_system);
+    r1cs_ppzksnark_processed_verification_key<ppT> pvk = r1cs_ppzksnark_verifier_process_vk<ppT>(keypair.vk);
+    r1cs_ppzksnark_proof<ppT> proof = r1cs_ppzksnark_prover<ppT>(keypair.pk, example.primary_input, example.auxiliary_input, example.constraint_system);
+    EXPECT_TRUE(r1cs_ppzksnark_online_verifier_strong_IC<ppT>(pvk, example.primary_input, proof));
+
+    /* every pairing check is folded into one batched check, so each proof element must still be bound */
+    const G1<ppT> g1 = G1<ppT>::one();
+    const G2<ppT> g2 = G2<ppT>::one();
+    const std::vector<std::function<void(r1cs_ppzksnark_proof<ppT>&)> > tamperings = {
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_A.g = p.g_A.g + g1; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_A.h = p.g_A.h + g1; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_B.g = p.g_B.g + g2; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_B.h = p.g_B.h + g1; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_C.g = p.g_C.g + g1; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_C.h = p.g_C.h + g1; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_H = p.g_H + g1; },
+        [&](r1cs_ppzksnark_proof<ppT> &p) { p.g_K = p.g_K + g1; },
+    };
+    for (const auto &tamper : tamperings)
+    {
+        r1cs_ppzksnark_proof<ppT> bad_proof = proof;
+        tamper(bad_proof);
+        EXPECT_FALSE(r1cs_ppzksnark_online_verifier_strong_IC<ppT>(pvk, example.primary_input, bad_proof));
+    }
+
+    r1cs_ppzksnark_primary_input<ppT> bad_input = example.primary_input;
+    bad_input[0] = bad_input[0] + Fr<ppT>::one();
+    EXPECT_FALSE(r1cs_ppzksnark_online_verifier_strong_IC<ppT>(pvk, bad_input, proof));
+}
+
+TEST(zk_proof_systems, r1cs_ppzksnark_rejects_tampered_proof)
+{
+    alt_bn128_pp::init_public_params();
+    test_r1cs_ppzksnark_rejects_tampered_proof<alt_bn128_pp>(100, 10);
+}
+
 TEST(zk_proof_systems, r1cs_ppzksnark)
 {
     start_profiling();
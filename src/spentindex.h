@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SPENTINDEX_H
+#define BITCOIN_SPENTINDEX_H
+
+#include "amount.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+/** A spent transparent output. */
+struct CSpentIndexKey
+{
+    uint256 txid;
+    unsigned int outputIndex;
+
+    CSpentIndexKey() : outputIndex(0) {}
+    CSpentIndexKey(const uint256& txidIn, unsigned int outputIndexIn) : txid(txidIn), outputIndex(outputIndexIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(txid);
+        READWRITE(outputIndex);
+    }
+};
+
+/**
+ * The input spending a CSpentIndexKey, with the value and address of the
+ * output it spends. A null value erases the entry.
+ */
+struct CSpentIndexValue
+{
+    uint256 txid;
+    unsigned int inputIndex;
+    int blockHeight;
+    CAmount satoshis;
+    //! AddressIndexType of the output, and its address if it has one
+    uint8_t addressType;
+    uint160 addressHash;
+
+    CSpentIndexValue() { SetNull(); }
+    CSpentIndexValue(const uint256& txidIn, unsigned int inputIndexIn, int blockHeightIn,
+                     CAmount satoshisIn, uint8_t addressTypeIn, const uint160& addressHashIn) :
+        txid(txidIn), inputIndex(inputIndexIn), blockHeight(blockHeightIn),
+        satoshis(satoshisIn), addressType(addressTypeIn), addressHash(addressHashIn) {}
+
+    void SetNull() {
+        txid.SetNull();
+        inputIndex = 0;
+        blockHeight = 0;
+        satoshis = 0;
+        addressType = 0;
+        addressHash.SetNull();
+    }
+
+    bool IsNull() const { return txid.IsNull(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(txid);
+        READWRITE(inputIndex);
+        READWRITE(blockHeight);
+        READWRITE(satoshis);
+        READWRITE(addressType);
+        READWRITE(addressHash);
+    }
+};
+
+#endif // BITCOIN_SPENTINDEX_H
@@ -15,6 +15,7 @@
 #include <limits>
 #include <map>
 #include <set>
+#include <stdexcept>
 #include <stdint.h>
 #include <stdio.h>
 #include <string>
@@ -325,6 +326,85 @@ public:
 
 };
 
+/** Reads bits, most significant first, from a byte stream. */
+template <typename IStream>
+class BitStreamReader
+{
+private:
+    IStream& m_istream;
+    //! Buffered byte read from the stream, and how many of its bits, from
+    //! the most significant down, have not been read yet.
+    uint8_t m_buffer;
+    int m_offset;
+
+public:
+    explicit BitStreamReader(IStream& istream) : m_istream(istream), m_buffer(0), m_offset(8) {}
+
+    //! Read nbits (at most 64) bits and return them as the low bits of an
+    //! integer. Throws std::ios_base::failure at the end of the stream.
+    uint64_t Read(int nbits) {
+        if (nbits < 0 || nbits > 64)
+            throw std::out_of_range("BitStreamReader::Read(): invalid number of bits");
+
+        uint64_t data = 0;
+        while (nbits > 0) {
+            if (m_offset == 8) {
+                m_buffer = ser_readdata8(m_istream);
+                m_offset = 0;
+            }
+            int bits = std::min(8 - m_offset, nbits);
+            data <<= bits;
+            data |= static_cast<uint8_t>(m_buffer << m_offset) >> (8 - bits);
+            m_offset += bits;
+            nbits -= bits;
+        }
+        return data;
+    }
+};
+
+/** Writes bits, most significant first, to a byte stream. */
+template <typename OStream>
+class BitStreamWriter
+{
+private:
+    OStream& m_ostream;
+    //! Byte being filled, and how many of its bits have been written.
+    uint8_t m_buffer;
+    int m_offset;
+
+public:
+    explicit BitStreamWriter(OStream& ostream) : m_ostream(ostream), m_buffer(0), m_offset(0) {}
+
+    ~BitStreamWriter() {
+        Flush();
+    }
+
+    //! Write the nbits (at most 64) low bits of data.
+    void Write(uint64_t data, int nbits) {
+        if (nbits < 0 || nbits > 64)
+            throw std::out_of_range("BitStreamWriter::Write(): invalid number of bits");
+
+        while (nbits > 0) {
+            int bits = std::min(8 - m_offset, nbits);
+            m_buffer |= (data << (64 - nbits)) >> (64 - 8 + m_offset);
+            m_offset += bits;
+            nbits -= bits;
+
+            if (m_offset == 8)
+                Flush();
+        }
+    }
+
+    //! Write the partly filled byte, if any, padded with zero bits.
+    void Flush() {
+        if (m_offset == 0)
+            return;
+        ser_writedata8(m_ostream, m_buffer);
+        m_buffer = 0;
+        m_offset = 0;
+    }
+};
+
 
 
 
@@ -0,0 +1,217 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "script/script.h"
+#include "streams.h"
+#include "undo.h"
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(bitstream_reader_writer)
+{
+    CDataStream stream(SER_NETWORK, 0);
+    {
+        BitStreamWriter<CDataStream> bitwriter(stream);
+        bitwriter.Write(0, 1);
+        bitwriter.Write(2, 2);
+        bitwriter.Write(6, 3);
+        bitwriter.Write(11, 4);
+        bitwriter.Write(1, 5);
+        bitwriter.Write(32, 6);
+        bitwriter.Write(7, 7);
+        bitwriter.Write(30497, 16);
+        bitwriter.Write(0x0123456789abcdefULL, 64);
+    }
+    // 1 + 2 + 3 + 4 + 5 + 6 + 7 + 16 + 64 bits, padded to 14 bytes.
+    BOOST_CHECK_EQUAL(stream.size(), 14);
+
+    BitStreamReader<CDataStream> bitreader(stream);
+    BOOST_CHECK_EQUAL(bitreader.Read(1), 0);
+    BOOST_CHECK_EQUAL(bitreader.Read(2), 2);
+    BOOST_CHECK_EQUAL(bitreader.Read(3), 6);
+    BOOST_CHECK_EQUAL(bitreader.Read(4), 11);
+    BOOST_CHECK_EQUAL(bitreader.Read(5), 1);
+    BOOST_CHECK_EQUAL(bitreader.Read(6), 32);
+    BOOST_CHECK_EQUAL(bitreader.Read(7), 7);
+    BOOST_CHECK_EQUAL(bitreader.Read(16), 30497);
+    BOOST_CHECK_EQUAL(bitreader.Read(64), 0x0123456789abcdefULL);
+    // Only the padding bits are left.
+    BOOST_CHECK_EQUAL(bitreader.Read(2), 0);
+    BOOST_CHECK_THROW(bitreader.Read(8), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(gcs_match)
+{
+    CGolombCodedSet::ElementSet included, excluded;
+    for (int i = 0; i < 100; ++i) {
+        CGolombCodedSet::Element element1(32, 0);
+        element1[0] = i;
+        included.insert(element1);
+
+        CGolombCodedSet::Element element2(32, 1);
+        element2[0] = i;
+        excluded.insert(element2);
+    }
+
+    CGolombCodedSet filter(0, 0, 10, 1 << 10, included);
+    BOOST_CHECK_EQUAL(filter.GetN(), 100);
+    BOOST_CHECK(filter.MatchAny(included));
+    BOOST_FOREACH(const CGolombCodedSet::Element& element, included) {
+        BOOST_CHECK(filter.Match(element));
+
+        CGolombCodedSet::ElementSet query = excluded;
+        query.insert(element);
+        BOOST_CHECK(filter.MatchAny(query));
+    }
+
+    // With M = 1024, a few of the excluded elements may match.
+    int nFalsePositives = 0;
+    BOOST_FOREACH(const CGolombCodedSet::Element& element, excluded) {
+        if (filter.Match(element))
+            nFalsePositives++;
+    }
+    BOOST_CHECK(nFalsePositives < 5);
+
+    // A decoded set matches the same elements.
+    CGolombCodedSet decoded(0, 0, 10, 1 << 10, filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), 100);
+    BOOST_CHECK(decoded.GetEncoded() == filter.GetEncoded());
+    BOOST_FOREACH(const CGolombCodedSet::Element& element, included) {
+        BOOST_CHECK(decoded.Match(element));
+    }
+
+    // Truncated and extended encodings are rejected.
+    std::vector<unsigned char> vchTruncated(filter.GetEncoded().begin(), filter.GetEncoded().end() - 1);
+    BOOST_CHECK_THROW(CGolombCodedSet(0, 0, 10, 1 << 10, vchTruncated), std::ios_base::failure);
+    std::vector<unsigned char> vchExtended = filter.GetEncoded();
+    vchExtended.push_back(0);
+    BOOST_CHECK_THROW(CGolombCodedSet(0, 0, 10, 1 << 10, vchExtended), std::ios_base::failure);
+
+    // An empty set matches nothing.
+    CGolombCodedSet empty(0, 0, 10, 1 << 10, CGolombCodedSet::ElementSet());
+    BOOST_CHECK_EQUAL(empty.GetN(), 0);
+    BOOST_CHECK_EQUAL(empty.GetEncoded().size(), 1);
+    BOOST_CHECK(!empty.MatchAny(included));
+}
+
+BOOST_AUTO_TEST_CASE(block_filter)
+{
+    CScript scriptIncluded1 = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript scriptIncluded2 = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 2) << OP_EQUAL;
+    CScript scriptSpent = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUAL;
+    CScript scriptOpReturn = CScript() << OP_RETURN << std::vector<unsigned char>(4, 4);
+    CScript scriptOther = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 5) << OP_EQUAL;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.push_back(CTxOut(100, scriptIncluded1));
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    tx.vout.push_back(CTxOut(10, scriptIncluded2));
+    tx.vout.push_back(CTxOut(0, scriptOpReturn));
+    tx.vout.push_back(CTxOut(0, CScript()));
+
+    CBlock block;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(tx);
+    CBlockUndo blockundo;
+    blockundo.vtxundo.resize(1);
+    blockundo.vtxundo[0].vprevout.push_back(CTxInUndo(CTxOut(20, scriptSpent)));
+
+    CBlockFilter filter(block, blockundo);
+    BOOST_CHECK(filter.GetBlockHash() == block.GetHash());
+    const CGolombCodedSet& gcs = filter.GetFilter();
+    BOOST_CHECK_EQUAL(gcs.GetN(), 3);
+    BOOST_CHECK(gcs.Match(CGolombCodedSet::Element(scriptIncluded1.begin(), scriptIncluded1.end())));
+    BOOST_CHECK(gcs.Match(CGolombCodedSet::Element(scriptIncluded2.begin(), scriptIncluded2.end())));
+    BOOST_CHECK(gcs.Match(CGolombCodedSet::Element(scriptSpent.begin(), scriptSpent.end())));
+    BOOST_CHECK(!gcs.Match(CGolombCodedSet::Element(scriptOpReturn.begin(), scriptOpReturn.end())));
+    BOOST_CHECK(!gcs.Match(CGolombCodedSet::Element(scriptOther.begin(), scriptOther.end())));
+
+    // A filter decoded with the block hash is the same filter.
+    CBlockFilter decoded(block.GetHash(), filter.GetEncoded());
+    BOOST_CHECK(decoded.GetHash() == filter.GetHash());
+    BOOST_CHECK(decoded.GetFilter().Match(CGolombCodedSet::Element(scriptSpent.begin(), scriptSpent.end())));
+
+    // The header commits to the filter and the previous header.
+    uint256 hashPrevHeader = GetRandHash();
+    uint256 hashFilter = filter.GetHash();
+    BOOST_CHECK(filter.GetHash() == Hash(filter.GetEncoded().begin(), filter.GetEncoded().end()));
+    BOOST_CHECK(filter.ComputeHeader(hashPrevHeader) ==
+                Hash(hashFilter.begin(), hashFilter.end(), hashPrevHeader.begin(), hashPrevHeader.end()));
+    BOOST_CHECK(filter.ComputeHeader(hashPrevHeader) != filter.ComputeHeader(uint256()));
+}
+
+BOOST_AUTO_TEST_CASE(compact_shielded_block)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.push_back(CTxOut(100, CScript() << OP_TRUE));
+
+    CMutableTransaction tx;
+    tx.nVersion = 2;
+    tx.joinSplitPubKey = GetRandHash();
+    JSDescription jsdesc;
+    jsdesc.nullifiers[0] = GetRandHash();
+    jsdesc.nullifiers[1] = GetRandHash();
+    jsdesc.commitments[0] = GetRandHash();
+    jsdesc.commitments[1] = GetRandHash();
+    jsdesc.ephemeralKey = GetRandHash();
+    jsdesc.randomSeed = GetRandHash();
+    for (size_t i = 0; i < ZC_NUM_JS_OUTPUTS; i++)
+        GetRandBytes(jsdesc.ciphertexts[i].begin(), jsdesc.ciphertexts[i].size());
+    tx.vjoinsplit.push_back(jsdesc);
+
+    CBlock block;
+    block.hashPrevBlock = GetRandHash();
+    block.nTime = 1500000000;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(tx);
+
+    CCompactShieldedBlock compact = BuildCompactShieldedBlock(block, 42);
+    BOOST_CHECK(compact.hashBlock == block.GetHash());
+    BOOST_CHECK(compact.hashPrevBlock == block.hashPrevBlock);
+    BOOST_CHECK_EQUAL(compact.nHeight, 42);
+    BOOST_CHECK_EQUAL(compact.nTime, block.nTime);
+    // The coinbase has no JoinSplits, so it is left out.
+    BOOST_REQUIRE_EQUAL(compact.vtx.size(), 1);
+    BOOST_CHECK(compact.vtx[0].txid == block.vtx[1].GetHash());
+    BOOST_CHECK_EQUAL(compact.vtx[0].index, 1);
+    BOOST_REQUIRE_EQUAL(compact.vtx[0].vjoinsplit.size(), 1);
+
+    const CCompactJoinSplit& cjs = compact.vtx[0].vjoinsplit[0];
+    BOOST_CHECK(cjs.nullifiers == jsdesc.nullifiers);
+    BOOST_CHECK(cjs.commitments == jsdesc.commitments);
+    BOOST_CHECK(cjs.ephemeralKey == jsdesc.ephemeralKey);
+    BOOST_CHECK(cjs.h_sig == ZCJoinSplit::h_sig(jsdesc.randomSeed, jsdesc.nullifiers, tx.joinSplitPubKey));
+    for (size_t i = 0; i < ZC_NUM_JS_OUTPUTS; i++) {
+        BOOST_CHECK_EQUAL(cjs.ciphertextPrefixes[i].size(), COMPACT_CIPHERTEXT_SIZE);
+        BOOST_CHECK(std::equal(cjs.ciphertextPrefixes[i].begin(), cjs.ciphertextPrefixes[i].end(), jsdesc.ciphertexts[i].begin()));
+    }
+
+    // Round trip through serialization
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << compact;
+    CCompactShieldedBlock compact2;
+    ss >> compact2;
+    BOOST_CHECK(compact2.hashBlock == compact.hashBlock);
+    BOOST_REQUIRE_EQUAL(compact2.vtx.size(), 1);
+    BOOST_REQUIRE_EQUAL(compact2.vtx[0].vjoinsplit.size(), 1);
+    BOOST_CHECK(compact2.vtx[0].vjoinsplit[0].h_sig == cjs.h_sig);
+    BOOST_CHECK(compact2.vtx[0].vjoinsplit[0].ciphertextPrefixes == cjs.ciphertextPrefixes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
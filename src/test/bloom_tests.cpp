@@ -537,4 +537,38 @@ BOOST_AUTO_TEST_CASE(rolling_bloom)
     }
 }
 
+BOOST_AUTO_TEST_CASE(blocked_bloom)
+{
+    CBlockedBloomFilter filter(10000);
+    std::vector<uint256> keys;
+    for (int i = 0; i < 10000; i++) {
+        keys.push_back(GetRandHash());
+        filter.insert(keys.back());
+    }
+    BOOST_CHECK_EQUAL(filter.size(), 10000U);
+    BOOST_CHECK(!filter.IsSaturated());
+
+    // No false negatives.
+    for (unsigned int i = 0; i < keys.size(); i++) {
+        BOOST_CHECK(filter.contains(keys[i]));
+    }
+
+    // At 16 bits per key the false positive rate is about 0.1%, so we
+    // expect about 100 hits when testing 100,000 random keys.
+    unsigned int nHits = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (filter.contains(GetRandHash()))
+            ++nHits;
+    }
+    BOOST_TEST_MESSAGE("BlockedBloomFilter got " << nHits << " false positives (~100 expected)");
+    BOOST_CHECK(nHits < 400);
+
+    filter.insert(GetRandHash());
+    BOOST_CHECK(filter.IsSaturated());
+
+    filter.clear();
+    BOOST_CHECK_EQUAL(filter.size(), 0U);
+    BOOST_CHECK(!filter.contains(keys[0]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,8 @@
 #include "test/test_bitcoin.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "snapshot.h"
+#include "txdb.h"
 #include "undo.h"
 #include "pubkey.h"
 
@@ -631,6 +633,7 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     bool updated_an_entry = false;
     bool found_an_entry = false;
     bool missed_an_entry = false;
+    bool synced_a_cache = false;
 
     // A simple map to track what we expect the cache stack to represent.
     std::map<uint256, CCoins> result;
@@ -690,6 +693,13 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
 
         if (insecure_rand() % 100 == 0) {
             // Every 100 iterations, change the cache stack.
+            if (stack.size() > 0 && insecure_rand() % 4 == 0) {
+                // Write out the top cache, keeping all, some or none of it.
+                size_t nUsage = stack.back()->DynamicMemoryUsage();
+                stack.back()->Sync(insecure_rand() % 3 == 0 ? nUsage : insecure_rand() % (nUsage + 1));
+                stack.back()->SelfTest();
+                synced_a_cache = true;
+            }
             if (stack.size() > 0 && insecure_rand() % 2 == 0) {
                 stack.back()->Flush();
                 delete stack.back();
@@ -724,6 +734,115 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(updated_an_entry);
     BOOST_CHECK(found_an_entry);
     BOOST_CHECK(missed_an_entry);
+    BOOST_CHECK(synced_a_cache);
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_background_flush, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewBackgroundWriter writer(&db);
+    CCoinsViewCacheTest cache(&writer);
+    std::map<uint256, CCoins> result;
+
+    std::vector<uint256> txids;
+    txids.resize(1000);
+    for (unsigned int i = 0; i < txids.size(); i++) {
+        txids[i] = GetRandHash();
+    }
+
+    uint256 hashBlock;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 500; i++) {
+            uint256 txid = txids[insecure_rand() % txids.size()];
+            CCoins& coins = result[txid];
+            CCoinsModifier entry = cache.ModifyCoins(txid);
+            BOOST_CHECK(coins == *entry);
+            if (insecure_rand() % 4 == 0 && !coins.IsPruned()) {
+                coins.Clear();
+                entry->Clear();
+            } else {
+                coins.nVersion = 1;
+                coins.vout.resize(1);
+                coins.vout[0].nValue = insecure_rand();
+                *entry = coins;
+            }
+        }
+        hashBlock = GetRandHash();
+        cache.SetBestBlock(hashBlock);
+        size_t nUsage = cache.DynamicMemoryUsage();
+        BOOST_CHECK(cache.Sync(round % 2 ? nUsage : nUsage / 4));
+        BOOST_CHECK(cache.DynamicMemoryUsage() <= nUsage);
+        cache.SelfTest();
+
+        // Whether or not the write has completed, a view on top of the
+        // writer and the cache itself see the same state.
+        CCoinsViewCache view(&writer);
+        BOOST_CHECK(view.GetBestBlock() == hashBlock);
+        for (std::map<uint256, CCoins>::iterator it = result.begin(); it != result.end(); it++) {
+            const CCoins* coins = view.AccessCoins(it->first);
+            BOOST_CHECK(coins ? *coins == it->second : it->second.IsPruned());
+            coins = cache.AccessCoins(it->first);
+            BOOST_CHECK(coins ? *coins == it->second : it->second.IsPruned());
+        }
+    }
+
+    BOOST_CHECK(writer.Wait());
+    BOOST_CHECK(db.GetBestBlock() == hashBlock);
+    for (std::map<uint256, CCoins>::iterator it = result.begin(); it != result.end(); it++) {
+        CCoins coins;
+        if (db.GetCoins(it->first, coins)) {
+            BOOST_CHECK(coins == it->second);
+        } else {
+            BOOST_CHECK(it->second.IsPruned());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coins_sync_evicts_anchors_and_nullifiers)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    std::vector<uint256> nullifiers;
+    for (int i = 0; i < 1000; i++) {
+        nullifiers.push_back(GetRandHash());
+        cache.SetNullifier(nullifiers.back(), true);
+    }
+    ZCIncrementalMerkleTree tree;
+    std::vector<uint256> anchors;
+    for (int i = 0; i < 10; i++) {
+        tree.append(GetRandHash());
+        cache.PushAnchor(tree);
+        anchors.push_back(tree.root());
+    }
+
+    // With room for everything, the entries stay cached and are written.
+    size_t nUsage = cache.DynamicMemoryUsage();
+    BOOST_CHECK(cache.Sync(nUsage));
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nUsage);
+    for (const uint256& nf : nullifiers) {
+        BOOST_CHECK(base.GetNullifier(nf));
+    }
+
+    // Without room, the clean entries are dropped and read back from the
+    // base when needed.
+    BOOST_CHECK(cache.Sync(0));
+    BOOST_CHECK(cache.DynamicMemoryUsage() < nUsage / 4);
+    for (const uint256& nf : nullifiers) {
+        BOOST_CHECK(cache.GetNullifier(nf));
+    }
+    for (const uint256& rt : anchors) {
+        ZCIncrementalMerkleTree loaded;
+        BOOST_CHECK(cache.GetAnchorAt(rt, loaded));
+    }
+    BOOST_CHECK(cache.GetBestAnchor() == tree.root());
+
+    // Modified entries that do not fit are moved out to the base.
+    uint256 nf = GetRandHash();
+    cache.SetNullifier(nf, true);
+    BOOST_CHECK(cache.Sync(0));
+    BOOST_CHECK(base.GetNullifier(nf));
+    BOOST_CHECK(cache.GetNullifier(nf));
 }
 
 BOOST_AUTO_TEST_CASE(coins_coinbase_spends)
@@ -839,4 +958,308 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(coins_db_nullifier_filter, TestingSetup)
+{
+    std::vector<uint256> nullifiers;
+    for (int i = 0; i < 100; i++) {
+        nullifiers.push_back(GetRandHash());
+    }
+
+    {
+        CCoinsViewDB db(1 << 20, true);
+        CCoinsViewCache cache(&db);
+        for (unsigned int i = 0; i < nullifiers.size(); i++) {
+            BOOST_CHECK(!db.GetNullifier(nullifiers[i]));
+            cache.SetNullifier(nullifiers[i], true);
+        }
+        BOOST_CHECK(cache.Flush());
+        for (unsigned int i = 0; i < nullifiers.size(); i++) {
+            BOOST_CHECK(db.GetNullifier(nullifiers[i]));
+        }
+
+        // Removed nullifiers may stay in the filter, but the database
+        // still has the final say.
+        CCoinsViewCache cache2(&db);
+        cache2.SetNullifier(nullifiers[0], false);
+        BOOST_CHECK(cache2.Flush());
+        BOOST_CHECK(!db.GetNullifier(nullifiers[0]));
+        BOOST_CHECK(db.GetNullifier(nullifiers[1]));
+    }
+
+    // Enough nullifiers to saturate the filter force a rebuild that keeps
+    // everything already written.
+    CCoinsViewDB db(1 << 20, true);
+    for (int round = 0; round < 3; round++) {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 50000; i++) {
+            nullifiers.push_back(GetRandHash());
+            cache.SetNullifier(nullifiers.back(), true);
+        }
+        BOOST_CHECK(cache.Flush());
+    }
+    for (unsigned int i = 100; i < nullifiers.size(); i++) {
+        BOOST_CHECK(db.GetNullifier(nullifiers[i]));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_db_stats, TestingSetup)
+{
+    mapArgs["-txoutsetstats"] = "1";
+    CCoinsViewDB db(1 << 20, true);
+    std::map<uint256, CCoins> result;
+    std::vector<uint256> nullifiers;
+
+    for (int round = 0; round < 10; round++) {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 100; i++) {
+            uint256 txid = !result.empty() && insecure_rand() % 2 ? std::next(result.begin(), insecure_rand() % result.size())->first : GetRandHash();
+            std::map<uint256, CCoins>::iterator it = result.find(txid);
+            if (it != result.end()) {
+                // Spend some outputs of an existing transaction.
+                CCoinsModifier entry = cache.ModifyCoins(txid);
+                for (unsigned int n = 0; n < entry->vout.size(); n++) {
+                    if (insecure_rand() % 2)
+                        entry->Spend(n);
+                }
+                if (entry->IsPruned()) {
+                    result.erase(it);
+                } else {
+                    it->second = *entry;
+                }
+                continue;
+            }
+            CCoins coins;
+            coins.nVersion = 1;
+            coins.nHeight = round;
+            coins.fCoinBase = i == 0;
+            coins.vout.resize(1 + insecure_rand() % 4);
+            for (unsigned int n = 0; n < coins.vout.size(); n++) {
+                coins.vout[n].nValue = insecure_rand() % 100000;
+                coins.vout[n].scriptPubKey = CScript() << OP_TRUE;
+            }
+            *cache.ModifyCoins(txid) = coins;
+            result[txid] = coins;
+        }
+        for (int i = 0; i < 20; i++) {
+            nullifiers.push_back(GetRandHash());
+            cache.SetNullifier(nullifiers.back(), true);
+        }
+        cache.SetNullifier(nullifiers[round], false);
+        cache.SetBestBlock(GetRandHash());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CCoinsStats stats;
+    BOOST_CHECK(db.GetStats(stats));
+    BOOST_CHECK(stats.hashBlock == db.GetBestBlock());
+    uint64_t nOutputs = 0;
+    CAmount nTotal = 0;
+    for (std::map<uint256, CCoins>::iterator it = result.begin(); it != result.end(); it++) {
+        for (unsigned int n = 0; n < it->second.vout.size(); n++) {
+            if (!it->second.vout[n].IsNull()) {
+                nOutputs++;
+                nTotal += it->second.vout[n].nValue;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(stats.nTransactions, result.size());
+    BOOST_CHECK_EQUAL(stats.nTransactionOutputs, nOutputs);
+    BOOST_CHECK_EQUAL(stats.nTotalAmount, nTotal);
+    BOOST_CHECK_EQUAL(stats.nNullifiers, nullifiers.size() - 10);
+
+    // A database holding the same final state, written in a single batch
+    // and without running statistics, has the same set hash when scanned.
+    mapArgs["-txoutsetstats"] = "0";
+    CCoinsViewDB db2(1 << 20, true);
+    {
+        CCoinsViewCache cache(&db2);
+        for (std::map<uint256, CCoins>::iterator it = result.begin(); it != result.end(); it++) {
+            *cache.ModifyCoins(it->first) = it->second;
+        }
+        cache.SetBestBlock(stats.hashBlock);
+        BOOST_CHECK(cache.Flush());
+    }
+    CCoinsStats stats2;
+    BOOST_CHECK(db2.GetStats(stats2));
+    BOOST_CHECK(stats2.hashSerialized == stats.hashSerialized);
+    BOOST_CHECK_EQUAL(stats2.nSerializedSize, stats.nSerializedSize);
+    BOOST_CHECK_EQUAL(stats2.nTransactions, stats.nTransactions);
+    mapArgs.erase("-txoutsetstats");
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_db_snapshot, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    std::map<uint256, CCoins> result;
+    std::vector<uint256> nullifiers;
+    ZCIncrementalMerkleTree tree;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 1000; i++) {
+            uint256 txid = GetRandHash();
+            CCoins coins;
+            coins.nVersion = 1;
+            coins.nHeight = i;
+            coins.vout.resize(1 + insecure_rand() % 3);
+            for (unsigned int n = 0; n < coins.vout.size(); n++) {
+                coins.vout[n].nValue = insecure_rand() % 100000;
+                coins.vout[n].scriptPubKey = CScript() << OP_TRUE;
+            }
+            *cache.ModifyCoins(txid) = coins;
+            result[txid] = coins;
+        }
+        for (int i = 0; i < 100; i++) {
+            nullifiers.push_back(GetRandHash());
+            cache.SetNullifier(nullifiers.back(), true);
+        }
+        appendRandomCommitment(tree);
+        cache.PushAnchor(tree);
+        cache.SetBestBlock(GetRandHash());
+        BOOST_CHECK(cache.Flush());
+    }
+    CCoinsStats stats;
+    BOOST_CHECK(db.GetStats(stats));
+
+    // Copy the records in small chunks, as a snapshot would.
+    CCoinsViewDB db2(1 << 20, true);
+    boost::scoped_ptr<CCoinsViewDBCursor> pcursor(db.Cursor());
+    SnapshotRecords vRecords, vAllRecords;
+    while (pcursor->ReadChunk(vRecords, 4096)) {
+        BOOST_CHECK(db2.WriteSnapshotRecords(vRecords));
+        vAllRecords.insert(vAllRecords.end(), vRecords.begin(), vRecords.end());
+    }
+    BOOST_CHECK_EQUAL(vAllRecords.size(), result.size() + nullifiers.size() + 1);
+    uint256 hashSerialized;
+    pcursor->GetStats().muhash.Finalize(hashSerialized.begin());
+    BOOST_CHECK(hashSerialized == stats.hashSerialized);
+    uint256 hashShielded = pcursor->GetShieldedHash(tree.root());
+
+    // A forged nullifier changes the shielded hash, though not the set hash.
+    CCoinsViewDB db3(1 << 20, true);
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair('s', GetRandHash());
+    ssValue << true;
+    vAllRecords.push_back(std::make_pair(ssKey.str(), ssValue.str()));
+    BOOST_CHECK(db3.WriteSnapshotRecords(vAllRecords));
+    BOOST_CHECK(!db3.FinishSnapshot(stats.hashBlock, tree.root(), stats.hashSerialized, hashShielded));
+    BOOST_CHECK(db3.GetBestBlock().IsNull());
+
+    // The records must match both hashes before they become usable, and the
+    // shielded hash covers the best anchor.
+    BOOST_CHECK(!db2.FinishSnapshot(stats.hashBlock, tree.root(), GetRandHash(), hashShielded));
+    BOOST_CHECK(!db2.FinishSnapshot(stats.hashBlock, ZCIncrementalMerkleTree::empty_root(), stats.hashSerialized, hashShielded));
+    BOOST_CHECK(db2.GetBestBlock().IsNull());
+    BOOST_CHECK(db2.FinishSnapshot(stats.hashBlock, tree.root(), stats.hashSerialized, hashShielded));
+    BOOST_CHECK(db2.GetBestBlock() == stats.hashBlock);
+    BOOST_CHECK(db2.GetBestAnchor() == tree.root());
+
+    CCoinsStats stats2;
+    BOOST_CHECK(db2.GetStats(stats2));
+    BOOST_CHECK(stats2.hashSerialized == stats.hashSerialized);
+    BOOST_CHECK_EQUAL(stats2.nNullifiers, nullifiers.size());
+    for (std::map<uint256, CCoins>::iterator it = result.begin(); it != result.end(); it++) {
+        CCoins coins;
+        BOOST_CHECK(db2.GetCoins(it->first, coins));
+        BOOST_CHECK(coins == it->second);
+    }
+    for (unsigned int i = 0; i < nullifiers.size(); i++) {
+        BOOST_CHECK(db2.GetNullifier(nullifiers[i]));
+    }
+    ZCIncrementalMerkleTree tree2;
+    BOOST_CHECK(db2.GetAnchorAt(tree.root(), tree2));
+    BOOST_CHECK(tree2.root() == tree.root());
+
+    // Only coin set records can be loaded.
+    vRecords.assign(1, std::make_pair(std::string("B"), std::string()));
+    BOOST_CHECK(!db2.WriteSnapshotRecords(vRecords));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_chunk_checksum)
+{
+    CAutoFile file(tmpfile(), SER_DISK, CLIENT_VERSION);
+    std::vector<uint256> payload(10, GetRandHash());
+    WriteSnapshotChunk(file, SNAPSHOT_CHUNK_CHAINSTATE, payload);
+
+    char chType;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    std::vector<uint256> payload2;
+    rewind(file.Get());
+    ReadSnapshotChunk(file, chType, ss);
+    ss >> payload2;
+    BOOST_CHECK_EQUAL(chType, SNAPSHOT_CHUNK_CHAINSTATE);
+    BOOST_CHECK(payload2 == payload);
+
+    // Flip a bit in the payload.
+    fseek(file.Get(), 40, SEEK_SET);
+    int ch = fgetc(file.Get());
+    fseek(file.Get(), 40, SEEK_SET);
+    fputc(ch ^ 1, file.Get());
+    rewind(file.Get());
+    BOOST_CHECK_THROW(ReadSnapshotChunk(file, chType, ss), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(address_index_range_scan)
+{
+    CBlockTreeDB blocktree(1 << 20, true);
+    uint160 hashA(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint160 hashB(ParseHex("0102030405060708090a0b0c0d0e0f1011121315"));
+
+    // Entries are written out of order, and for a neighbouring address.
+    std::vector<std::pair<CAddressIndexKey, CAmount> > entries;
+    entries.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_P2PKH, hashA, 300, 2, GetRandHash(), 0, false), 30));
+    entries.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_P2PKH, hashA, 1, 1, GetRandHash(), 1, false), 10));
+    entries.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_P2PKH, hashA, 256, 0, GetRandHash(), 0, true), -10));
+    entries.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_P2PKH, hashB, 2, 0, GetRandHash(), 0, false), 50));
+    entries.push_back(std::make_pair(CAddressIndexKey(ADDRESSINDEX_P2SH, hashA, 2, 0, GetRandHash(), 0, false), 70));
+    BOOST_CHECK(blocktree.WriteAddressIndex(entries));
+
+    // Heights are big-endian, so a scan returns them in chain order.
+    std::vector<std::pair<CAddressIndexKey, CAmount> > result;
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashA, ADDRESSINDEX_P2PKH, result));
+    BOOST_REQUIRE_EQUAL(result.size(), 3);
+    BOOST_CHECK_EQUAL(result[0].first.blockHeight, 1);
+    BOOST_CHECK_EQUAL(result[1].first.blockHeight, 256);
+    BOOST_CHECK_EQUAL(result[2].first.blockHeight, 300);
+    BOOST_CHECK(result[1].first.spending);
+    BOOST_CHECK_EQUAL(result[1].second, -10);
+
+    result.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashA, ADDRESSINDEX_P2PKH, result, 2, 299));
+    BOOST_REQUIRE_EQUAL(result.size(), 1);
+    BOOST_CHECK_EQUAL(result[0].first.blockHeight, 256);
+
+    // Erasing the entries of a block removes them from the scan.
+    entries.resize(1);
+    BOOST_CHECK(blocktree.EraseAddressIndex(entries));
+    result.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashA, ADDRESSINDEX_P2PKH, result));
+    BOOST_CHECK_EQUAL(result.size(), 2);
+
+    // Null values erase unspent and spent index entries.
+    CScript script = GetScriptForDestination(CKeyID(hashA));
+    uint256 txid = GetRandHash();
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    unspent.push_back(std::make_pair(CAddressUnspentKey(ADDRESSINDEX_P2PKH, hashA, txid, 0), CAddressUnspentValue(10, script, 1)));
+    unspent.push_back(std::make_pair(CAddressUnspentKey(ADDRESSINDEX_P2PKH, hashA, txid, 1), CAddressUnspentValue(20, script, 1)));
+    unspent.push_back(std::make_pair(CAddressUnspentKey(ADDRESSINDEX_P2PKH, hashA, txid, 0), CAddressUnspentValue()));
+    BOOST_CHECK(blocktree.UpdateAddressUnspentIndex(unspent));
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentResult;
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashA, ADDRESSINDEX_P2PKH, unspentResult));
+    BOOST_REQUIRE_EQUAL(unspentResult.size(), 1);
+    BOOST_CHECK_EQUAL(unspentResult[0].first.index, 1);
+    BOOST_CHECK_EQUAL(unspentResult[0].second.satoshis, 20);
+    BOOST_CHECK(unspentResult[0].second.script == script);
+
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spent;
+    spent.push_back(std::make_pair(CSpentIndexKey(txid, 0), CSpentIndexValue(GetRandHash(), 3, 2, 10, ADDRESSINDEX_P2PKH, hashA)));
+    BOOST_CHECK(blocktree.UpdateSpentIndex(spent));
+    CSpentIndexValue value;
+    BOOST_CHECK(blocktree.ReadSpentIndex(CSpentIndexKey(txid, 0), value));
+    BOOST_CHECK_EQUAL(value.inputIndex, 3);
+    BOOST_CHECK(value.addressHash == hashA);
+    spent[0].second.SetNull();
+    BOOST_CHECK(blocktree.UpdateSpentIndex(spent));
+    BOOST_CHECK(!blocktree.ReadSpentIndex(CSpentIndexKey(txid, 0), value));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
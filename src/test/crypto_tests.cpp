@@ -2,16 +2,20 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/muhash.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "random.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/assign/list_of.hpp>
@@ -248,4 +252,91 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j) {
+            in[j] = insecure_rand();
+        }
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256D64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha256_multiblock_write)
+{
+    // A single Write() covering many blocks must match block-at-a-time hashing.
+    unsigned char in[64 * 17 + 13];
+    for (size_t j = 0; j < sizeof(in); ++j) {
+        in[j] = insecure_rand();
+    }
+    unsigned char out1[CSHA256::OUTPUT_SIZE], out2[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(in, sizeof(in)).Finalize(out1);
+    CSHA256 hasher;
+    for (size_t j = 0; j < sizeof(in); j += 5) {
+        hasher.Write(in + j, std::min<size_t>(5, sizeof(in) - j));
+    }
+    hasher.Finalize(out2);
+    BOOST_CHECK(memcmp(out1, out2, sizeof(out1)) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(muhash_set_operations)
+{
+    std::vector<uint256> elements;
+    for (int i = 0; i < 8; i++) {
+        elements.push_back(GetRandHash());
+    }
+    uint256 empty, forward, backward, partial, expected;
+    MuHash3072().Finalize(empty.begin());
+
+    // The set hash does not depend on the order of insertion.
+    MuHash3072 acc1, acc2;
+    for (size_t i = 0; i < elements.size(); i++) {
+        acc1.Insert(elements[i].begin(), elements[i].size());
+        acc2.Insert(elements[elements.size() - 1 - i].begin(), elements[i].size());
+    }
+    acc1.Finalize(forward.begin());
+    acc2.Finalize(backward.begin());
+    BOOST_CHECK(forward == backward);
+    BOOST_CHECK(forward != empty);
+
+    // Removing elements undoes their insertion, in any order.
+    MuHash3072 acc3;
+    acc3.Insert(elements[0].begin(), elements[0].size());
+    acc3.Finalize(expected.begin());
+    for (size_t i = 1; i < elements.size(); i++) {
+        acc1.Remove(elements[i].begin(), elements[i].size());
+    }
+    acc1.Finalize(partial.begin());
+    BOOST_CHECK(partial == expected);
+    acc1.Remove(elements[0].begin(), elements[0].size());
+    acc1.Finalize(partial.begin());
+    BOOST_CHECK(partial == empty);
+
+    // Sets combine by multiplication and division.
+    MuHash3072 acc4;
+    acc4.Insert(elements[1].begin(), elements[1].size());
+    acc3 *= acc4;
+    acc3.Remove(elements[1].begin(), elements[1].size());
+    acc3.Finalize(partial.begin());
+    BOOST_CHECK(partial == expected);
+    acc3 /= acc4;
+    acc3 *= acc4;
+    acc3.Finalize(partial.begin());
+    BOOST_CHECK(partial == expected);
+
+    // Serialization keeps pending removals.
+    CDataStream ss(SER_DISK, 0);
+    ss << acc3;
+    MuHash3072 acc5;
+    ss >> acc5;
+    acc5.Finalize(partial.begin());
+    BOOST_CHECK(partial == expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,205 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "keystore.h"
+#include "main.h"
+#include "random.h"
+#include "script/sigcache.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "uint256.h"
+#include "utiltime.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+static std::vector<uint256> RandomKeys(size_t n)
+{
+    std::vector<uint256> keys(n);
+    for (size_t i = 0; i < n; i++)
+        keys[i] = GetRandHash();
+    return keys;
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_contains)
+{
+    CCuckooCache cache(1 << 20);
+    CCuckooCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBytes, 1 << 20);
+    BOOST_CHECK_EQUAL(stats.nSlots, (1 << 20) / 32);
+
+    std::vector<uint256> inserted = RandomKeys(1000);
+    std::vector<uint256> other = RandomKeys(1000);
+    BOOST_FOREACH(const uint256& key, inserted) {
+        cache.Insert(key);
+    }
+    BOOST_FOREACH(const uint256& key, inserted) {
+        BOOST_CHECK(cache.Contains(key, false));
+    }
+    BOOST_FOREACH(const uint256& key, other) {
+        BOOST_CHECK(!cache.Contains(key, false));
+    }
+
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nHits, 1000);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1000);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 0);
+
+    // An erased entry is gone, and the others stay.
+    BOOST_CHECK(cache.Contains(inserted[0], true));
+    BOOST_CHECK(!cache.Contains(inserted[0], false));
+    BOOST_CHECK(cache.Contains(inserted[1], false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_disabled)
+{
+    CCuckooCache cache(0);
+    BOOST_CHECK_EQUAL(cache.GetStats().nSlots, 0);
+    uint256 key = GetRandHash();
+    cache.Insert(key);
+    BOOST_CHECK(!cache.Contains(key, false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_generations)
+{
+    // Overfill a small cache many times over: the oldest entries go, and
+    // nearly all of the most recent quarter of the capacity is kept.
+    CCuckooCache cache(1 << 16);
+    size_t nSlots = cache.GetStats().nSlots;
+    std::vector<uint256> keys = RandomKeys(nSlots * 8);
+    BOOST_FOREACH(const uint256& key, keys) {
+        cache.Insert(key);
+    }
+    BOOST_CHECK(cache.GetStats().nEvictions > 0);
+
+    size_t nRecent = 0;
+    for (size_t i = keys.size() - nSlots / 4; i < keys.size(); i++) {
+        if (cache.Contains(keys[i], false))
+            nRecent++;
+    }
+    BOOST_CHECK(nRecent * 100 >= (nSlots / 4) * 95);
+
+    size_t nOld = 0;
+    for (size_t i = 0; i < nSlots; i++) {
+        if (cache.Contains(keys[i], false))
+            nOld++;
+    }
+    BOOST_CHECK(nOld * 100 < nSlots * 5);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_threads)
+{
+    // Concurrent inserts and lookups never report a key that was not
+    // inserted, and lose few of those that were.
+    CCuckooCache cache(1 << 20);
+    const int nThreads = 4;
+    const size_t nKeysPerThread = 2000;
+    std::vector<std::vector<uint256> > inserted, other;
+    for (int i = 0; i < nThreads; i++) {
+        inserted.push_back(RandomKeys(nKeysPerThread));
+        other.push_back(RandomKeys(nKeysPerThread));
+    }
+
+    std::atomic<size_t> nFalsePositives(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back([&, i]() {
+            BOOST_FOREACH(const uint256& key, inserted[i]) {
+                cache.Insert(key);
+            }
+            for (size_t j = 0; j < nKeysPerThread; j++) {
+                if (cache.Contains(other[i][j], false))
+                    nFalsePositives++;
+                // Look up another thread's keys while they are written.
+                cache.Contains(inserted[(i + 1) % nThreads][j], false);
+            }
+        });
+    }
+    BOOST_FOREACH(std::thread& thread, threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(nFalsePositives.load(), 0);
+
+    size_t nKept = 0;
+    for (int i = 0; i < nThreads; i++) {
+        BOOST_FOREACH(const uint256& key, inserted[i]) {
+            if (cache.Contains(key, false))
+                nKept++;
+        }
+    }
+    BOOST_CHECK(nKept * 100 >= nThreads * nKeysPerThread * 99);
+}
+
+BOOST_FIXTURE_TEST_CASE(sigcache_just_check_connect, TestingSetup)
+{
+    LOCK(cs_main);
+
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // An output to spend, added straight to a view on the tip
+    CMutableTransaction txPrev;
+    txPrev.vin.resize(1);
+    txPrev.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    txPrev.vout.resize(1);
+    txPrev.vout[0].nValue = 10 * COIN;
+    txPrev.vout[0].scriptPubKey = scriptPubKey;
+    CCoinsViewCache view(pcoinsTip);
+    *view.ModifyCoins(txPrev.GetHash()) = CCoins(txPrev, 0);
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(txPrev.GetHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 9 * COIN;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+    BOOST_CHECK(SignSignature(keystore, scriptPubKey, tx, 0, SIGHASH_ALL));
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].scriptPubKey = scriptPubKey;
+
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = chainActive.Tip()->GetBlockHash();
+    block.nTime = GetTime();
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(tx);
+    CBlockIndex index(block);
+    index.pprev = chainActive.Tip();
+    index.nHeight = chainActive.Height() + 1;
+
+    // Checking the block, as getblocktemplate does, adds the signature to
+    // the cache and leaves it there for the next check and the real connect
+    CCuckooCacheStats before = GetSignatureCacheStats();
+    for (int i = 0; i < 2; i++) {
+        CCoinsViewCache viewBlock(&view);
+        CValidationState state;
+        BOOST_CHECK(ConnectBlock(block, state, &index, viewBlock, true));
+    }
+    CCuckooCacheStats after = GetSignatureCacheStats();
+    BOOST_CHECK_EQUAL(after.nMisses - before.nMisses, 1U);
+    BOOST_CHECK_EQUAL(after.nHits - before.nHits, 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -47,4 +47,30 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(siphash)
+{
+    // Test vectors from the SipHash reference implementation, where the
+    // message of length i is the bytes 0, 1, ..., i-1.
+    CSipHasher hasher(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x726fdb47dd0e0e31ULL);
+    static const unsigned char t0[1] = {0};
+    hasher.Write(t0, 1);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x74f839c593dc67fdULL);
+    static const unsigned char t1[7] = {1, 2, 3, 4, 5, 6, 7};
+    hasher.Write(t1, 7);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x93f5f5799a932462ULL);
+    static const unsigned char t2[8] = {8, 9, 10, 11, 12, 13, 14, 15};
+    hasher.Write(t2, 8);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x3f2acc7f57c29bdbULL);
+    static const unsigned char t3[2] = {16, 17};
+    hasher.Write(t3, 2);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x4bc1b3f0968dd39cULL);
+    static const unsigned char t4[9] = {18, 19, 20, 21, 22, 23, 24, 25, 26};
+    hasher.Write(t4, 9);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x2f2e6163076bcfadULL);
+    static const unsigned char t5[5] = {27, 28, 29, 30, 31};
+    hasher.Write(t5, 5);
+    BOOST_CHECK_EQUAL(hasher.Finalize(), 0x7127512f72f27cceULL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include "chainparams.h"
 #include "main.h"
+#include "txdb.h"
 
 #include "test/test_bitcoin.h"
 
@@ -84,6 +85,39 @@ BOOST_AUTO_TEST_CASE(subsidy_limit_test)
     BOOST_CHECK_EQUAL(nSum, 2099999990760000ULL);
 }
 
+BOOST_AUTO_TEST_CASE(block_index_solution_trimming)
+{
+    LOCK(cs_main);
+    const CBlock& genesis = Params().GenesisBlock();
+
+    // InitBlockIndex flushed the genesis entry, so its solution is no
+    // longer resident but is still served.
+    CBlockIndex* pindexGenesis = chainActive.Genesis();
+    BOOST_CHECK(pindexGenesis->nSolution.empty());
+    BOOST_CHECK(pindexGenesis->GetSolution() == genesis.nSolution);
+    BOOST_CHECK(pindexGenesis->GetBlockHeader().GetHash() == genesis.GetHash());
+
+    // An entry that was never trimmed, and so is not in the solution cache,
+    // is read back from the block tree DB.
+    CBlockHeader header = genesis.GetBlockHeader();
+    header.nTime += 1;
+    uint256 hash = header.GetHash();
+    CBlockIndex index(header);
+    index.phashBlock = &hash;
+    std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
+    std::vector<const CBlockIndex*> vBlocks(1, &index);
+    BOOST_CHECK(pblocktree->WriteBatchSync(vFiles, 0, vBlocks));
+
+    CBlockIndex indexTrimmed(index);
+    indexTrimmed.nSolution.clear();
+    BOOST_CHECK(indexTrimmed.GetSolution() == header.nSolution);
+    BOOST_CHECK(indexTrimmed.GetBlockHeader().GetHash() == hash);
+
+    // Writing a trimmed entry writes the full solution.
+    CDiskBlockIndex diskindex(&indexTrimmed);
+    BOOST_CHECK(diskindex.nSolution == header.nSolution);
+}
+
 bool ReturnFalse() { return false; }
 bool ReturnTrue() { return true; }
 
@@ -0,0 +1,65 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "notificationqueue.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(notificationqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(notificationqueue_order_and_drop)
+{
+    std::mutex m;
+    std::condition_variable cond;
+    bool fRelease = false;
+    std::vector<int> vPublished;
+
+    // Room for two notifications of 1000 bytes, not three.
+    CNotificationQueue queue(2 * (1000 + NOTIFICATION_OVERHEAD) + 500, NOTIFY_DROP);
+    queue.Start();
+
+    // The first job holds up the queue's thread until it is released.
+    BOOST_CHECK(queue.Push([&]() {
+        std::unique_lock<std::mutex> lock(m);
+        cond.wait(lock, [&]{ return fRelease; });
+        vPublished.push_back(0);
+    }, 1000));
+    for (int i = 1; i < 4; i++) {
+        bool fQueued = queue.Push([&, i]() { vPublished.push_back(i); }, 1000);
+        BOOST_CHECK_EQUAL(fQueued, i < 2);
+    }
+    BOOST_CHECK_EQUAL(queue.GetDropped(), 2);
+
+    {
+        std::lock_guard<std::mutex> lock(m);
+        fRelease = true;
+    }
+    cond.notify_all();
+    queue.Stop();
+
+    BOOST_CHECK_EQUAL(vPublished.size(), 2);
+    BOOST_CHECK_EQUAL(vPublished[0], 0);
+    BOOST_CHECK_EQUAL(vPublished[1], 1);
+}
+
+BOOST_AUTO_TEST_CASE(notificationqueue_block_policy)
+{
+    int nPublished = 0;
+
+    // Every notification is larger than the limit, so each waits for the
+    // previous one to be published, and none is dropped.
+    CNotificationQueue queue(100, NOTIFY_BLOCK);
+    queue.Start();
+    for (int i = 0; i < 100; i++)
+        BOOST_CHECK(queue.Push([&]() { nPublished++; }, 1000));
+    queue.Stop();
+
+    BOOST_CHECK_EQUAL(nPublished, 100);
+    BOOST_CHECK_EQUAL(queue.GetDropped(), 0);
+    BOOST_CHECK(!queue.Push([]() {}, 0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -77,6 +77,11 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
             CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
             ss << pmt1;
 
+            // building from the block's cached tree must give the same result
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+            ssBlock << CPartialMerkleTree(block, vMatch);
+            BOOST_CHECK(ss.str() == ssBlock.str());
+
             // verify CPartialMerkleTree's size guarantees
             unsigned int n = std::min<unsigned int>(nTx, 1 + vMatchTxid1.size()*nHeight);
             BOOST_CHECK(ss.size() <= 10 + (258*n+7)/8);
@@ -108,6 +113,39 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
     }
 }
 
+BOOST_AUTO_TEST_CASE(merkle_tree_cache)
+{
+    CBlock block;
+    for (unsigned int j = 0; j < 10; j++) {
+        CMutableTransaction tx;
+        tx.nLockTime = j;
+        block.vtx.push_back(CTransaction(tx));
+    }
+    uint256 root1 = block.BuildMerkleTree();
+    BOOST_CHECK(block.BuildMerkleTree() == root1);
+
+    // Replacing a transaction (as the miner does with the coinbase) must
+    // not return the stale cached root.
+    CMutableTransaction tx;
+    tx.nLockTime = 100;
+    block.vtx[0] = CTransaction(tx);
+    uint256 root2 = block.BuildMerkleTree();
+    BOOST_CHECK(root2 != root1);
+    CBlock block2;
+    block2.vtx = block.vtx;
+    BOOST_CHECK(block2.BuildMerkleTree() == root2);
+
+    // The mutation flag is cached along with the tree.
+    block.vtx.push_back(block.vtx[8]);
+    block.vtx.push_back(block.vtx[9]);
+    bool mutated = false;
+    block.BuildMerkleTree(&mutated);
+    BOOST_CHECK(mutated);
+    mutated = false;
+    block.BuildMerkleTree(&mutated);
+    BOOST_CHECK(mutated);
+}
+
 BOOST_AUTO_TEST_CASE(pmt_malleability)
 {
     std::vector<uint256> vTxid = boost::assign::list_of
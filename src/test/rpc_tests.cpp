@@ -295,4 +295,141 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
 }
 
+BOOST_AUTO_TEST_CASE(json_stream_writer)
+{
+    UniValue tx(UniValue::VOBJ);
+    tx.push_back(Pair("txid", "ab\"cd\n"));
+    tx.push_back(Pair("value", ValueFromAmount(1234567)));
+    tx.push_back(Pair("coinbase", false));
+    tx.push_back(Pair("spent", NullUniValue));
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < 200; i++)
+        txs.push_back(tx);
+    txs.push_back(UniValue(UniValue::VARR));
+    txs.push_back(UniValue(UniValue::VOBJ));
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("tx", txs));
+    result.push_back(Pair("height", 42));
+
+    // Streamed output matches JSONRPCReply, and large replies arrive in pieces
+    std::vector<std::string> chunks;
+    bool fFinished = false;
+    JSONStreamWriter::Sink collect = [&chunks, &fFinished](const std::string& strChunk, bool fFinal) {
+        BOOST_CHECK(!fFinished);
+        chunks.push_back(strChunk);
+        fFinished = fFinal;
+        return true;
+    };
+    JSONStreamWriter writer(1024, collect);
+    JSONRPCReplyStream(writer, result, NullUniValue, UniValue("id1"));
+    writer.Finish();
+    BOOST_CHECK(fFinished);
+    BOOST_CHECK(chunks.size() > 1);
+    BOOST_CHECK_EQUAL(boost::algorithm::join(chunks, ""), JSONRPCReply(result, NullUniValue, UniValue("id1")));
+    for (size_t i = 0; i + 1 < chunks.size(); i++)
+        BOOST_CHECK(chunks[i].size() >= 1024);
+
+    // Errors replace the result with null
+    chunks.clear();
+    fFinished = false;
+    JSONStreamWriter errorWriter(1024, collect);
+    UniValue error = JSONRPCError(RPC_MISC_ERROR, "oops");
+    JSONRPCReplyStream(errorWriter, result, error, NullUniValue);
+    errorWriter.Finish();
+    BOOST_CHECK_EQUAL(chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(chunks[0], JSONRPCReply(result, error, NullUniValue));
+}
+
+BOOST_AUTO_TEST_CASE(json_stream_writer_abandon)
+{
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 1000; i++)
+        arr.push_back(i);
+
+    // Once the sink declines more output nothing else is serialized, but
+    // Finish still signals the end of the reply
+    int nCalls = 0;
+    bool fFinal = false;
+    JSONStreamWriter writer(16, [&nCalls, &fFinal](const std::string&, bool fFinalIn) {
+        nCalls++;
+        fFinal = fFinalIn;
+        return false;
+    });
+    writer.Write(arr);
+    BOOST_CHECK_EQUAL(nCalls, 1);
+    writer.Finish();
+    BOOST_CHECK_EQUAL(nCalls, 2);
+    BOOST_CHECK(fFinal);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_order)
+{
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 50; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.push_back(Pair("method", i % 2 ? "getblockcount" : "getbestblockhash"));
+        req.push_back(Pair("params", UniValue(UniValue::VARR)));
+        req.push_back(Pair("id", i));
+        batch.push_back(req);
+    }
+
+    // Replies to a read-only batch come back in request order whichever
+    // thread ran each call
+    StartRPCBatchThreads(4);
+    UniValue ret = JSONRPCExecBatch(batch);
+    StopRPCBatchThreads();
+    BOOST_CHECK_EQUAL(ret.size(), batch.size());
+    for (int i = 0; i < 50; i++) {
+        BOOST_CHECK_EQUAL(find_value(ret[i].get_obj(), "id").get_int(), i);
+        BOOST_CHECK(find_value(ret[i].get_obj(), "error").isNull());
+        BOOST_CHECK(i % 2 ? find_value(ret[i].get_obj(), "result").isNum() : find_value(ret[i].get_obj(), "result").isStr());
+    }
+
+    // A malformed element still gets its own error reply
+    batch.push_back("not a request");
+    StartRPCBatchThreads(4);
+    ret = JSONRPCExecBatch(batch);
+    StopRPCBatchThreads();
+    BOOST_CHECK_EQUAL(ret.size(), batch.size());
+    BOOST_CHECK(!find_value(ret[50].get_obj(), "error").isNull());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_serial)
+{
+    // Each listbanned sees exactly the setban and clearbanned calls before it
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 20; i++) {
+        UniValue params(UniValue::VARR);
+        UniValue req(UniValue::VOBJ);
+        if (i % 4 == 0) {
+            params.push_back("127.0.0.1");
+            params.push_back("add");
+            req.push_back(Pair("method", "setban"));
+        } else if (i % 4 == 2) {
+            req.push_back(Pair("method", "clearbanned"));
+        } else {
+            req.push_back(Pair("method", "listbanned"));
+        }
+        req.push_back(Pair("params", params));
+        req.push_back(Pair("id", i));
+        batch.push_back(req);
+    }
+
+    BOOST_CHECK_NO_THROW(CallRPC(string("clearbanned")));
+    StartRPCBatchThreads(4);
+    UniValue ret = JSONRPCExecBatch(batch);
+    StopRPCBatchThreads();
+    BOOST_CHECK_EQUAL(ret.size(), batch.size());
+    for (int i = 0; i < 20; i++) {
+        const UniValue& reply = ret[i].get_obj();
+        BOOST_CHECK_EQUAL(find_value(reply, "id").get_int(), i);
+        BOOST_CHECK(find_value(reply, "error").isNull());
+        if (i % 4 == 1)
+            BOOST_CHECK_EQUAL(find_value(reply, "result").size(), 1);
+        else if (i % 4 == 3)
+            BOOST_CHECK_EQUAL(find_value(reply, "result").size(), 0);
+    }
+    BOOST_CHECK_NO_THROW(CallRPC(string("clearbanned")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -774,6 +774,74 @@ BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_parallel_cancel)
     BOOST_CHECK(ids.size()==0);
 }
 
+// Takes a number of steps, and pauses between them when the queue asks it to
+class StepOperation : public AsyncRPCOperation {
+public:
+    std::mutex& logMutex;
+    std::vector<AsyncRPCOperationId>& log;
+    int steps;
+    StepOperation(std::mutex& m, std::vector<AsyncRPCOperationId>& l, int n) : logMutex(m), log(l), steps(n) {}
+    virtual ~StepOperation() {}
+    virtual void main() {
+        set_state(OperationStatus::EXECUTING);
+        while (steps > 0) {
+            if (shouldYield()) {
+                set_state(OperationStatus::READY);
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            std::lock_guard<std::mutex> guard(logMutex);
+            log.push_back(getId());
+            steps--;
+        }
+        set_state(OperationStatus::SUCCESS);
+    }
+};
+
+// This tests priorities, yielding and the limit on finished operations
+BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_priority)
+{
+    std::mutex logMutex;
+    std::vector<AsyncRPCOperationId> log;
+
+    std::shared_ptr<AsyncRPCQueue> q = std::make_shared<AsyncRPCQueue>();
+    q->setMaxFinishedOperations(2);
+
+    std::shared_ptr<AsyncRPCOperation> low(new StepOperation(logMutex, log, 5));
+    low->setPriority(OperationPriority::LOW);
+    std::shared_ptr<AsyncRPCOperation> normal1(new StepOperation(logMutex, log, 1));
+    std::shared_ptr<AsyncRPCOperation> normal2(new StepOperation(logMutex, log, 1));
+    std::shared_ptr<AsyncRPCOperation> high(new StepOperation(logMutex, log, 1));
+    high->setPriority(OperationPriority::HIGH);
+
+    // Higher priorities run first, whatever the order they were added in
+    q->addOperation(low);
+    q->addOperation(normal1);
+    q->addOperation(high);
+    q->addWorker();
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+
+    // The low priority operation is running, and makes way between steps
+    BOOST_CHECK_EQUAL(low->isExecuting(), true);
+    q->addOperation(normal2);
+    q->finishAndWait();
+
+    BOOST_CHECK_EQUAL(low->isSuccess(), true);
+    BOOST_CHECK_EQUAL(normal2->isSuccess(), true);
+    std::vector<AsyncRPCOperationId> expected = {high->getId(), normal1->getId(), low->getId(), low->getId()};
+    BOOST_REQUIRE_EQUAL(log.size(), 8);
+    BOOST_CHECK(std::vector<AsyncRPCOperationId>(log.begin(), log.begin() + 4) == expected);
+    BOOST_CHECK_EQUAL(log[4], normal2->getId());
+    BOOST_CHECK_EQUAL(log[7], low->getId());
+
+    // Only the last two operations to finish are kept
+    std::vector<AsyncRPCOperationId> ids = q->getAllOperationIds();
+    std::set<AsyncRPCOperationId> opids(ids.begin(), ids.end());
+    BOOST_CHECK_EQUAL(opids.size(), 2);
+    BOOST_CHECK_EQUAL(opids.count(normal2->getId()), 1);
+    BOOST_CHECK_EQUAL(opids.count(low->getId()), 1);
+}
+
 // This tests z_getoperationstatus, z_getoperationresult, z_listoperationids
 BOOST_AUTO_TEST_CASE(rpc_z_getoperations)
 {
@@ -1174,6 +1242,15 @@ BOOST_AUTO_TEST_CASE(rpc_z_sendmany_internals)
         info.vjsin.clear();
         try {
             proxy.perform_joinsplit(info);
+        } catch (const std::runtime_error & e) {
+            BOOST_FAIL(e.what());
+        }
+
+        // Proofs are only generated (and checked) once all JoinSplits exist;
+        // test mode leaves them empty, so verification fails.
+        try {
+            proxy.prove_joinsplits();
+            BOOST_FAIL("Should have caused an error");
         } catch (const std::runtime_error & e) {
             BOOST_CHECK( string(e.what()).find("error verifying joinsplit")!= string::npos);
         }
@@ -1182,6 +1259,88 @@ BOOST_AUTO_TEST_CASE(rpc_z_sendmany_internals)
 }
 
 
+static CAsyncOperationRecord ReadCheckpoint(const std::string& strId)
+{
+    std::map<std::string, CAsyncOperationRecord> mapRecords;
+    CWalletDB(pwalletMain->strWalletFile).ListAsyncOperations(mapRecords);
+    BOOST_REQUIRE(mapRecords.count(strId));
+    return mapRecords[strId];
+}
+
+// Checkpoint the operation, resume a new one from the record as a restarted
+// node would, and check that it saves exactly what it was resumed from.
+static std::shared_ptr<AsyncRPCOperation_sendmany> ResumeFromCheckpoint(std::shared_ptr<AsyncRPCOperation_sendmany> operation)
+{
+    operation->checkpoint();
+    CAsyncOperationRecord record = ReadCheckpoint(operation->getId());
+    BOOST_CHECK_EQUAL(record.strMethod, "z_sendmany");
+    BOOST_CHECK_EQUAL(record.nCreationTime, operation->getCreationTime());
+    BOOST_CHECK_EQUAL(record.nPriority, (int)operation->getPriority());
+
+    CDataStream ss(record.vchData, SER_DISK, CLIENT_VERSION);
+    std::shared_ptr<AsyncRPCOperation_sendmany> resumed(
+        new AsyncRPCOperation_sendmany(operation->getId(), record.nCreationTime, ss));
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK(resumed->persistent);
+
+    resumed->checkpoint();
+    BOOST_CHECK(ReadCheckpoint(operation->getId()).vchData == record.vchData);
+    return resumed;
+}
+
+BOOST_AUTO_TEST_CASE(rpc_z_sendmany_checkpoint)
+{
+    SelectParams(CBaseChainParams::TESTNET);
+
+    LOCK(pwalletMain->cs_wallet);
+
+    CZCPaymentAddress pa = pwalletMain->GenerateNewZKey();
+    std::string zaddr1 = pa.ToString();
+    std::vector<SendManyRecipient> recipients = { SendManyRecipient(zaddr1, 0.0005, "ABCD") };
+    std::shared_ptr<AsyncRPCOperation_sendmany> ptr(new AsyncRPCOperation_sendmany(zaddr1, {}, recipients, 1));
+    ptr->setPriority(OperationPriority::LOW);
+    TEST_FRIEND_AsyncRPCOperation_sendmany proxy(ptr);
+
+    // Enable test mode so proofs are not generated
+    ptr->testmode = true;
+
+    // Only the parameters, checked again by init() on resume
+    {
+        std::shared_ptr<AsyncRPCOperation_sendmany> resumed = ResumeFromCheckpoint(ptr);
+        TEST_FRIEND_AsyncRPCOperation_sendmany resumedProxy(resumed);
+        BOOST_CHECK(resumedProxy.isResumed());
+        BOOST_CHECK(!resumedProxy.isSigned());
+        BOOST_CHECK_EQUAL(resumedProxy.getPendingProofs(), 0);
+    }
+
+    // JoinSplits built, with their proofs still to be generated
+    {
+        AsyncJoinSplitInfo info;
+        BOOST_CHECK_NO_THROW(proxy.perform_joinsplit(info));
+        BOOST_CHECK_EQUAL(proxy.getPendingProofs(), 1);
+
+        std::shared_ptr<AsyncRPCOperation_sendmany> resumed = ResumeFromCheckpoint(ptr);
+        TEST_FRIEND_AsyncRPCOperation_sendmany resumedProxy(resumed);
+        BOOST_CHECK(!resumedProxy.isSigned());
+        BOOST_CHECK_EQUAL(resumedProxy.getPendingProofs(), 1);
+        BOOST_CHECK(resumedProxy.getTx().GetHash() == proxy.getTx().GetHash());
+    }
+
+    // Signed, so only the transaction is kept
+    {
+        proxy.setSigned(true);
+
+        std::shared_ptr<AsyncRPCOperation_sendmany> resumed = ResumeFromCheckpoint(ptr);
+        TEST_FRIEND_AsyncRPCOperation_sendmany resumedProxy(resumed);
+        BOOST_CHECK(resumedProxy.isSigned());
+        BOOST_CHECK_EQUAL(resumedProxy.getPendingProofs(), 0);
+        BOOST_CHECK(resumedProxy.getTx().GetHash() == proxy.getTx().GetHash());
+    }
+
+    BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).EraseAsyncOperation(ptr->getId()));
+}
+
+
 /*
  * This test covers storing encrypted zkeys in the wallet.
  */
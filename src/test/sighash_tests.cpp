@@ -194,6 +194,15 @@ BOOST_AUTO_TEST_CASE(sighash_test)
         std::cout << "\n";
         #endif
         BOOST_CHECK(sh == sho);
+
+        // The cached path must agree, including when the result is memoized.
+        CTransaction tx(txTo);
+        PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, &txdata) == sho);
+        BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, &txdata) == sho);
+        if (tx.nVersion >= 2 && !tx.vjoinsplit.empty()) {
+            BOOST_CHECK(txdata.JoinSplitSigHash() == SignatureHash(CScript(), tx, NOT_AN_INPUT, SIGHASH_ALL));
+        }
     }
     #if defined(PRINT_SIGHASH_JSON)
     std::cout << "]\n";
@@ -252,6 +261,10 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
 
         sh = SignatureHash(scriptCode, tx, nIn, nHashType);
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
+
+        PrecomputedTransactionData txdata(tx);
+        sh = SignatureHash(scriptCode, tx, nIn, nHashType, &txdata);
+        BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
 BOOST_AUTO_TEST_SUITE_END()
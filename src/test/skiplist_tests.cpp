@@ -100,4 +100,49 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(chainsnapshot_test)
+{
+    // A main chain and a side branch forking off at height 500.
+    std::vector<CBlockIndex> vBlocksMain(1000);
+    std::vector<CBlockIndex> vBlocksSide(100);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 501;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[500];
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    chain.SetTip(&vBlocksMain.back());
+    CChainSnapshot snapshot(chain.Tip());
+    BOOST_CHECK(snapshot.Tip() == chain.Tip());
+    BOOST_CHECK_EQUAL(snapshot.Height(), chain.Height());
+    for (int i=0; i < 1000; i++) {
+        int h = insecure_rand() % vBlocksMain.size();
+        BOOST_CHECK(snapshot[h] == chain[h]);
+        BOOST_CHECK(snapshot.Contains(&vBlocksMain[h]));
+        BOOST_CHECK(snapshot.Next(&vBlocksMain[h]) == chain.Next(&vBlocksMain[h]));
+    }
+    BOOST_CHECK(snapshot[-1] == NULL);
+    BOOST_CHECK(snapshot[vBlocksMain.size()] == NULL);
+    BOOST_CHECK(!snapshot.Contains(&vBlocksSide[0]));
+    BOOST_CHECK(snapshot.Next(&vBlocksSide[0]) == NULL);
+
+    // Reorganizing the real chain leaves an existing snapshot untouched.
+    chain.SetTip(&vBlocksSide.back());
+    BOOST_CHECK(snapshot.Contains(&vBlocksMain[600]));
+    BOOST_CHECK(!chain.Contains(&vBlocksMain[600]));
+    BOOST_CHECK(snapshot.Next(&vBlocksMain[500]) == &vBlocksMain[501]);
+    BOOST_CHECK(chain.Next(&vBlocksMain[500]) == &vBlocksSide[0]);
+
+    CChainSnapshot empty;
+    BOOST_CHECK_EQUAL(empty.Height(), -1);
+    BOOST_CHECK(empty[0] == NULL);
+    BOOST_CHECK(!empty.Contains(&vBlocksMain[0]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,8 @@
 #include "test_bitcoin.h"
 
 #include "crypto/common.h"
+#include "crypto/sha256.h"
+#include "joinsplitcache.h"
 
 #include "key.h"
 #include "main.h"
@@ -45,11 +47,14 @@ JoinSplitTestingSetup::~JoinSplitTestingSetup()
 BasicTestingSetup::BasicTestingSetup()
 {
     assert(init_and_check_sodium() != -1);
+    SHA256AutoDetect();
     ECC_Start();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
     fCheckBlockIndex = true;
     SelectParams(CBaseChainParams::MAIN);
+    InitSignatureCache();
+    InitJoinSplitCache();
 }
 BasicTestingSetup::~BasicTestingSetup()
 {
@@ -10,6 +10,8 @@
 #include "clientversion.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "cuckoocache.h"
+#include "joinsplitcache.h"
 #include "key.h"
 #include "keystore.h"
 #include "main.h"
@@ -387,6 +389,64 @@ BOOST_AUTO_TEST_CASE(test_basic_joinsplit_verification)
     }
 }
 
+BOOST_AUTO_TEST_CASE(test_joinsplit_cache)
+{
+    ZCIncrementalMerkleTree merkleTree;
+    uint256 rt = merkleTree.root();
+    uint256 pubKeyHash = GetRandHash();
+    libzcash::SpendingKey k = libzcash::SpendingKey::random();
+    boost::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs = {
+        libzcash::JSInput(),
+        libzcash::JSInput()
+    };
+    boost::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs = {
+        libzcash::JSOutput(k.address(), 0),
+        libzcash::JSOutput()
+    };
+    JSDescription jsdesc(*pzcashParams, pubKeyHash, rt, inputs, outputs, 0, 0);
+
+    auto verifier = libzcash::ProofVerifier::Strict();
+    auto disabledVerifier = libzcash::ProofVerifier::Disabled();
+    CCuckooCacheStats before = GetJoinSplitCacheStats();
+
+    // A disabled verifier does not touch the cache.
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, disabledVerifier, pubKeyHash, CACHE_STORE));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nMisses, before.nMisses);
+
+    // Verified once on the way into the mempool, then found in the cache.
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_STORE));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nMisses, before.nMisses + 1);
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_STORE));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nHits, before.nHits + 1);
+
+    // The entry does not vouch for the proof under other public inputs.
+    BOOST_CHECK(!VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, GetRandHash(), CACHE_STORE));
+    JSDescription changed = jsdesc;
+    changed.anchor = GetRandHash();
+    BOOST_CHECK(!VerifyJoinSplitCached(changed, *pzcashParams, verifier, pubKeyHash, CACHE_STORE));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nMisses, before.nMisses + 3);
+
+    // Connecting the block uses the entry up, so the next check verifies
+    // the proof again, without caching it.
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_ERASE));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nHits, before.nHits + 2);
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_ERASE));
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_ERASE));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nHits, before.nHits + 2);
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nMisses, before.nMisses + 5);
+
+    // Checks of mined transactions, such as loading the wallet, neither add
+    // the proof to the cache nor drop it.
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_LOOKUP));
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_LOOKUP));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nMisses, before.nMisses + 7);
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_STORE));
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_LOOKUP));
+    BOOST_CHECK(VerifyJoinSplitCached(jsdesc, *pzcashParams, verifier, pubKeyHash, CACHE_LOOKUP));
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nHits, before.nHits + 4);
+    BOOST_CHECK_EQUAL(GetJoinSplitCacheStats().nMisses, before.nMisses + 8);
+}
+
 BOOST_AUTO_TEST_CASE(test_simple_joinsplit_invalidity)
 {
     auto verifier = libzcash::ProofVerifier::Strict();
@@ -0,0 +1,71 @@
+// Copyright (c) 2018 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validationinterface.h"
+
+#include "primitives/block.h"
+#include "test/test_bitcoin.h"
+
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, BasicTestingSetup)
+
+class CTestListener : public CValidationInterface
+{
+public:
+    std::thread::id threadId;
+    std::vector<uint256> vSynced;
+    std::vector<bool> vAdded;
+
+protected:
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+    {
+        threadId = std::this_thread::get_id();
+        vSynced.push_back(tx.GetHash());
+    }
+
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+    {
+        vAdded.push_back(added);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(async_listener_order)
+{
+    CTestListener listener;
+    RegisterValidationInterface(&listener, true);
+
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    std::vector<uint256> vExpected;
+    for (int i = 0; i < 100; i++) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        pblock->vtx.push_back(mtx);
+        vExpected.push_back(pblock->vtx.back().GetHash());
+    }
+    std::shared_ptr<const ZCIncrementalMerkleTree> tree = std::make_shared<ZCIncrementalMerkleTree>();
+    for (const CTransaction& tx : pblock->vtx)
+        SyncWithWallets(std::shared_ptr<const CTransaction>(pblock, &tx), pblock);
+    GetMainSignals().ChainTip(NULL, pblock, tree, true);
+    GetMainSignals().ChainTip(NULL, pblock, tree, false);
+    // The listener holds on to the block, not us.
+    pblock.reset();
+
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(listener.vSynced == vExpected);
+    BOOST_CHECK(listener.threadId != std::this_thread::get_id());
+    BOOST_CHECK_EQUAL(listener.vAdded.size(), 2);
+    BOOST_CHECK(listener.vAdded[0] && !listener.vAdded[1]);
+
+    // Nothing is delivered once unregistered.
+    UnregisterValidationInterface(&listener);
+    CMutableTransaction mtx;
+    SyncWithWallets(std::make_shared<const CTransaction>(mtx));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(listener.vSynced.size(), 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,11 +8,18 @@
 #include "chainparams.h"
 #include "hash.h"
 #include "main.h"
+#include "memusage.h"
 #include "pow.h"
 #include "uint256.h"
+#include "utiltime.h"
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -22,14 +29,24 @@ static const char DB_NULLIFIER = 's';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
+static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_ANCHOR = 'a';
+static const char DB_COINS_STATS = 'U';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+static const char DB_BLOCK_FILTER = 'G';
+static const char DB_COMPACT_BLOCK = 'C';
+
+//! Smallest number of nullifiers the nullifier filter is sized for.
+static const size_t MIN_NULLIFIER_FILTER_ELEMENTS = 1 << 16;
+
 
 void static BatchWriteAnchor(CLevelDBBatch &batch,
                              const uint256 &croot,
@@ -57,6 +74,54 @@ void static BatchWriteCoins(CLevelDBBatch &batch, const uint256 &hash, const CCo
         batch.Write(make_pair(DB_COINS, hash), coins);
 }
 
+/** Add (or remove) output n of txid to (from) the running statistics. */
+void static ApplyTxOutStats(CCoinsDBStats &stats, const uint256 &txid, unsigned int n, const CCoins &coins, bool fAdd) {
+    const CTxOut &out = coins.vout[n];
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << txid;
+    ss << VARINT(n);
+    ss << VARINT(coins.nHeight);
+    ss << (coins.fCoinBase ? 'c' : 'n');
+    ss << out;
+    const unsigned char *data = (const unsigned char*)&ss[0];
+    if (fAdd) {
+        stats.muhash.Insert(data, ss.size());
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += out.nValue;
+    } else {
+        stats.muhash.Remove(data, ss.size());
+        stats.nTransactionOutputs--;
+        stats.nTotalAmount -= out.nValue;
+    }
+}
+
+/** Update the running statistics for the coins of txid changing from oldCoins to newCoins. */
+void static ApplyCoinsStats(CCoinsDBStats &stats, const uint256 &txid, const CCoins &oldCoins, const CCoins &newCoins) {
+    if (!oldCoins.IsPruned()) {
+        stats.nTransactions--;
+        stats.nSerializedSize -= 32 + ::GetSerializeSize(oldCoins, SER_DISK, CLIENT_VERSION);
+    }
+    if (!newCoins.IsPruned()) {
+        stats.nTransactions++;
+        stats.nSerializedSize += 32 + ::GetSerializeSize(newCoins, SER_DISK, CLIENT_VERSION);
+    }
+
+    // Usually only some outputs were spent; the rest stay in the set as they are.
+    bool fSameTx = !oldCoins.IsPruned() && !newCoins.IsPruned() &&
+        oldCoins.nHeight == newCoins.nHeight && oldCoins.fCoinBase == newCoins.fCoinBase;
+    size_t nOutputs = std::max(oldCoins.vout.size(), newCoins.vout.size());
+    for (unsigned int i = 0; i < nOutputs; i++) {
+        bool fOld = i < oldCoins.vout.size() && !oldCoins.vout[i].IsNull();
+        bool fNew = i < newCoins.vout.size() && !newCoins.vout[i].IsNull();
+        if (fSameTx && fOld && fNew && oldCoins.vout[i] == newCoins.vout[i])
+            continue;
+        if (fOld)
+            ApplyTxOutStats(stats, txid, i, oldCoins, false);
+        if (fNew)
+            ApplyTxOutStats(stats, txid, i, newCoins, true);
+    }
+}
+
 void static BatchWriteHashBestChain(CLevelDBBatch &batch, const uint256 &hash) {
     batch.Write(DB_BEST_BLOCK, hash);
 }
@@ -65,12 +130,169 @@ void static BatchWriteHashBestAnchor(CLevelDBBatch &batch, const uint256 &hash)
     batch.Write(DB_BEST_ANCHOR, hash);
 }
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe), nullifierFilter(MIN_NULLIFIER_FILTER_ELEMENTS), fKeepStats(GetBoolArg("-txoutsetstats", DEFAULT_TXOUTSET_STATS)), fStatsValid(false) {
+    LoadNullifierFilter();
+    LoadStats();
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe), nullifierFilter(MIN_NULLIFIER_FILTER_ELEMENTS), fKeepStats(GetBoolArg("-txoutsetstats", DEFAULT_TXOUTSET_STATS)), fStatsValid(false) {
+    LoadNullifierFilter();
+    LoadStats();
 }
 
+void CCoinsViewDB::LoadNullifierFilter() {
+    int64_t nStart = GetTimeMicros();
+    std::vector<uint256> vNullifiers;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_NULLIFIER;
+    pcursor->Seek(ssKeySet.str());
+    while (pcursor->Valid()) {
+        leveldb::Slice slKey = pcursor->key();
+        CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+        char chType;
+        ssKey >> chType;
+        if (chType != DB_NULLIFIER)
+            break;
+        uint256 nf;
+        ssKey >> nf;
+        vNullifiers.push_back(nf);
+        pcursor->Next();
+    }
+
+    // Leave room for the set to double before the filter needs rebuilding.
+    CBlockedBloomFilter filter(std::max(MIN_NULLIFIER_FILTER_ELEMENTS, vNullifiers.size() * 2));
+    for (const uint256& nf : vNullifiers) {
+        filter.insert(nf);
+    }
+    {
+        std::lock_guard<std::mutex> lock(cs_nullifiers);
+        nullifierFilter.swap(filter);
+    }
+    LogPrint("coindb", "Loaded %u nullifiers into the nullifier filter (%u bytes) in %dms\n",
+        (unsigned int)vNullifiers.size(), (unsigned int)nullifierFilter.DynamicMemoryUsage(), (GetTimeMicros() - nStart) / 1000);
+}
+
+void CCoinsViewDB::UpdateNullifierFilter(const CNullifiersMap &mapNullifiers) {
+    // Only the writer inserts, so a rebuild here cannot miss nullifiers that
+    // are already in the database; the batch's own are added afterwards.
+    bool fSaturated;
+    {
+        std::lock_guard<std::mutex> lock(cs_nullifiers);
+        fSaturated = nullifierFilter.IsSaturated();
+    }
+    if (fSaturated)
+        LoadNullifierFilter();
+
+    std::lock_guard<std::mutex> lock(cs_nullifiers);
+    for (CNullifiersMap::const_iterator it = mapNullifiers.begin(); it != mapNullifiers.end(); it++) {
+        if ((it->second.flags & CNullifiersCacheEntry::DIRTY) && it->second.entered)
+            nullifierFilter.insert(it->first);
+    }
+}
+
+void CCoinsViewDB::LoadStats() {
+    // A record left by a run with the option on is only used again if the
+    // best block still matches, in which case so does the coin set.
+    if (!fKeepStats)
+        return;
+
+    CCoinsDBStats stats;
+    uint256 hashBestBlock = GetBestBlock();
+    bool fValid = true;
+    if (!db.Read(DB_COINS_STATS, stats) || stats.hashBlock != hashBestBlock) {
+        // Written by a version that did not keep statistics, or an empty database.
+        stats = CCoinsDBStats();
+        if (!hashBestBlock.IsNull()) {
+            int64_t nStart = GetTimeMillis();
+            LogPrintf("Computing coin database statistics...\n");
+            fValid = ComputeStats(stats) && db.Write(DB_COINS_STATS, stats);
+            LogPrintf("Computed coin database statistics in %dms\n", GetTimeMillis() - nStart);
+        }
+    }
+    std::lock_guard<std::mutex> lock(cs_stats);
+    coinsStats = stats;
+    fStatsValid = fValid;
+}
+
+bool CCoinsViewDB::ComputeStats(CCoinsDBStats &stats) const {
+    /* It seems that there are no "const iterators" for LevelDB.  Since we
+       only need read operations on it, use a const-cast to get around
+       that restriction.  */
+    boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    pcursor->SeekToFirst();
+
+    stats = CCoinsDBStats();
+    stats.hashBlock = GetBestBlock();
+    const CCoins noCoins;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType;
+            if (chType == DB_COINS) {
+                leveldb::Slice slValue = pcursor->value();
+                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+                CCoins coins;
+                ssValue >> coins;
+                uint256 txhash;
+                ssKey >> txhash;
+                ApplyCoinsStats(stats, txhash, noCoins, coins);
+            } else if (chType == DB_NULLIFIER) {
+                stats.nNullifiers++;
+            }
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    return true;
+}
+
+void CCoinsViewDB::WriteStats(CLevelDBBatch &batch,
+                              const CCoinsMap &mapCoins,
+                              const uint256 &hashBlock,
+                              const CNullifiersMap &mapNullifiers,
+                              CCoinsDBStats &stats) const {
+    {
+        std::lock_guard<std::mutex> lock(cs_stats);
+        if (!fStatsValid)
+            return;
+        stats = coinsStats;
+    }
+
+    const CCoins noCoins;
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY))
+            continue;
+        // Fresh entries are known not to be in the database.
+        CCoins oldCoins;
+        if (!(it->second.flags & CCoinsCacheEntry::FRESH))
+            db.Read(make_pair(DB_COINS, it->first), oldCoins);
+        ApplyCoinsStats(stats, it->first, oldCoins, it->second.coins);
+    }
+    for (CNullifiersMap::const_iterator it = mapNullifiers.begin(); it != mapNullifiers.end(); it++) {
+        if (!(it->second.flags & CNullifiersCacheEntry::DIRTY))
+            continue;
+        bool fSpent = GetNullifier(it->first);
+        if (it->second.entered && !fSpent)
+            stats.nNullifiers++;
+        else if (!it->second.entered && fSpent)
+            stats.nNullifiers--;
+    }
+    if (!hashBlock.IsNull())
+        stats.hashBlock = hashBlock;
+
+    batch.Write(DB_COINS_STATS, stats);
+}
+
+void CCoinsViewDB::CommitStats(const CCoinsDBStats &stats) {
+    std::lock_guard<std::mutex> lock(cs_stats);
+    if (fStatsValid)
+        coinsStats = stats;
+}
 
 bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree) const {
     if (rt == ZCIncrementalMerkleTree::empty_root()) {
@@ -85,6 +307,12 @@ bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree)
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
+    {
+        std::lock_guard<std::mutex> lock(cs_nullifiers);
+        if (!nullifierFilter.contains(nf))
+            return false;
+    }
+
     bool spent = false;
     bool read = db.Read(make_pair(DB_NULLIFIER, nf), spent);
 
@@ -119,6 +347,10 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
                               CAnchorsMap &mapAnchors,
                               CNullifiersMap &mapNullifiers) {
     CLevelDBBatch batch;
+    CCoinsDBStats stats;
+    WriteStats(batch, mapCoins, hashBlock, mapNullifiers, stats);
+    UpdateNullifierFilter(mapNullifiers);
+
     size_t count = 0;
     size_t changed = 0;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
@@ -155,9 +387,305 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
         BatchWriteHashBestAnchor(batch, hashAnchor);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    if (!db.WriteBatch(batch))
+        return false;
+    CommitStats(stats);
+    return true;
+}
+
+bool CCoinsViewDB::WriteSnapshot(const CCoinsMap &mapCoins,
+                                 const uint256 &hashBlock,
+                                 const uint256 &hashAnchor,
+                                 const CAnchorsMap &mapAnchors,
+                                 const CNullifiersMap &mapNullifiers) {
+    CLevelDBBatch batch;
+    CCoinsDBStats stats;
+    WriteStats(batch, mapCoins, hashBlock, mapNullifiers, stats);
+    UpdateNullifierFilter(mapNullifiers);
+
+    size_t changed = 0;
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            BatchWriteCoins(batch, it->first, it->second.coins);
+            changed++;
+        }
+    }
+    for (CAnchorsMap::const_iterator it = mapAnchors.begin(); it != mapAnchors.end(); it++) {
+        if (it->second.flags & CAnchorsCacheEntry::DIRTY)
+            BatchWriteAnchor(batch, it->first, it->second.tree, it->second.entered);
+    }
+    for (CNullifiersMap::const_iterator it = mapNullifiers.begin(); it != mapNullifiers.end(); it++) {
+        if (it->second.flags & CNullifiersCacheEntry::DIRTY)
+            BatchWriteNullifier(batch, it->first, it->second.entered);
+    }
+
+    if (!hashBlock.IsNull())
+        BatchWriteHashBestChain(batch, hashBlock);
+    if (!hashAnchor.IsNull())
+        BatchWriteHashBestAnchor(batch, hashAnchor);
+
+    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)mapCoins.size());
+    if (!db.WriteBatch(batch))
+        return false;
+    CommitStats(stats);
+    return true;
+}
+
+CCoinsViewDBCursor::CCoinsViewDBCursor(leveldb::Iterator* pcursorIn) : pcursor(pcursorIn), hasherShielded(SER_GETHASH, 0) {
+    pcursor->SeekToFirst();
+}
+
+bool CCoinsViewDBCursor::ReadChunk(SnapshotRecords &vRecords, size_t nMaxSize) {
+    vRecords.clear();
+    size_t nSize = 0;
+    const CCoins noCoins;
+    while (pcursor->Valid() && nSize < nMaxSize) {
+        leveldb::Slice slKey = pcursor->key();
+        // Only the contents of the coin set; the best block, best anchor and
+        // statistics are derived from the snapshot when it is loaded.
+        char chType = slKey.size() ? slKey[0] : 0;
+        if (chType == DB_COINS || chType == DB_NULLIFIER || chType == DB_ANCHOR) {
+            leveldb::Slice slValue = pcursor->value();
+            vRecords.push_back(std::make_pair(slKey.ToString(), slValue.ToString()));
+            nSize += slKey.size() + slValue.size();
+            if (chType == DB_COINS) {
+                CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+                uint256 txhash;
+                CCoins coins;
+                ssKey >> chType >> txhash;
+                ssValue >> coins;
+                ApplyCoinsStats(stats, txhash, noCoins, coins);
+            } else {
+                if (chType == DB_NULLIFIER)
+                    stats.nNullifiers++;
+                hasherShielded << vRecords.back();
+            }
+        }
+        pcursor->Next();
+    }
+    if (!pcursor->status().ok())
+        HandleError(pcursor->status());
+    return !vRecords.empty();
+}
+
+uint256 CCoinsViewDBCursor::GetShieldedHash(const uint256 &hashAnchor) const {
+    CHashWriter hasher(hasherShielded);
+    hasher << hashAnchor;
+    return hasher.GetHash();
+}
+
+CCoinsViewDBCursor* CCoinsViewDB::Cursor() const {
+    // LevelDB iterators read from an implicit snapshot of the database.
+    return new CCoinsViewDBCursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+}
+
+bool CCoinsViewDB::WriteSnapshotRecords(const SnapshotRecords &vRecords) {
+    CLevelDBBatch batch;
+    for (SnapshotRecords::const_iterator it = vRecords.begin(); it != vRecords.end(); it++) {
+        char chType = it->first.size() ? it->first[0] : 0;
+        if (chType != DB_COINS && chType != DB_NULLIFIER && chType != DB_ANCHOR)
+            return error("%s: unexpected record type %d in snapshot", __func__, (int)chType);
+        batch.WriteRaw(it->first, it->second);
+    }
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::FinishSnapshot(const uint256 &hashBlock, const uint256 &hashAnchor, const uint256 &hashSerialized, const uint256 &hashShielded) {
+    // Hash what the database holds rather than what was read from the
+    // snapshot, so that a record repeated in it cannot be counted twice.
+    boost::scoped_ptr<CCoinsViewDBCursor> pcursor(Cursor());
+    try {
+        SnapshotRecords vRecords;
+        while (pcursor->ReadChunk(vRecords, 1 << 20))
+            boost::this_thread::interruption_point();
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    CCoinsDBStats stats = pcursor->GetStats();
+    uint256 hash;
+    stats.muhash.Finalize(hash.begin());
+    if (hash != hashSerialized)
+        return error("%s: snapshot set hash %s does not match the loaded coins (%s)", __func__, hashSerialized.ToString(), hash.ToString());
+    // The nullifiers and anchors decide which JoinSplits are valid, so they
+    // must match the trusted snapshot just as the coins do.
+    hash = pcursor->GetShieldedHash(hashAnchor);
+    if (hash != hashShielded)
+        return error("%s: snapshot shielded hash %s does not match the loaded nullifiers and anchors (%s)", __func__, hashShielded.ToString(), hash.ToString());
+    stats.hashBlock = hashBlock;
+
+    CLevelDBBatch batch;
+    batch.Write(DB_COINS_STATS, stats);
+    BatchWriteHashBestChain(batch, hashBlock);
+    BatchWriteHashBestAnchor(batch, hashAnchor);
+    if (!db.WriteBatch(batch, true))
+        return false;
+
+    // The filter was built when the database was still empty.
+    LoadNullifierFilter();
+    std::lock_guard<std::mutex> lock(cs_stats);
+    coinsStats = stats;
+    fStatsValid = fKeepStats;
+    return true;
+}
+
+CCoinsViewBackgroundWriter::CCoinsViewBackgroundWriter(CCoinsViewDB *dbIn) : CCoinsViewBacked(dbIn), db(dbIn), fWriteFailed(false) { }
+
+CCoinsViewBackgroundWriter::~CCoinsViewBackgroundWriter()
+{
+    Wait();
+}
+
+std::shared_ptr<const CCoinsViewBackgroundWriter::Batch> CCoinsViewBackgroundWriter::GetPending() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return pending;
+}
+
+void CCoinsViewBackgroundWriter::WriteThread(std::shared_ptr<const Batch> batch)
+{
+    RenameThread("zcash-coinsflush");
+    int64_t nStart = GetTimeMicros();
+    bool fOk = false;
+    try {
+        fOk = db->WriteSnapshot(batch->mapCoins, batch->hashBlock, batch->hashAnchor, batch->mapAnchors, batch->mapNullifiers);
+    } catch (const std::exception& e) {
+        LogPrintf("%s: error writing to coin database: %s\n", __func__, e.what());
+    }
+    LogPrint("coindb", "Background write of %u transactions took %dms\n", (unsigned int)batch->mapCoins.size(), (GetTimeMicros() - nStart) / 1000);
+
+    std::lock_guard<std::mutex> lock(cs);
+    if (!fOk) {
+        // Keep serving the batch: the database does not have it.
+        fWriteFailed = true;
+        return;
+    }
+    pending.reset();
+}
+
+bool CCoinsViewBackgroundWriter::Wait() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_writer);
+        if (writer.joinable())
+            writer.join();
+    }
+    std::lock_guard<std::mutex> lock(cs);
+    return !fWriteFailed;
+}
+
+size_t CCoinsViewBackgroundWriter::PendingMemoryUsage() const
+{
+    std::shared_ptr<const Batch> batch = GetPending();
+    return batch ? batch->nUsage : 0;
+}
+
+bool CCoinsViewBackgroundWriter::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree) const {
+    std::shared_ptr<const Batch> batch = GetPending();
+    if (batch) {
+        CAnchorsMap::const_iterator it = batch->mapAnchors.find(rt);
+        if (it != batch->mapAnchors.end()) {
+            if (!it->second.entered)
+                return false;
+            tree = it->second.tree;
+            return true;
+        }
+    }
+    return base->GetAnchorAt(rt, tree);
+}
+
+bool CCoinsViewBackgroundWriter::GetNullifier(const uint256 &nullifier) const {
+    std::shared_ptr<const Batch> batch = GetPending();
+    if (batch) {
+        CNullifiersMap::const_iterator it = batch->mapNullifiers.find(nullifier);
+        if (it != batch->mapNullifiers.end())
+            return it->second.entered;
+    }
+    return base->GetNullifier(nullifier);
+}
+
+bool CCoinsViewBackgroundWriter::GetCoins(const uint256 &txid, CCoins &coins) const {
+    std::shared_ptr<const Batch> batch = GetPending();
+    if (batch) {
+        CCoinsMap::const_iterator it = batch->mapCoins.find(txid);
+        if (it != batch->mapCoins.end()) {
+            // Pruned entries are being erased from the database.
+            if (it->second.coins.IsPruned())
+                return false;
+            coins = it->second.coins;
+            return true;
+        }
+    }
+    return base->GetCoins(txid, coins);
+}
+
+bool CCoinsViewBackgroundWriter::HaveCoins(const uint256 &txid) const {
+    std::shared_ptr<const Batch> batch = GetPending();
+    if (batch) {
+        CCoinsMap::const_iterator it = batch->mapCoins.find(txid);
+        if (it != batch->mapCoins.end())
+            return !it->second.coins.IsPruned();
+    }
+    return base->HaveCoins(txid);
+}
+
+uint256 CCoinsViewBackgroundWriter::GetBestBlock() const {
+    std::shared_ptr<const Batch> batch = GetPending();
+    if (batch && !batch->hashBlock.IsNull())
+        return batch->hashBlock;
+    return base->GetBestBlock();
+}
+
+uint256 CCoinsViewBackgroundWriter::GetBestAnchor() const {
+    std::shared_ptr<const Batch> batch = GetPending();
+    if (batch && !batch->hashAnchor.IsNull())
+        return batch->hashAnchor;
+    return base->GetBestAnchor();
+}
+
+bool CCoinsViewBackgroundWriter::BatchWrite(CCoinsMap &mapCoins,
+                                            const uint256 &hashBlock,
+                                            const uint256 &hashAnchor,
+                                            CAnchorsMap &mapAnchors,
+                                            CNullifiersMap &mapNullifiers) {
+    std::lock_guard<std::mutex> lockWriter(cs_writer);
+    // Writes must reach the database in order, and a failed write leaves
+    // the database behind the caches above; refuse to write on top of it.
+    if (writer.joinable())
+        writer.join();
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fWriteFailed)
+            return false;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->mapCoins.swap(mapCoins);
+    batch->hashBlock = hashBlock;
+    batch->hashAnchor = hashAnchor;
+    batch->mapAnchors.swap(mapAnchors);
+    batch->mapNullifiers.swap(mapNullifiers);
+    batch->nUsage = memusage::DynamicUsage(batch->mapCoins) +
+                    memusage::DynamicUsage(batch->mapAnchors) +
+                    memusage::DynamicUsage(batch->mapNullifiers);
+    for (CCoinsMap::const_iterator it = batch->mapCoins.begin(); it != batch->mapCoins.end(); it++)
+        batch->nUsage += it->second.coins.DynamicMemoryUsage();
+    for (CAnchorsMap::const_iterator it = batch->mapAnchors.begin(); it != batch->mapAnchors.end(); it++)
+        batch->nUsage += it->second.tree.DynamicMemoryUsage();
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        pending = batch;
+    }
+    writer = std::thread(&CCoinsViewBackgroundWriter::WriteThread, this, std::shared_ptr<const Batch>(batch));
+    return true;
+}
+
+bool CCoinsViewBackgroundWriter::GetStats(CCoinsStats &stats) const {
+    // The statistics are computed from the database itself.
+    Wait();
+    return base->GetStats(stats);
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -181,59 +709,59 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
-bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
-    /* It seems that there are no "const iterators" for LevelDB.  Since we
-       only need read operations on it, use a const-cast to get around
-       that restriction.  */
+bool CCoinsViewDB::ForEachCoins(const std::function<bool(const uint256&, const CCoins&)> &fn) const {
     boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_COINS;
+    pcursor->Seek(ssKeySet.str());
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = GetBestBlock();
-    ss << stats.hashBlock;
-    CAmount nTotalAmount = 0;
-    while (pcursor->Valid()) {
+    for (; pcursor->Valid(); pcursor->Next()) {
         boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.empty() || slKey[0] != DB_COINS)
+            break;
         try {
-            leveldb::Slice slKey = pcursor->key();
             CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
             char chType;
-            ssKey >> chType;
-            if (chType == DB_COINS) {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-                stats.nTransactions++;
-                for (unsigned int i=0; i<coins.vout.size(); i++) {
-                    const CTxOut &out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i+1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
-                }
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
-            }
-            pcursor->Next();
+            uint256 txhash;
+            ssKey >> chType >> txhash;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoins coins;
+            ssValue >> coins;
+            if (!fn(txhash, coins))
+                break;
         } catch (const std::exception& e) {
             return error("%s: Deserialize or I/O error - %s", __func__, e.what());
         }
     }
+    return true;
+}
+
+bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    CCoinsDBStats dbStats;
+    bool fValid;
+    {
+        std::lock_guard<std::mutex> lock(cs_stats);
+        fValid = fStatsValid;
+        dbStats = coinsStats;
+    }
+    if (!fValid && !ComputeStats(dbStats))
+        return false;
+
+    stats.hashBlock = dbStats.hashBlock;
+    stats.nTransactions = dbStats.nTransactions;
+    stats.nTransactionOutputs = dbStats.nTransactionOutputs;
+    stats.nSerializedSize = dbStats.nSerializedSize;
+    stats.nTotalAmount = dbStats.nTotalAmount;
+    stats.nNullifiers = dbStats.nNullifiers;
+    dbStats.muhash.Finalize(stats.hashSerialized.begin());
     {
         LOCK(cs_main);
-        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
+        BlockMap::const_iterator it = mapBlockIndex.find(stats.hashBlock);
+        if (it != mapBlockIndex.end())
+            stats.nHeight = it->second->nHeight;
     }
-    stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
     return true;
 }
 
@@ -249,6 +777,13 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::WriteSnapshotBlockIndex(const std::vector<CDiskBlockIndex> &vIndex) {
+    CLevelDBBatch batch;
+    for (std::vector<CDiskBlockIndex>::const_iterator it = vIndex.begin(); it != vIndex.end(); it++)
+        batch.Write(make_pair(DB_BLOCK_INDEX, it->GetBlockHash()), *it);
+    return WriteBatch(batch);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
     return Read(make_pair(DB_TXINDEX, txid), pos);
 }
@@ -260,6 +795,145 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(const uint160 &addressHash, int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &vect,
+                                    int nStart, int nEnd) {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    // The entries of an address share this prefix and follow it in height
+    // order, so a height range is a single seek and scan.
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_ADDRESSINDEX << (uint8_t)type << addressHash;
+    std::string strPrefix = ssKeySet.str();
+    if (nStart > 0)
+        ser_writedata32be(ssKeySet, nStart);
+    pcursor->Seek(ssKeySet.str());
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (!slKey.starts_with(strPrefix))
+            break;
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressIndexKey indexKey;
+            ssKey >> chType >> indexKey;
+            if (nEnd > 0 && indexKey.blockHeight > nEnd)
+                break;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAmount nValue;
+            ssValue >> nValue;
+            vect.push_back(make_pair(indexKey, nValue));
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        else
+            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(const uint160 &addressHash, int type,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect) {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_ADDRESSUNSPENTINDEX << (uint8_t)type << addressHash;
+    std::string strPrefix = ssKeySet.str();
+    pcursor->Seek(strPrefix);
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (!slKey.starts_with(strPrefix))
+            break;
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CAddressUnspentKey indexKey;
+            ssKey >> chType >> indexKey;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAddressUnspentValue value;
+            ssValue >> value;
+            vect.push_back(make_pair(indexKey, value));
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect) {
+    CLevelDBBatch batch;
+    for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair(DB_SPENTINDEX, it->first));
+        else
+            batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) {
+    return Read(make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool CBlockTreeDB::WipeAddressIndexes(bool fAddressIndex, bool fSpentIndex) {
+    std::vector<char> vPrefixes;
+    if (fAddressIndex) {
+        vPrefixes.push_back(DB_ADDRESSINDEX);
+        vPrefixes.push_back(DB_ADDRESSUNSPENTINDEX);
+    }
+    if (fSpentIndex)
+        vPrefixes.push_back(DB_SPENTINDEX);
+
+    BOOST_FOREACH(char chPrefix, vPrefixes) {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+        CLevelDBBatch batch;
+        size_t nErased = 0;
+        for (pcursor->Seek(std::string(1, chPrefix)); pcursor->Valid(); pcursor->Next()) {
+            leveldb::Slice slKey = pcursor->key();
+            if (slKey.empty() || slKey[0] != chPrefix)
+                break;
+            batch.EraseRaw(slKey.ToString());
+            if (++nErased % 10000 == 0) {
+                if (!WriteBatch(batch))
+                    return false;
+                batch = CLevelDBBatch();
+            }
+        }
+        if (!WriteBatch(batch))
+            return false;
+    }
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -272,30 +946,176 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts()
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &hash, CDiskBlockIndex &dbindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, hash), dbindex);
+}
+
+namespace {
+
+/** A block index entry decoded by a loader thread, waiting to be linked. */
+struct CDecodedBlockIndex
 {
-    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    uint256 hash;
+    CDiskBlockIndex diskindex;
+};
 
-    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
-    ssKeySet << make_pair(DB_BLOCK_INDEX, uint256());
-    pcursor->Seek(ssKeySet.str());
+typedef std::vector<CDecodedBlockIndex> DecodedBatch;
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
+/** Entries handed from a loader thread to the linking thread at a time. */
+const size_t LOAD_BATCH_SIZE = 1024;
+/** Batches that may be waiting to be linked before the loaders block. */
+const size_t LOAD_QUEUE_DEPTH = 64;
+/** Upper bound on loader threads; beyond this LevelDB reads dominate. */
+const int MAX_LOAD_THREADS = 8;
+
+/**
+ * Bounded queue of decoded batches. Loader threads push, the linking thread
+ * pops until every loader has finished. The first error aborts the load.
+ */
+class CBlockIndexLoadQueue
+{
+private:
+    std::mutex mutex;
+    std::condition_variable condProduced;
+    std::condition_variable condConsumed;
+    std::deque<DecodedBatch> queue;
+    int nLoaders;
+    bool fAbort;
+    std::string strError;
+
+public:
+    explicit CBlockIndexLoadQueue(int nLoadersIn) : nLoaders(nLoadersIn), fAbort(false) {}
+
+    //! Returns false if the load has been aborted.
+    bool Push(DecodedBatch&& batch)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condConsumed.wait(lock, [this]{ return fAbort || queue.size() < LOAD_QUEUE_DEPTH; });
+        if (fAbort)
+            return false;
+        queue.push_back(std::move(batch));
+        condProduced.notify_one();
+        return true;
+    }
+
+    //! Returns false once all loaders are done and the queue is drained.
+    bool Pop(DecodedBatch& batch)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condProduced.wait(lock, [this]{ return fAbort || !queue.empty() || nLoaders == 0; });
+        if (fAbort || queue.empty())
+            return false;
+        batch = std::move(queue.front());
+        queue.pop_front();
+        condConsumed.notify_one();
+        return true;
+    }
+
+    void LoaderDone()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nLoaders--;
+        condProduced.notify_all();
+    }
+
+    void Abort(const std::string& strErrorIn = "")
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!fAbort && !strErrorIn.empty())
+            strError = strErrorIn;
+        fAbort = true;
+        condProduced.notify_all();
+        condConsumed.notify_all();
+    }
+
+    std::string GetError()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return strError;
+    }
+};
+
+/**
+ * Decode the block index entries whose hash starts with a byte in
+ * [nBegin, nEnd), checking proof of work as we go. This is where nearly all
+ * of the load time goes (deserialization and hashing the Equihash header).
+ */
+void LoadBlockIndexShard(CBlockTreeDB* pdb, unsigned int nBegin, unsigned int nEnd, CBlockIndexLoadQueue* pqueue)
+{
+    try {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(pdb->NewIterator());
+
+        uint256 hashStart;
+        *hashStart.begin() = nBegin;
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << make_pair(DB_BLOCK_INDEX, hashStart);
+        pcursor->Seek(ssKeySet.str());
+
+        DecodedBatch batch;
+        batch.reserve(LOAD_BATCH_SIZE);
+        for (; pcursor->Valid(); pcursor->Next()) {
+            // Keys are DB_BLOCK_INDEX followed by the raw block hash.
             leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == DB_BLOCK_INDEX) {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskindex;
-                ssValue >> diskindex;
+            if (slKey.size() < 2 || slKey[0] != DB_BLOCK_INDEX || (unsigned char)slKey[1] >= nEnd)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            batch.emplace_back();
+            CDecodedBlockIndex& entry = batch.back();
+            ssValue >> entry.diskindex;
+            entry.hash = entry.diskindex.GetBlockHash();
+
+            if (!CheckProofOfWork(entry.hash, entry.diskindex.nBits, Params().GetConsensus())) {
+                pqueue->Abort(strprintf("CheckProofOfWork failed: %s", entry.diskindex.ToString()));
+                break;
+            }
+            // The solution is not kept in memory; see CBlockIndex::GetSolution().
+            std::vector<unsigned char>().swap(entry.diskindex.nSolution);
+
+            if (batch.size() == LOAD_BATCH_SIZE) {
+                if (!pqueue->Push(std::move(batch)))
+                    break;
+                batch = DecodedBatch();
+                batch.reserve(LOAD_BATCH_SIZE);
+            }
+        }
+        if (!batch.empty())
+            pqueue->Push(std::move(batch));
+    } catch (const std::exception& e) {
+        pqueue->Abort(strprintf("Deserialize or I/O error - %s", e.what()));
+    }
+    pqueue->LoaderDone();
+}
+
+} // anon namespace
+
+bool CBlockTreeDB::LoadBlockIndexGuts()
+{
+    int64_t nStart = GetTimeMicros();
+
+    // Block hashes are uniformly distributed, so splitting on the first
+    // byte of the hash gives each loader a similar share of the entries.
+    int nLoaders = std::max(1, std::min(GetNumCores(), MAX_LOAD_THREADS));
+    CBlockIndexLoadQueue queue(nLoaders);
+    std::vector<std::thread> loaders;
+    for (int i = 0; i < nLoaders; i++) {
+        loaders.emplace_back(LoadBlockIndexShard, this, 256 * i / nLoaders, 256 * (i + 1) / nLoaders, &queue);
+    }
+
+    // Link entries into mapBlockIndex as they arrive. InsertBlockIndex
+    // creates placeholders for parents that have not been seen yet, so the
+    // order across shards does not matter.
+    size_t nLoaded = 0;
+    try {
+        DecodedBatch batch;
+        while (queue.Pop(batch)) {
+            boost::this_thread::interruption_point();
+            BOOST_FOREACH(const CDecodedBlockIndex& entry, batch) {
+                const CDiskBlockIndex& diskindex = entry.diskindex;
 
                 // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = InsertBlockIndex(entry.hash);
                 pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -307,23 +1127,68 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 pindexNew->nTime          = diskindex.nTime;
                 pindexNew->nBits          = diskindex.nBits;
                 pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
                 pindexNew->nTx            = diskindex.nTx;
                 pindexNew->nSproutValue   = diskindex.nSproutValue;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
-                    return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
-
-                pcursor->Next();
-            } else {
-                break; // if shutdown requested or finished loading block index
             }
-        } catch (const std::exception& e) {
-            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            nLoaded += batch.size();
         }
+    } catch (...) {
+        queue.Abort();
+        BOOST_FOREACH(std::thread& loader, loaders) {
+            loader.join();
+        }
+        throw;
+    }
+    BOOST_FOREACH(std::thread& loader, loaders) {
+        loader.join();
+    }
+
+    std::string strError = queue.GetError();
+    if (!strError.empty())
+        return error("LoadBlockIndex(): %s", strError);
+
+    LogPrintf("%s: loaded %u block index entries in %dms using %d threads\n", __func__,
+        nLoaded, (GetTimeMicros() - nStart) / 1000, nLoaders);
+    return true;
+}
+
+CBlockFilterDB::CBlockFilterDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "filter", nCacheSize, fMemory, fWipe) {
+}
+
+bool CBlockFilterDB::WriteBlock(const CBlockFilter &filter, const uint256 &hashHeader, const CCompactShieldedBlock &compact) {
+    CLevelDBBatch batch;
+    batch.Write(make_pair(DB_BLOCK_FILTER, filter.GetBlockHash()), make_pair(hashHeader, filter.GetEncoded()));
+    batch.Write(make_pair(DB_COMPACT_BLOCK, filter.GetBlockHash()), compact);
+    return WriteBatch(batch);
+}
+
+bool CBlockFilterDB::HaveBlock(const uint256 &hashBlock) const {
+    return Exists(make_pair(DB_BLOCK_FILTER, hashBlock));
+}
+
+bool CBlockFilterDB::ReadFilter(const uint256 &hashBlock, CBlockFilter &filter, uint256 &hashHeader) const {
+    std::pair<uint256, std::vector<unsigned char> > value;
+    if (!Read(make_pair(DB_BLOCK_FILTER, hashBlock), value))
+        return false;
+    try {
+        filter = CBlockFilter(hashBlock, value.second);
+    } catch (const std::exception& e) {
+        return error("%s: invalid filter of block %s: %s", __func__, hashBlock.ToString(), e.what());
     }
+    hashHeader = value.first;
+    return true;
+}
 
+bool CBlockFilterDB::ReadFilterHeader(const uint256 &hashBlock, uint256 &hashHeader) const {
+    std::pair<uint256, std::vector<unsigned char> > value;
+    if (!Read(make_pair(DB_BLOCK_FILTER, hashBlock), value))
+        return false;
+    hashHeader = value.first;
     return true;
 }
+
+bool CBlockFilterDB::ReadCompactBlock(const uint256 &hashBlock, CCompactShieldedBlock &compact) const {
+    return Read(make_pair(DB_COMPACT_BLOCK, hashBlock), compact);
+}
@@ -6,25 +6,99 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include "addressindex.h"
+#include "blockfilter.h"
+#include "bloom.h"
 #include "coins.h"
+#include "crypto/muhash.h"
+#include "hash.h"
 #include "leveldbwrapper.h"
+#include "spentindex.h"
 
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 class CBlockFileInfo;
 class CBlockIndex;
+class CDiskBlockIndex;
 struct CDiskTxPos;
 class uint256;
 
+//! Raw keys and values of database records, as stored in a snapshot.
+typedef std::vector<std::pair<std::string, std::string> > SnapshotRecords;
+
 //! -dbcache default (MiB)
 static const int64_t nDefaultDbCache = 450;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -txoutsetstats default
+static const bool DEFAULT_TXOUTSET_STATS = false;
+
+/**
+ * Running totals over the coin database, written in the same batch as the
+ * best block so that gettxoutsetinfo does not have to scan the database.
+ */
+struct CCoinsDBStats
+{
+    uint256 hashBlock;
+    //! Set hash of every unspent output, with its txid, index, height and
+    //! coinbase flag.
+    MuHash3072 muhash;
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    uint64_t nSerializedSize;
+    CAmount nTotalAmount;
+    uint64_t nNullifiers;
+
+    CCoinsDBStats() : nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0), nNullifiers(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlock);
+        READWRITE(muhash);
+        READWRITE(nTransactions);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nSerializedSize);
+        READWRITE(nTotalAmount);
+        READWRITE(nNullifiers);
+    }
+};
+
+/** Reads the coins, nullifier and anchor records of the coin database in
+ *  key order, as they were when the cursor was created, and hashes them as
+ *  it goes. */
+class CCoinsViewDBCursor
+{
+private:
+    std::unique_ptr<leveldb::Iterator> pcursor;
+    //! Statistics, including the set hash, of the coins read so far
+    CCoinsDBStats stats;
+    //! Hash of the nullifier and anchor records read so far
+    CHashWriter hasherShielded;
+
+public:
+    CCoinsViewDBCursor(leveldb::Iterator* pcursorIn);
+
+    //! Read records until there are at least nMaxSize bytes of them.
+    //! Returns false once all records have been read.
+    bool ReadChunk(SnapshotRecords &vRecords, size_t nMaxSize);
+
+    //! Statistics of the records read so far; hashBlock is left unset.
+    const CCoinsDBStats &GetStats() const { return stats; }
+    //! Hash of the nullifier and anchor records read so far, and of
+    //! hashAnchor, the best anchor they go with.
+    uint256 GetShieldedHash(const uint256 &hashAnchor) const;
+};
 
 /** CCoinsView backed by the LevelDB coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
@@ -32,6 +106,49 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CLevelDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /**
+     * Filter over every nullifier in the database, so that lookups of unspent
+     * nullifiers (the common case) are answered without reading LevelDB.
+     * Built when the database is opened and updated before each batch is
+     * written; nullifiers removed on reorg stay in it as false positives.
+     */
+    mutable std::mutex cs_nullifiers;
+    CBlockedBloomFilter nullifierFilter;
+
+    //! Rebuild nullifierFilter from the database, sized for its contents.
+    void LoadNullifierFilter();
+    //! Add the entered nullifiers of a batch to the filter.
+    void UpdateNullifierFilter(const CNullifiersMap &mapNullifiers);
+
+    /**
+     * Statistics for the committed state of the database, kept up to date
+     * only with -txoutsetstats as each batch reads the entries it replaces.
+     * Only the writer updates them, after each batch it writes has been
+     * committed. If they could not be computed when the database was opened
+     * they are left invalid until it is opened again, and GetStats scans the
+     * database instead.
+     */
+    const bool fKeepStats;
+    mutable std::mutex cs_stats;
+    CCoinsDBStats coinsStats;
+    bool fStatsValid;
+
+    //! Read the stored statistics, recomputing them if they are missing or
+    //! do not match the best block.
+    void LoadStats();
+    //! Compute the statistics by scanning the whole database.
+    bool ComputeStats(CCoinsDBStats &stats) const;
+    //! Add the statistics for the state after a batch to it, if they are
+    //! kept. Must be called before the batch is committed, as it reads the
+    //! entries it replaces.
+    void WriteStats(CLevelDBBatch &batch,
+                    const CCoinsMap &mapCoins,
+                    const uint256 &hashBlock,
+                    const CNullifiersMap &mapNullifiers,
+                    CCoinsDBStats &stats) const;
+    //! Make the statistics of a committed batch current.
+    void CommitStats(const CCoinsDBStats &stats);
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -46,7 +163,88 @@ public:
                     const uint256 &hashAnchor,
                     CAnchorsMap &mapAnchors,
                     CNullifiersMap &mapNullifiers);
+    //! Like BatchWrite, but leaves the maps untouched so that they can be
+    //! read by other threads while the write is in progress.
+    bool WriteSnapshot(const CCoinsMap &mapCoins,
+                       const uint256 &hashBlock,
+                       const uint256 &hashAnchor,
+                       const CAnchorsMap &mapAnchors,
+                       const CNullifiersMap &mapNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    //! Call fn for each transaction with unspent outputs, in txid order,
+    //! until it returns false.
+    bool ForEachCoins(const std::function<bool(const uint256&, const CCoins&)> &fn) const;
+
+    //! Cursor for writing the database to a snapshot.
+    CCoinsViewDBCursor* Cursor() const;
+    //! Write records read from a snapshot, which may only be coins,
+    //! nullifiers and anchors.
+    bool WriteSnapshotRecords(const SnapshotRecords &vRecords);
+    //! Check the records written from a snapshot against its set hash and
+    //! shielded hash and, if they match, make hashBlock the best block.
+    bool FinishSnapshot(const uint256 &hashBlock, const uint256 &hashAnchor, const uint256 &hashSerialized, const uint256 &hashShielded);
+};
+
+/**
+ * Overlay on top of the coin database that performs batch writes from a
+ * background thread. Until a write has been committed, the entries in it are
+ * served from memory, so the caches above keep validating against a
+ * consistent view. At most one write is in flight; a new BatchWrite waits for
+ * the previous one and fails if it did.
+ */
+class CCoinsViewBackgroundWriter : public CCoinsViewBacked
+{
+private:
+    struct Batch
+    {
+        CCoinsMap mapCoins;
+        uint256 hashBlock;
+        uint256 hashAnchor;
+        CAnchorsMap mapAnchors;
+        CNullifiersMap mapNullifiers;
+        //! Memory held by the maps
+        size_t nUsage;
+    };
+
+    CCoinsViewDB *db;
+
+    //! Protects writer. Held while waiting for it, and while starting it.
+    mutable std::mutex cs_writer;
+    mutable std::thread writer;
+
+    //! Protects pending and fWriteFailed.
+    mutable std::mutex cs;
+    //! The batch being written, if any. It is not modified once published.
+    std::shared_ptr<const Batch> pending;
+    bool fWriteFailed;
+
+    std::shared_ptr<const Batch> GetPending() const;
+    void WriteThread(std::shared_ptr<const Batch> batch);
+
+public:
+    CCoinsViewBackgroundWriter(CCoinsViewDB *dbIn);
+    ~CCoinsViewBackgroundWriter();
+
+    bool GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree) const;
+    bool GetNullifier(const uint256 &nullifier) const;
+    bool GetCoins(const uint256 &txid, CCoins &coins) const;
+    bool HaveCoins(const uint256 &txid) const;
+    uint256 GetBestBlock() const;
+    uint256 GetBestAnchor() const;
+    //! Take over the contents of the maps and start writing them out.
+    bool BatchWrite(CCoinsMap &mapCoins,
+                    const uint256 &hashBlock,
+                    const uint256 &hashAnchor,
+                    CAnchorsMap &mapAnchors,
+                    CNullifiersMap &mapNullifiers);
+    bool GetStats(CCoinsStats &stats) const;
+
+    //! Wait for the write in flight, if any. Returns false if a write failed.
+    bool Wait() const;
+
+    //! Memory held by the batch being written, which counts against the
+    //! coins cache limit until the write finishes.
+    size_t PendingMemoryUsage() const;
 };
 
 /** Access to the block database (blocks/index/) */
@@ -65,9 +263,50 @@ public:
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    //! Read the entries of an address, optionally limited to blocks in
+    //! [nStart, nEnd]; an nEnd of 0 means up to the tip.
+    bool ReadAddressIndex(const uint160 &addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &vect,
+                          int nStart = 0, int nEnd = 0);
+    //! Write the entries, erasing those with a null value.
+    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressUnspentIndex(const uint160 &addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    //! Write the entries, erasing those with a null value.
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect);
+    bool ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+    //! Erase every entry of the given indexes, such as those left by a build
+    //! that was interrupted.
+    bool WipeAddressIndexes(bool fAddressIndex, bool fSpentIndex);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    bool ReadDiskBlockIndex(const uint256 &hash, CDiskBlockIndex &dbindex);
+    //! Write block index entries read from a snapshot.
+    bool WriteSnapshotBlockIndex(const std::vector<CDiskBlockIndex> &vIndex);
     bool LoadBlockIndexGuts();
 };
 
+/**
+ * Access to the block filter index database (blocks/filter/): the filter of
+ * each connected block and its header, and the compact form of its shielded
+ * transactions. Entries are keyed by block hash and never change, so they
+ * are kept when blocks are disconnected.
+ */
+class CBlockFilterDB : public CLevelDBWrapper
+{
+public:
+    CBlockFilterDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CBlockFilterDB(const CBlockFilterDB&);
+    void operator=(const CBlockFilterDB&);
+public:
+    bool WriteBlock(const CBlockFilter &filter, const uint256 &hashHeader, const CCompactShieldedBlock &compact);
+    bool HaveBlock(const uint256 &hashBlock) const;
+    bool ReadFilter(const uint256 &hashBlock, CBlockFilter &filter, uint256 &hashHeader) const;
+    bool ReadFilterHeader(const uint256 &hashBlock, uint256 &hashHeader) const;
+    bool ReadCompactBlock(const uint256 &hashBlock, CCompactShieldedBlock &compact) const;
+};
+
 #endif // BITCOIN_TXDB_H
@@ -5,49 +5,127 @@
 
 #include "validationinterface.h"
 
+#include "notificationqueue.h"
+#include "primitives/block.h"
+
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+
 static CMainSignals g_signals;
 
+/** The connections of a registered wallet, and its queue if it is asynchronous. */
+struct CValidationListener
+{
+    std::vector<boost::signals2::connection> connections;
+    std::unique_ptr<CNotificationQueue> queue;
+};
+
+static std::mutex cs_listeners;
+static std::map<CValidationInterface*, std::shared_ptr<CValidationListener> > mapListeners;
+
+static std::vector<std::shared_ptr<CValidationListener> > GetAsyncListeners()
+{
+    std::vector<std::shared_ptr<CValidationListener> > vListeners;
+    std::lock_guard<std::mutex> lock(cs_listeners);
+    for (const auto& item : mapListeners) {
+        if (item.second->queue)
+            vListeners.push_back(item.second);
+    }
+    return vListeners;
+}
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
-    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
-    g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.ChainTip.connect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
-    g_signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.Inventory.connect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
-    g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fAsynchronous) {
+    std::shared_ptr<CValidationListener> listener = std::make_shared<CValidationListener>();
+    // Runs a notification right away, or queues it. Notifications are never
+    // dropped: validation waits in LimitValidationInterfaceQueue instead.
+    std::function<void (std::function<void ()>)> dispatch = [](std::function<void ()> f) { f(); };
+    if (fAsynchronous) {
+        listener->queue.reset(new CNotificationQueue(std::numeric_limits<size_t>::max(), NOTIFY_BLOCK));
+        listener->queue->Start();
+        CNotificationQueue* queue = listener->queue.get();
+        dispatch = [queue](std::function<void ()> f) { queue->Push(std::move(f), 0); };
+    }
+
+    std::vector<boost::signals2::connection>& c = listener->connections;
+    c.push_back(g_signals.UpdatedBlockTip.connect([=](const CBlockIndex *pindex) {
+        dispatch([=]() { pwalletIn->UpdatedBlockTip(pindex); });
+    }));
+    c.push_back(g_signals.SyncTransaction.connect([=](const std::shared_ptr<const CTransaction> &ptx, const std::shared_ptr<const CBlock> &pblock) {
+        dispatch([=]() { pwalletIn->SyncTransaction(*ptx, pblock.get()); });
+    }));
+    c.push_back(g_signals.EraseTransaction.connect([=](const uint256 &hash) {
+        dispatch([=]() { pwalletIn->EraseFromWallet(hash); });
+    }));
+    c.push_back(g_signals.UpdatedTransaction.connect([=](const uint256 &hash) {
+        dispatch([=]() { pwalletIn->UpdatedTransaction(hash); });
+    }));
+    c.push_back(g_signals.ChainTip.connect([=](const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock, const std::shared_ptr<const ZCIncrementalMerkleTree> &tree, bool added) {
+        dispatch([=]() { pwalletIn->ChainTip(pindex, pblock.get(), *tree, added); });
+    }));
+    c.push_back(g_signals.SetBestChain.connect([=](const CBlockLocator &locator) {
+        dispatch([=]() { pwalletIn->SetBestChain(locator); });
+    }));
+    // These are not fired from validation, or return results through their
+    // arguments, so they are always delivered right away.
+    c.push_back(g_signals.Inventory.connect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1)));
+    c.push_back(g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1)));
+    c.push_back(g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2)));
+
+    std::lock_guard<std::mutex> lock(cs_listeners);
+    mapListeners[pwalletIn] = listener;
+}
+
+static void DisconnectListener(const std::shared_ptr<CValidationListener>& listener) {
+    for (boost::signals2::connection& c : listener->connections)
+        c.disconnect();
+    // Deliver what was already queued before the wallet goes away.
+    if (listener->queue)
+        listener->queue->Stop();
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.Inventory.disconnect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
-    g_signals.ChainTip.disconnect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
-    g_signals.SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
-    g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    std::shared_ptr<CValidationListener> listener;
+    {
+        std::lock_guard<std::mutex> lock(cs_listeners);
+        std::map<CValidationInterface*, std::shared_ptr<CValidationListener> >::iterator it = mapListeners.find(pwalletIn);
+        if (it == mapListeners.end())
+            return;
+        listener = it->second;
+        mapListeners.erase(it);
+    }
+    DisconnectListener(listener);
 }
 
 void UnregisterAllValidationInterfaces() {
-    g_signals.BlockChecked.disconnect_all_slots();
-    g_signals.Broadcast.disconnect_all_slots();
-    g_signals.Inventory.disconnect_all_slots();
-    g_signals.ChainTip.disconnect_all_slots();
-    g_signals.SetBestChain.disconnect_all_slots();
-    g_signals.UpdatedTransaction.disconnect_all_slots();
-    g_signals.EraseTransaction.disconnect_all_slots();
-    g_signals.SyncTransaction.disconnect_all_slots();
-    g_signals.UpdatedBlockTip.disconnect_all_slots();
-}
-
-void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
-    g_signals.SyncTransaction(tx, pblock);
+    std::map<CValidationInterface*, std::shared_ptr<CValidationListener> > mapOld;
+    {
+        std::lock_guard<std::mutex> lock(cs_listeners);
+        mapOld.swap(mapListeners);
+    }
+    for (const auto& item : mapOld)
+        DisconnectListener(item.second);
+}
+
+void SyncWithWallets(const std::shared_ptr<const CTransaction> &ptx, const std::shared_ptr<const CBlock> &pblock) {
+    g_signals.SyncTransaction(ptx, pblock);
+}
+
+void SyncWithValidationInterfaceQueue() {
+    for (const auto& listener : GetAsyncListeners())
+        listener->queue->Sync();
+}
+
+void LimitValidationInterfaceQueue() {
+    for (const auto& listener : GetAsyncListeners()) {
+        if (listener->queue->Size() > MAX_VALIDATION_QUEUE_SIZE)
+            listener->queue->Sync();
+    }
 }
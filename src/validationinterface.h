@@ -8,6 +8,8 @@
 
 #include <boost/signals2/signal.hpp>
 
+#include <memory>
+
 #include "zcash/IncrementalMerkleTree.hpp"
 
 class CBlock;
@@ -18,16 +20,35 @@ class CValidationInterface;
 class CValidationState;
 class uint256;
 
+//! Number of callbacks an asynchronous listener may fall behind before block connection waits for it
+static const size_t MAX_VALIDATION_QUEUE_SIZE = 10000;
+
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/**
+ * Register a wallet to receive updates from core. An asynchronous wallet
+ * receives the notifications fired from validation in order, on a thread
+ * of its own, so that validation does not wait for it; see
+ * SyncWithValidationInterfaceQueue.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fAsynchronous = false);
+/** Unregister a wallet from core, after it has processed its queued notifications */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
 /** Push an updated transaction to all registered wallets */
-void SyncWithWallets(const CTransaction& tx, const CBlock* pblock = NULL);
+void SyncWithWallets(const std::shared_ptr<const CTransaction>& ptx, const std::shared_ptr<const CBlock>& pblock = std::shared_ptr<const CBlock>());
+/**
+ * Wait until the asynchronous wallets have processed the notifications
+ * fired so far. Must not be called with cs_main held, which they may take.
+ */
+void SyncWithValidationInterfaceQueue();
+/**
+ * Wait for the asynchronous wallets that have fallen more than
+ * MAX_VALIDATION_QUEUE_SIZE notifications behind. Must not be called with
+ * cs_main held.
+ */
+void LimitValidationInterfaceQueue();
 
 class CValidationInterface {
 protected:
@@ -40,22 +61,27 @@ protected:
     virtual void Inventory(const uint256 &hash) {}
     virtual void ResendWalletTransactions(int64_t nBestBlockTime) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, bool);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
 };
 
+/**
+ * Blocks, transactions and commitment trees are passed to listeners through
+ * shared immutable pointers, so that asynchronous listeners can hold on to
+ * them without copying.
+ */
 struct CMainSignals {
     /** Notifies listeners of updated block chain tip */
     boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
-    boost::signals2::signal<void (const CTransaction &, const CBlock *)> SyncTransaction;
+    boost::signals2::signal<void (const std::shared_ptr<const CTransaction> &, const std::shared_ptr<const CBlock> &)> SyncTransaction;
     /** Notifies listeners of an erased transaction (currently disabled, requires transaction replacement). */
     boost::signals2::signal<void (const uint256 &)> EraseTransaction;
     /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
     boost::signals2::signal<void (const uint256 &)> UpdatedTransaction;
     /** Notifies listeners of a change to the tip of the active block chain. */
-    boost::signals2::signal<void (const CBlockIndex *, const CBlock *, ZCIncrementalMerkleTree, bool)> ChainTip;
+    boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock> &, const std::shared_ptr<const ZCIncrementalMerkleTree> &, bool)> ChainTip;
     /** Notifies listeners of a new active block chain. */
     boost::signals2::signal<void (const CBlockLocator &)> SetBestChain;
     /** Notifies listeners about an inventory item being seen on the network. */
@@ -23,6 +23,7 @@
 #include "sodium.h"
 #include "miner.h"
 
+#include <atomic>
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -32,6 +33,29 @@
 
 using namespace libzcash;
 
+// How far an operation got when it saved its checkpoint
+static const unsigned char SENDMANY_CHECKPOINT_PARAMS = 0;
+static const unsigned char SENDMANY_CHECKPOINT_BUILT = 1;   // JoinSplits built, proofs pending
+static const unsigned char SENDMANY_CHECKPOINT_SIGNED = 2;  // transaction ready to send
+
+static void WriteRecipients(CDataStream& ss, const std::vector<SendManyRecipient>& recipients) {
+    WriteCompactSize(ss, recipients.size());
+    for (const SendManyRecipient& r : recipients) {
+        ss << std::get<0>(r) << std::get<1>(r) << std::get<2>(r);
+    }
+}
+
+static void ReadRecipients(CDataStream& ss, std::vector<SendManyRecipient>& recipients) {
+    uint64_t n = ReadCompactSize(ss);
+    for (uint64_t i = 0; i < n; i++) {
+        std::string address;
+        CAmount amount;
+        std::string memo;
+        ss >> address >> amount >> memo;
+        recipients.push_back(SendManyRecipient(address, amount, memo));
+    }
+}
+
 int find_output(UniValue obj, int n) {
     UniValue outputMapValue = find_value(obj, "outputmap");
     if (!outputMapValue.isArray()) {
@@ -58,26 +82,83 @@ AsyncRPCOperation_sendmany::AsyncRPCOperation_sendmany(
         UniValue contextInfo) :
         fromaddress_(fromAddress), t_outputs_(tOutputs), z_outputs_(zOutputs), mindepth_(minDepth), fee_(fee), contextinfo_(contextInfo)
 {
+    init();
+
+    // Log the context info i.e. the call parameters to z_sendmany
+    if (LogAcceptCategory("zrpcunsafe")) {
+        LogPrint("zrpcunsafe", "%s: z_sendmany initialized (params=%s)\n", getId(), contextInfo.write());
+    } else {
+        LogPrint("zrpc", "%s: z_sendmany initialized\n", getId());
+    }
+
+
+    // Enable payment disclosure if requested
+    paymentDisclosureMode = fExperimentalMode && GetBoolArg("-paymentdisclosure", false);
+}
+
+AsyncRPCOperation_sendmany::AsyncRPCOperation_sendmany(
+        AsyncRPCOperationId id,
+        int64_t creationTime,
+        CDataStream& checkpointData) :
+        AsyncRPCOperation(id, creationTime), fee_(0), mindepth_(0), isfromtaddr_(false), isfromzaddr_(false)
+{
+    std::string strContextInfo;
+    unsigned char phase;
+    checkpointData >> fromaddress_;
+    ReadRecipients(checkpointData, t_outputs_);
+    ReadRecipients(checkpointData, z_outputs_);
+    checkpointData >> mindepth_ >> fee_ >> strContextInfo >> paymentDisclosureMode >> phase;
+    if (!strContextInfo.empty()) {
+        contextinfo_.read(strContextInfo);
+    }
+
+    if (phase == SENDMANY_CHECKPOINT_BUILT) {
+        checkpointData >> tx_ >> joinSplitPubKey_ >> FLATDATA(joinSplitPrivKey_);
+        checkpointData >> jsProofWitnesses_ >> jsProofSeconds_ >> paymentDisclosureData_;
+    } else if (phase == SENDMANY_CHECKPOINT_SIGNED) {
+        checkpointData >> tx_ >> paymentDisclosureData_;
+        signed_ = true;
+    }
+
+    // A signed transaction is sent as it is, even from a locked wallet;
+    // anything else waits until the keys are available
+    if (!signed_) {
+        if (pwalletMain->IsLocked()) {
+            throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
+        }
+        init();
+    }
+    persistent = true;
+    resumed_ = true;
+
+    LogPrint("zrpc", "%s: z_sendmany resumed (checkpoint=%d)\n", getId(), (int)phase);
+
+    if (phase == SENDMANY_CHECKPOINT_BUILT) {
+        lock_inputs();
+    }
+}
+
+void AsyncRPCOperation_sendmany::init() {
     assert(fee_ >= 0);
 
-    if (minDepth < 0) {
+    if (mindepth_ < 0) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Minconf cannot be negative");
     }
     
-    if (fromAddress.size() == 0) {
+    if (fromaddress_.size() == 0) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "From address parameter missing");
     }
     
-    if (tOutputs.size() == 0 && zOutputs.size() == 0) {
+    if (t_outputs_.size() == 0 && z_outputs_.size() == 0) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "No recipients");
     }
     
-    fromtaddr_ = CBitcoinAddress(fromAddress);
+    fromtaddr_ = CBitcoinAddress(fromaddress_);
     isfromtaddr_ = fromtaddr_.IsValid();
     isfromzaddr_ = false;
 
     if (!isfromtaddr_) {
-        CZCPaymentAddress address(fromAddress);
+        CZCPaymentAddress address(fromaddress_);
         try {
             PaymentAddress addr = address.Get();
 
@@ -95,33 +176,25 @@ AsyncRPCOperation_sendmany::AsyncRPCOperation_sendmany(
         }
     }
 
-    if (isfromzaddr_ && minDepth==0) {
+    if (isfromzaddr_ && mindepth_==0) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Minconf cannot be zero when sending from zaddr");
     }
-
-    // Log the context info i.e. the call parameters to z_sendmany
-    if (LogAcceptCategory("zrpcunsafe")) {
-        LogPrint("zrpcunsafe", "%s: z_sendmany initialized (params=%s)\n", getId(), contextInfo.write());
-    } else {
-        LogPrint("zrpc", "%s: z_sendmany initialized\n", getId());
-    }
-
-
-    // Enable payment disclosure if requested
-    paymentDisclosureMode = fExperimentalMode && GetBoolArg("-paymentdisclosure", false);
 }
 
 AsyncRPCOperation_sendmany::~AsyncRPCOperation_sendmany() {
 }
 
 void AsyncRPCOperation_sendmany::main() {
-    if (isCancelled())
+    if (isCancelled()) {
+        unlock_inputs(); // clean up
         return;
+    }
 
     set_state(OperationStatus::EXECUTING);
     start_execution_clock();
 
     bool success = false;
+    yielded_ = false;
 
 #ifdef ENABLE_MINING
   #ifdef ENABLE_WALLET
@@ -162,6 +235,16 @@ void AsyncRPCOperation_sendmany::main() {
 
     stop_execution_clock();
 
+    if (yielded_) {
+        // The queue will run the operation again, from the proofs still
+        // pending, so its inputs stay locked
+        LogPrint("zrpc", "%s: z_sendmany paused\n", getId());
+        set_state(OperationStatus::READY);
+        return;
+    }
+
+    unlock_inputs(); // clean up
+
     if (success) {
         set_state(OperationStatus::SUCCESS);
     } else {
@@ -176,6 +259,10 @@ void AsyncRPCOperation_sendmany::main() {
     }
     LogPrintf("%s",s);
 
+    if (persistent && !CWalletDB(pwalletMain->strWalletFile).EraseAsyncOperation(getId())) {
+        LogPrintf("%s: error erasing z_sendmany checkpoint from wallet\n", getId());
+    }
+
     // !!! Payment disclosure START
     if (success && paymentDisclosureMode && paymentDisclosureData_.size()>0) {
         uint256 txidhash = tx_.GetHash();
@@ -195,11 +282,27 @@ void AsyncRPCOperation_sendmany::main() {
 // Notes:
 // 1. #1159 Currently there is no limit set on the number of joinsplits, so size of tx could be invalid.
 // 2. #1360 Note selection is not optimal
-// 3. #1277 Spendable notes are not locked, so an operation running in parallel could also try to use them
+// 3. #1277 Spendable notes are only locked once the transaction is built, so an operation running in parallel could also select them
 bool AsyncRPCOperation_sendmany::main_impl() {
 
+    if (signed_) {
+        // Resumed after the transaction was signed, it may even have been sent
+        send_raw_transaction(EncodeHexTx(tx_));
+        return true;
+    }
+
     assert(isfromtaddr_ != isfromzaddr_);
 
+    if (!jsProofWitnesses_.empty()) {
+        // Resumed after building the JoinSplits, only some proofs are missing
+        UniValue obj = prove_joinsplits();
+        if (yielded_) {
+            return false;
+        }
+        sign_send_raw_transaction(obj);
+        return true;
+    }
+
     bool isSingleZaddrOutput = (t_outputs_.size()==0 && z_outputs_.size()==1);
     bool isMultipleZaddrOutput = (t_outputs_.size()==0 && z_outputs_.size()>=1);
     bool isPureTaddrOnlyTx = (isfromtaddr_ && z_outputs_.size() == 0);
@@ -466,6 +569,10 @@ bool AsyncRPCOperation_sendmany::main_impl() {
             }
             obj = perform_joinsplit(info);
         }
+        obj = prove_joinsplits();
+        if (yielded_) {
+            return false;
+        }
         sign_send_raw_transaction(obj);
         return true;
     }
@@ -743,6 +850,10 @@ bool AsyncRPCOperation_sendmany::main_impl() {
     assert(zOutputsDeque.size() == 0);
     assert(vpubNewProcessed);
 
+    obj = prove_joinsplits();
+    if (yielded_) {
+        return false;
+    }
     sign_send_raw_transaction(obj);
     return true;
 }
@@ -778,12 +889,41 @@ void AsyncRPCOperation_sendmany::sign_send_raw_transaction(UniValue obj)
     }
     std::string signedtxn = hexValue.get_str();
 
-    // Send the signed transaction
+    // Keep the signed transaction so we can hash to the same txid
+    CDataStream stream(ParseHex(signedtxn), SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction tx;
+    stream >> tx;
+    tx_ = tx;
+    signed_ = true;
+
+    // Once sent, the transaction must not be built again with other notes,
+    // so it is only sent if a restart will find it
+    if (persistent && !testmode && !checkpoint()) {
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error writing the signed transaction to the wallet, so it was not sent");
+    }
+
+    send_raw_transaction(signedtxn);
+}
+
+/**
+ * Send a signed raw transaction, given as a hex string.
+ */
+void AsyncRPCOperation_sendmany::send_raw_transaction(std::string signedtxn)
+{
     if (!testmode) {
-        params.clear();
-        params.setArray();
+        UniValue params = UniValue(UniValue::VARR);
         params.push_back(signedtxn);
-        UniValue sendResultValue = sendrawtransaction(params, false);
+        UniValue sendResultValue;
+        try {
+            sendResultValue = sendrawtransaction(params, false);
+        } catch (const UniValue& objError) {
+            // A resumed operation may have sent it before the node stopped
+            if (!resumed_ || (find_value(objError, "code").get_int() != RPC_TRANSACTION_ALREADY_IN_CHAIN &&
+                              !pwalletMain->IsTxInMainChain(tx_.GetHash()))) {
+                throw;
+            }
+            sendResultValue = UniValue(tx_.GetHash().ToString());
+        }
         if (sendResultValue.isNull()) {
             throw JSONRPCError(RPC_WALLET_ERROR, "Send raw transaction did not return an error or a txid.");
         }
@@ -806,12 +946,6 @@ void AsyncRPCOperation_sendmany::sign_send_raw_transaction(UniValue obj)
         o.push_back(Pair("hex", signedtxn));
         set_result(o);
     }
-
-    // Keep the signed transaction so we can hash to the same txid
-    CDataStream stream(ParseHex(signedtxn), SER_NETWORK, PROTOCOL_VERSION);
-    CTransaction tx;
-    stream >> tx;
-    tx_ = tx;
 }
 
 
@@ -959,7 +1093,9 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
             FormatMoney(info.vjsout[0].value), FormatMoney(info.vjsout[1].value)
             );
 
-    // Generate the proof, this can take over a minute.
+    // Sample the output notes now, as later JoinSplits in the chain depend
+    // on their commitments, but leave the proof to prove_joinsplits(): it
+    // can take over a minute and doesn't affect anything else in the chain.
     boost::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs
             {info.vjsin[0], info.vjsin[1]};
     boost::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs
@@ -968,6 +1104,7 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
     boost::array<size_t, ZC_NUM_JS_OUTPUTS> outputMap;
 
     uint256 esk; // payment disclosure - secret
+    ZCJSProofWitness proofWitness;
 
     JSDescription jsdesc = JSDescription::Randomized(
             *pzcashParams,
@@ -979,39 +1116,13 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
             outputMap,
             info.vpub_old,
             info.vpub_new,
-            !this->testmode,
-            &esk); // parameter expects pointer to esk, so pass in address
-    {
-        auto verifier = libzcash::ProofVerifier::Strict();
-        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
-            throw std::runtime_error("error verifying joinsplit");
-        }
-    }
+            false,
+            &esk, // parameter expects pointer to esk, so pass in address
+            GetRandInt,
+            &proofWitness);
 
     mtx.vjoinsplit.push_back(jsdesc);
-
-    // Empty output script.
-    CScript scriptCode;
-    CTransaction signTx(mtx);
-    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
-
-    // Add the signature
-    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
-            dataToBeSigned.begin(), 32,
-            joinSplitPrivKey_
-            ) == 0))
-    {
-        throw std::runtime_error("crypto_sign_detached failed");
-    }
-
-    // Sanity check
-    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
-            dataToBeSigned.begin(), 32,
-            mtx.joinSplitPubKey.begin()
-            ) == 0))
-    {
-        throw std::runtime_error("crypto_sign_verify_detached failed");
-    }
+    jsProofWitnesses_.push_back(proofWitness);
 
     CTransaction rawTx(mtx);
     tx_ = rawTx;
@@ -1080,6 +1191,145 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
     return obj;
 }
 
+UniValue AsyncRPCOperation_sendmany::prove_joinsplits() {
+    // The queue may pause us while proving
+    lock_inputs();
+
+    CMutableTransaction mtx(tx_);
+    size_t nJoinSplits = mtx.vjoinsplit.size();
+    assert(jsProofWitnesses_.size() == nJoinSplits);
+    std::vector<size_t> vPending;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        // Proofs made before a pause or restart are already in tx_
+        if (jsProofSeconds_.size() != nJoinSplits) {
+            jsProofSeconds_.assign(nJoinSplits, -1);
+        }
+        for (size_t i = 0; i < nJoinSplits; i++) {
+            if (jsProofSeconds_[i] < 0) {
+                vPending.push_back(i);
+            }
+        }
+    }
+    if (persistent) {
+        checkpoint();
+    }
+
+    // Each thread takes the next JoinSplit without a proof until none are
+    // left, or until the queue asks the operation to yield
+    if (!testmode && !vPending.empty()) {
+        std::atomic<size_t> nNext(0);
+        std::atomic<size_t> nProved(0);
+        std::mutex proofMutex;
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        auto prover = [&]() {
+            size_t n;
+            while (!shouldYield() && (n = nNext++) < vPending.size()) {
+                size_t i = vPending[n];
+                int64_t nTimeStart = GetTimeMicros();
+                ZCProof proof;
+                try {
+                    proof = pzcashParams->prove(jsProofWitnesses_[i]);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    nNext = vPending.size();
+                    return;
+                }
+                double seconds = (GetTimeMicros() - nTimeStart) * 0.000001;
+                {
+                    std::lock_guard<std::mutex> proofGuard(proofMutex);
+                    mtx.vjoinsplit[i].proof = proof;
+                    {
+                        std::lock_guard<std::mutex> guard(lock_);
+                        jsProofSeconds_[i] = seconds;
+                    }
+                    nProved++;
+                    if (persistent) {
+                        tx_ = CTransaction(mtx);
+                        checkpoint();
+                    }
+                }
+                LogPrint("zrpcunsafe", "%s: generated proof for joinsplit %d in %.2f seconds\n", getId(), i, seconds);
+            }
+        };
+
+        size_t nThreads = std::min<size_t>(std::max<int64_t>(GetArg("-zproverthreads", DEFAULT_JOINSPLIT_PROVER_THREADS), 1), vPending.size());
+        std::vector<std::thread> threads;
+        try {
+            for (size_t i = 1; i < nThreads; i++) {
+                threads.emplace_back(prover);
+            }
+            prover();
+        } catch (...) {
+            // Stop handing out JoinSplits, and join the threads that did
+            // start before they and the state they share go away.
+            nNext = vPending.size();
+            for (std::thread& t : threads) {
+                t.join();
+            }
+            throw;
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (nProved < vPending.size()) {
+            // Keep the proofs made so far for when the queue resumes us
+            tx_ = CTransaction(mtx);
+            yielded_ = true;
+            LogPrint("zrpc", "%s: yielding with %d of %d joinsplit proofs pending\n",
+                getId(), vPending.size() - nProved, nJoinSplits);
+            return NullUniValue;
+        }
+    }
+
+    for (const JSDescription& jsdesc : mtx.vjoinsplit) {
+        auto verifier = libzcash::ProofVerifier::Strict();
+        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
+            throw std::runtime_error("error verifying joinsplit");
+        }
+    }
+
+    // Empty output script.
+    CScript scriptCode;
+    CTransaction signTx(mtx);
+    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
+
+    // Add the signature
+    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
+            dataToBeSigned.begin(), 32,
+            joinSplitPrivKey_
+            ) == 0))
+    {
+        throw std::runtime_error("crypto_sign_detached failed");
+    }
+
+    // Sanity check
+    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
+            dataToBeSigned.begin(), 32,
+            mtx.joinSplitPubKey.begin()
+            ) == 0))
+    {
+        throw std::runtime_error("crypto_sign_verify_detached failed");
+    }
+
+    CTransaction rawTx(mtx);
+    tx_ = rawTx;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << rawTx;
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("rawtxn", HexStr(ss.begin(), ss.end())));
+    return obj;
+}
+
 void AsyncRPCOperation_sendmany::add_taddr_outputs_to_tx() {
 
     CMutableTransaction rawTx(tx_);
@@ -1144,18 +1394,105 @@ boost::array<unsigned char, ZC_MEMO_SIZE> AsyncRPCOperation_sendmany::get_memo_f
     return memo;
 }
 
+/**
+ * Lock the utxos and notes spent by tx_
+ */
+void AsyncRPCOperation_sendmany::lock_inputs() {
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    if (!lockedUtxos_.empty() || !lockedNotes_.empty()) {
+        return;
+    }
+    for (const CTxIn& txin : tx_.vin) {
+        COutPoint outpt = txin.prevout;
+        pwalletMain->LockCoin(outpt);
+        lockedUtxos_.push_back(outpt);
+    }
+    // Notes created earlier in the chain of JoinSplits are not in the wallet
+    for (const JSDescription& jsdesc : tx_.vjoinsplit) {
+        for (const uint256& nullifier : jsdesc.nullifiers) {
+            auto it = pwalletMain->mapNullifiersToNotes.find(nullifier);
+            if (it != pwalletMain->mapNullifiersToNotes.end()) {
+                pwalletMain->LockNote(it->second);
+                lockedNotes_.push_back(it->second);
+            }
+        }
+    }
+}
+
+/**
+ * Unlock the inputs locked by lock_inputs()
+ */
+void AsyncRPCOperation_sendmany::unlock_inputs() {
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    for (COutPoint& outpt : lockedUtxos_) {
+        pwalletMain->UnlockCoin(outpt);
+    }
+    for (const JSOutPoint& jsop : lockedNotes_) {
+        pwalletMain->UnlockNote(jsop);
+    }
+    lockedUtxos_.clear();
+    lockedNotes_.clear();
+}
+
+bool AsyncRPCOperation_sendmany::checkpoint() {
+    unsigned char phase = SENDMANY_CHECKPOINT_PARAMS;
+    if (signed_) {
+        phase = SENDMANY_CHECKPOINT_SIGNED;
+    } else if (!jsProofWitnesses_.empty() && !pwalletMain->IsCrypted()) {
+        phase = SENDMANY_CHECKPOINT_BUILT;
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << fromaddress_;
+    WriteRecipients(ss, t_outputs_);
+    WriteRecipients(ss, z_outputs_);
+    ss << mindepth_ << fee_ << (contextinfo_.isNull() ? std::string() : contextinfo_.write());
+    ss << paymentDisclosureMode << phase;
+    if (phase == SENDMANY_CHECKPOINT_BUILT) {
+        ss << tx_ << joinSplitPubKey_ << FLATDATA(joinSplitPrivKey_) << jsProofWitnesses_;
+        std::lock_guard<std::mutex> guard(lock_);
+        ss << jsProofSeconds_ << paymentDisclosureData_;
+    } else if (phase == SENDMANY_CHECKPOINT_SIGNED) {
+        ss << tx_ << paymentDisclosureData_;
+    }
+
+    CAsyncOperationRecord record;
+    record.strMethod = "z_sendmany";
+    record.nCreationTime = getCreationTime();
+    record.nPriority = (int)getPriority();
+    record.vchData.assign(ss.begin(), ss.end());
+    if (!CWalletDB(pwalletMain->strWalletFile).WriteAsyncOperation(getId(), record)) {
+        LogPrintf("%s: error writing z_sendmany checkpoint to wallet\n", getId());
+        return false;
+    }
+    return true;
+}
+
 /**
  * Override getStatus() to append the operation's input parameters to the default status object.
  */
 UniValue AsyncRPCOperation_sendmany::getStatus() const {
     UniValue v = AsyncRPCOperation::getStatus();
-    if (contextinfo_.isNull()) {
+    UniValue proofTimes(UniValue::VARR);
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (double seconds : jsProofSeconds_) {
+            // Proofs still being generated are reported as null
+            proofTimes.push_back(seconds < 0 ? NullUniValue : UniValue(seconds));
+        }
+    }
+    if (contextinfo_.isNull() && proofTimes.empty()) {
         return v;
     }
 
     UniValue obj = v.get_obj();
-    obj.push_back(Pair("method", "z_sendmany"));
-    obj.push_back(Pair("params", contextinfo_ ));
+    if (!contextinfo_.isNull()) {
+        obj.push_back(Pair("method", "z_sendmany"));
+        obj.push_back(Pair("params", contextinfo_ ));
+    }
+    if (!proofTimes.empty()) {
+        obj.push_back(Pair("joinsplit_proof_secs", proofTimes));
+    }
     return obj;
 }
 
@@ -52,6 +52,8 @@ struct WitnessAnchorData {
 class AsyncRPCOperation_sendmany : public AsyncRPCOperation {
 public:
     AsyncRPCOperation_sendmany(std::string fromAddress, std::vector<SendManyRecipient> tOutputs, std::vector<SendManyRecipient> zOutputs, int minDepth, CAmount fee = ASYNC_RPC_OPERATION_DEFAULT_MINERS_FEE, UniValue contextInfo = NullUniValue);
+    // Resume an operation from the checkpoint it saved before a restart
+    AsyncRPCOperation_sendmany(AsyncRPCOperationId id, int64_t creationTime, CDataStream& checkpointData);
     virtual ~AsyncRPCOperation_sendmany();
     
     // We don't want to be copied or moved around
@@ -68,9 +70,21 @@ public:
 
     bool paymentDisclosureMode = false; // Set to true to save esk for encrypted notes in payment disclosure database.
 
+    bool persistent = false;  // Set to true to checkpoint to the wallet, so the operation is resumed after a restart
+
+    // Save the parameters and progress of the operation to the wallet. The
+    // built JoinSplits hold spending keys, so they are only saved if the
+    // wallet is not encrypted; the signed transaction is always saved.
+    // Returns false if the wallet could not be written.
+    bool checkpoint();
+
 private:
     friend class TEST_FRIEND_AsyncRPCOperation_sendmany;    // class for unit testing
 
+    bool resumed_ = false;  // constructed from a checkpoint
+    bool yielded_ = false;  // main_impl() paused to let the queue run something else
+    bool signed_ = false;   // tx_ is signed and only has to be sent
+
     UniValue contextinfo_;     // optional data to include in return value from getStatus()
 
     CAmount fee_;
@@ -92,6 +106,10 @@ private:
     std::vector<SendManyRecipient> z_outputs_;
     std::vector<SendManyInputUTXO> t_inputs_;
     std::vector<SendManyInputJSOP> z_inputs_;
+
+    // Inputs locked by lock_inputs()
+    std::vector<COutPoint> lockedUtxos_;
+    std::vector<JSOutPoint> lockedNotes_;
     
     CTransaction tx_;
    
@@ -100,6 +118,7 @@ private:
     bool find_unspent_notes();
     bool find_utxos(bool fAcceptCoinbase);
     boost::array<unsigned char, ZC_MEMO_SIZE> get_memo_from_hex_string(std::string s);
+    void init();    // check the parameters and look up the spending key
     bool main_impl();
 
     // JoinSplit without any input notes to spend
@@ -114,8 +133,27 @@ private:
         std::vector<boost::optional < ZCIncrementalWitness>> witnesses,
         uint256 anchor);
 
+    // Generate the proofs of all JoinSplits in tx_ on -zproverthreads threads,
+    // then sign them. Returns the raw transaction like perform_joinsplit, or
+    // null if the operation yielded with proofs still pending.
+    UniValue prove_joinsplits();
+
     void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
 
+    // Lock the utxos and notes spent by tx_ in the wallet, so that operations
+    // run while this one is paused do not spend them too
+    void lock_inputs();
+    void unlock_inputs();
+
+    void send_raw_transaction(std::string signedtxn);  // throws exception if there was an error
+
+    // Proof inputs of each JoinSplit in tx_, whose proofs are deferred until
+    // the whole chain of JoinSplits has been built
+    std::vector<ZCJSProofWitness> jsProofWitnesses_;
+
+    // Seconds taken by each JoinSplit proof (negative while pending), for getStatus()
+    std::vector<double> jsProofSeconds_;
+
     // payment disclosure!
     std::vector<PaymentDisclosureKeyInfo> paymentDisclosureData_;
 };
@@ -178,6 +216,10 @@ public:
         return delegate->perform_joinsplit(info, witnesses, anchor);
     }
 
+    UniValue prove_joinsplits() {
+        return delegate->prove_joinsplits();
+    }
+
     void sign_send_raw_transaction(UniValue obj) {
         delegate->sign_send_raw_transaction(obj);
     }
@@ -185,6 +227,22 @@ public:
     void set_state(OperationStatus state) {
         delegate->state_.store(state);
     }
+
+    bool isResumed() {
+        return delegate->resumed_;
+    }
+
+    bool isSigned() {
+        return delegate->signed_;
+    }
+
+    void setSigned(bool fSigned) {
+        delegate->signed_ = fSigned;
+    }
+
+    size_t getPendingProofs() {
+        return delegate->jsProofWitnesses_.size();
+    }
 };
 
 
@@ -34,6 +34,10 @@
 
 using namespace libzcash;
 
+// How far an operation got when it saved its checkpoint
+static const unsigned char SHIELDCOINBASE_CHECKPOINT_PARAMS = 0;
+static const unsigned char SHIELDCOINBASE_CHECKPOINT_SIGNED = 2;  // transaction ready to send
+
 static int find_output(UniValue obj, int n) {
     UniValue outputMapValue = find_value(obj, "outputmap");
     if (!outputMapValue.isArray()) {
@@ -88,6 +92,40 @@ AsyncRPCOperation_shieldcoinbase::AsyncRPCOperation_shieldcoinbase(
     paymentDisclosureMode = fExperimentalMode && GetBoolArg("-paymentdisclosure", false);
 }
 
+AsyncRPCOperation_shieldcoinbase::AsyncRPCOperation_shieldcoinbase(
+        AsyncRPCOperationId id,
+        int64_t creationTime,
+        CDataStream& checkpointData) :
+        AsyncRPCOperation(id, creationTime), fee_(0)
+{
+    std::string strContextInfo;
+    unsigned char phase;
+    uint64_t nInputs = ReadCompactSize(checkpointData);
+    for (uint64_t i = 0; i < nInputs; i++) {
+        ShieldCoinbaseUTXO utxo;
+        checkpointData >> utxo.txid >> utxo.vout >> utxo.amount;
+        inputs_.push_back(utxo);
+    }
+    checkpointData >> tozaddr_ >> fee_ >> strContextInfo >> paymentDisclosureMode >> phase;
+    if (!strContextInfo.empty()) {
+        contextinfo_.read(strContextInfo);
+    }
+    if (phase == SHIELDCOINBASE_CHECKPOINT_SIGNED) {
+        checkpointData >> tx_ >> paymentDisclosureData_;
+        signed_ = true;
+    }
+    // Signing the coinbase inputs needs the keys, so wait for an unlock
+    if (!signed_ && pwalletMain->IsLocked()) {
+        throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
+    }
+    persistent = true;
+    resumed_ = true;
+
+    LogPrint("zrpc", "%s: z_shieldcoinbase resumed (checkpoint=%d)\n", getId(), (int)phase);
+
+    lock_utxos();
+}
+
 AsyncRPCOperation_shieldcoinbase::~AsyncRPCOperation_shieldcoinbase() {
 }
 
@@ -157,6 +195,10 @@ void AsyncRPCOperation_shieldcoinbase::main() {
 
     unlock_utxos(); // clean up
 
+    if (persistent && !CWalletDB(pwalletMain->strWalletFile).EraseAsyncOperation(getId())) {
+        LogPrintf("%s: error erasing z_shieldcoinbase checkpoint from wallet\n", getId());
+    }
+
     // !!! Payment disclosure START
     if (success && paymentDisclosureMode && paymentDisclosureData_.size()>0) {
         uint256 txidhash = tx_.GetHash();
@@ -176,6 +218,12 @@ void AsyncRPCOperation_shieldcoinbase::main() {
 
 bool AsyncRPCOperation_shieldcoinbase::main_impl() {
 
+    if (signed_) {
+        // Resumed after the transaction was signed, it may even have been sent
+        send_raw_transaction(EncodeHexTx(tx_));
+        return true;
+    }
+
     CAmount minersFee = fee_;
 
     size_t numInputs = inputs_.size();
@@ -262,12 +310,41 @@ void AsyncRPCOperation_shieldcoinbase::sign_send_raw_transaction(UniValue obj)
     }
     std::string signedtxn = hexValue.get_str();
 
-    // Send the signed transaction
+    // Keep the signed transaction so we can hash to the same txid
+    CDataStream stream(ParseHex(signedtxn), SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction tx;
+    stream >> tx;
+    tx_ = tx;
+    signed_ = true;
+
+    // Once sent, the transaction must not be built again, so it is only
+    // sent if a restart will find it
+    if (persistent && !testmode && !checkpoint()) {
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error writing the signed transaction to the wallet, so it was not sent");
+    }
+
+    send_raw_transaction(signedtxn);
+}
+
+/**
+ * Send a signed raw transaction, given as a hex string.
+ */
+void AsyncRPCOperation_shieldcoinbase::send_raw_transaction(std::string signedtxn)
+{
     if (!testmode) {
-        params.clear();
-        params.setArray();
+        UniValue params = UniValue(UniValue::VARR);
         params.push_back(signedtxn);
-        UniValue sendResultValue = sendrawtransaction(params, false);
+        UniValue sendResultValue;
+        try {
+            sendResultValue = sendrawtransaction(params, false);
+        } catch (const UniValue& objError) {
+            // A resumed operation may have sent it before the node stopped
+            if (!resumed_ || (find_value(objError, "code").get_int() != RPC_TRANSACTION_ALREADY_IN_CHAIN &&
+                              !pwalletMain->IsTxInMainChain(tx_.GetHash()))) {
+                throw;
+            }
+            sendResultValue = UniValue(tx_.GetHash().ToString());
+        }
         if (sendResultValue.isNull()) {
             throw JSONRPCError(RPC_WALLET_ERROR, "Send raw transaction did not return an error or a txid.");
         }
@@ -290,12 +367,6 @@ void AsyncRPCOperation_shieldcoinbase::sign_send_raw_transaction(UniValue obj)
         o.push_back(Pair("hex", signedtxn));
         set_result(o);
     }
-
-    // Keep the signed transaction so we can hash to the same txid
-    CDataStream stream(ParseHex(signedtxn), SER_NETWORK, PROTOCOL_VERSION);
-    CTransaction tx;
-    stream >> tx;
-    tx_ = tx;
 }
 
 
@@ -453,6 +524,32 @@ UniValue AsyncRPCOperation_shieldcoinbase::perform_joinsplit(ShieldCoinbaseJSInf
     return obj;
 }
 
+bool AsyncRPCOperation_shieldcoinbase::checkpoint() {
+    unsigned char phase = signed_ ? SHIELDCOINBASE_CHECKPOINT_SIGNED : SHIELDCOINBASE_CHECKPOINT_PARAMS;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    WriteCompactSize(ss, inputs_.size());
+    for (const ShieldCoinbaseUTXO& utxo : inputs_) {
+        ss << utxo.txid << utxo.vout << utxo.amount;
+    }
+    ss << tozaddr_ << fee_ << (contextinfo_.isNull() ? std::string() : contextinfo_.write());
+    ss << paymentDisclosureMode << phase;
+    if (phase == SHIELDCOINBASE_CHECKPOINT_SIGNED) {
+        ss << tx_ << paymentDisclosureData_;
+    }
+
+    CAsyncOperationRecord record;
+    record.strMethod = "z_shieldcoinbase";
+    record.nCreationTime = getCreationTime();
+    record.nPriority = (int)getPriority();
+    record.vchData.assign(ss.begin(), ss.end());
+    if (!CWalletDB(pwalletMain->strWalletFile).WriteAsyncOperation(getId(), record)) {
+        LogPrintf("%s: error writing z_shieldcoinbase checkpoint to wallet\n", getId());
+        return false;
+    }
+    return true;
+}
+
 /**
  * Override getStatus() to append the operation's context object to the default status object.
  */
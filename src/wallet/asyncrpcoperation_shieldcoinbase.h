@@ -43,6 +43,8 @@ struct ShieldCoinbaseJSInfo
 class AsyncRPCOperation_shieldcoinbase : public AsyncRPCOperation {
 public:
     AsyncRPCOperation_shieldcoinbase(std::vector<ShieldCoinbaseUTXO> inputs, std::string toAddress, CAmount fee = SHIELD_COINBASE_DEFAULT_MINERS_FEE, UniValue contextInfo = NullUniValue);
+    // Resume an operation from the checkpoint it saved before a restart
+    AsyncRPCOperation_shieldcoinbase(AsyncRPCOperationId id, int64_t creationTime, CDataStream& checkpointData);
     virtual ~AsyncRPCOperation_shieldcoinbase();
 
     // We don't want to be copied or moved around
@@ -59,9 +61,19 @@ public:
 
     bool paymentDisclosureMode = false; // Set to true to save esk for encrypted notes in payment disclosure database.
 
+    bool persistent = false;  // Set to true to checkpoint to the wallet, so the operation is resumed after a restart
+
+    // Save the parameters of the operation to the wallet, and the
+    // transaction once it is signed.
+    // Returns false if the wallet could not be written.
+    bool checkpoint();
+
 private:
     friend class TEST_FRIEND_AsyncRPCOperation_shieldcoinbase;    // class for unit testing
 
+    bool resumed_ = false;  // constructed from a checkpoint
+    bool signed_ = false;   // tx_ is signed and only has to be sent
+
     UniValue contextinfo_;     // optional data to include in return value from getStatus()
 
     CAmount fee_;
@@ -81,6 +93,8 @@ private:
 
     void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
 
+    void send_raw_transaction(std::string signedtxn);  // throws exception if there was an error
+
     void lock_utxos();
 
     void unlock_utxos();
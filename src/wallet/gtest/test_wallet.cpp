@@ -293,6 +293,70 @@ TEST(wallet_tests, find_unspent_notes) {
     mapBlockIndex.erase(blockHash3);
 }
 
+TEST(wallet_tests, filtered_notes_by_address) {
+    SelectParams(CBaseChainParams::TESTNET);
+    CWallet wallet;
+    auto sk = libzcash::SpendingKey::random();
+    auto sk2 = libzcash::SpendingKey::random();
+    wallet.AddSpendingKey(sk);
+    wallet.AddSpendingKey(sk2);
+
+    auto wtx = GetValidReceive(sk, 10, true);
+    auto note = GetNote(sk, wtx, 0, 1);
+    auto nullifier = note.nullifier(sk);
+
+    mapNoteData_t noteData;
+    JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+    CNoteData nd {sk.address(), nullifier};
+    noteData[jsoutpt] = nd;
+
+    wtx.SetNoteData(noteData);
+    wallet.AddToWallet(wtx, true, NULL);
+    EXPECT_FALSE(wallet.mapWallet[wtx.GetHash()].mapNoteData[jsoutpt].plaintext);
+
+    std::vector<CNotePlaintextEntry> entries;
+    wallet.GetFilteredNotes(entries, CZCPaymentAddress(sk.address()).ToString(), -1);
+    ASSERT_EQ(1, entries.size());
+    EXPECT_EQ(jsoutpt, entries[0].jsop);
+    EXPECT_EQ(note.value, entries[0].plaintext.value);
+    entries.clear();
+
+    // The decrypted note is now cached
+    EXPECT_TRUE(wallet.mapWallet[wtx.GetHash()].mapNoteData[jsoutpt].plaintext);
+
+    // Notes for other addresses are not returned
+    wallet.GetFilteredNotes(entries, CZCPaymentAddress(sk2.address()).ToString(), -1);
+    EXPECT_EQ(0, entries.size());
+
+    // Notes locked by an operation in progress are only returned if asked for
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.LockNote(jsoutpt);
+        EXPECT_TRUE(wallet.IsLockedNote(jsoutpt));
+    }
+    wallet.GetFilteredNotes(entries, "", -1);
+    EXPECT_EQ(0, entries.size());
+    wallet.GetFilteredNotes(entries, "", -1, true, true, false);
+    EXPECT_EQ(1, entries.size());
+    entries.clear();
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.UnlockNote(jsoutpt);
+        EXPECT_FALSE(wallet.IsLockedNote(jsoutpt));
+    }
+    wallet.GetFilteredNotes(entries, "", -1);
+    EXPECT_EQ(1, entries.size());
+    entries.clear();
+
+    // Removing the transaction removes its notes from the index
+    EXPECT_EQ(1, wallet.mapNotesByAddress.count(sk.address()));
+    wallet.EraseFromWallet(wtx.GetHash());
+    EXPECT_EQ(0, wallet.mapWallet.count(wtx.GetHash()));
+    EXPECT_EQ(0, wallet.mapNotesByAddress.count(sk.address()));
+    wallet.GetFilteredNotes(entries, "", -1);
+    EXPECT_EQ(0, entries.size());
+}
+
 
 TEST(wallet_tests, set_note_addrs_in_cwallettx) {
     auto sk = libzcash::SpendingKey::random();
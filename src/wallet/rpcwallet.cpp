@@ -34,6 +34,7 @@
 
 #include <univalue.h>
 
+#include <mutex>
 #include <numeric>
 
 using namespace std;
@@ -1921,6 +1922,9 @@ UniValue walletpassphrase(const UniValue& params, bool fHelp)
     pwalletMain->UpdateNullifierNoteMap();
     pwalletMain->TopUpKeyPool();
 
+    // Queue the operations that were left waiting for the keys at startup
+    ResumeAsyncRPCOperations();
+
     int64_t nSleepTime = params[1].get_int64();
     LOCK(cs_nWalletUnlockTime);
     nWalletUnlockTime = GetTime() + nSleepTime;
@@ -3036,7 +3040,7 @@ CAmount getBalanceZaddr(std::string address, int minDepth = 1, bool ignoreUnspen
     CAmount balance = 0;
     std::vector<CNotePlaintextEntry> entries;
     LOCK2(cs_main, pwalletMain->cs_wallet);
-    pwalletMain->GetFilteredNotes(entries, address, minDepth, true, ignoreUnspendable);
+    pwalletMain->GetFilteredNotes(entries, address, minDepth, true, ignoreUnspendable, false);
     for (auto & entry : entries) {
         balance += CAmount(entry.plaintext.value);
     }
@@ -3095,7 +3099,7 @@ UniValue z_listreceivedbyaddress(const UniValue& params, bool fHelp)
 
     UniValue result(UniValue::VARR);
     std::vector<CNotePlaintextEntry> entries;
-    pwalletMain->GetFilteredNotes(entries, fromaddress, nMinDepth, false, false);
+    pwalletMain->GetFilteredNotes(entries, fromaddress, nMinDepth, false, false, false);
     for (CNotePlaintextEntry & entry : entries) {
         UniValue obj(UniValue::VOBJ);
         obj.push_back(Pair("txid",entry.jsop.hash.ToString()));
@@ -3340,6 +3344,9 @@ UniValue z_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedO
 // We reduce the result by 1 to ensure there is room for non-joinsplit CTransaction data.
 #define Z_SENDMANY_MAX_ZADDR_OUTPUTS    ((MAX_TX_SIZE / JSDescription().GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION)) - 1)
 
+// z_sendmany calls estimated to need more JoinSplits than this are queued at low priority
+#define Z_SENDMANY_LOW_PRIORITY_JOINSPLITS  4
+
 // transaction.h comment: spending taddr output requires CTxIn >= 148 bytes and typical taddr txout is 34 bytes
 #define CTXIN_SPEND_DUST_SIZE   148
 #define CTXOUT_REGULAR_SIZE     34
@@ -3525,14 +3532,111 @@ UniValue z_sendmany(const UniValue& params, bool fHelp)
     o.push_back(Pair("fee", std::stod(FormatMoney(nFee))));
     UniValue contextInfo = o;
 
+    // Estimate how many JoinSplits, and so proofs, the operation will take:
+    // one per zaddr recipient, and one per pair of notes it spends.
+    size_t nJoinSplits = zaddrRecipients.size();
+    if (!fromTaddr) {
+        std::vector<CNotePlaintextEntry> entries;
+        pwalletMain->GetFilteredNotes(entries, fromaddress, nMinDepth);
+        std::sort(entries.begin(), entries.end(), [](const CNotePlaintextEntry& a, const CNotePlaintextEntry& b) {
+            return a.plaintext.value > b.plaintext.value;
+        });
+        size_t nNotes = 0;
+        CAmount nSelected = 0;
+        for (const CNotePlaintextEntry& entry : entries) {
+            if (nSelected >= nTotalOut + nFee) {
+                break;
+            }
+            nSelected += entry.plaintext.value;
+            nNotes++;
+        }
+        nJoinSplits = std::max(nJoinSplits, (nNotes + ZC_NUM_JS_INPUTS - 1) / ZC_NUM_JS_INPUTS);
+    }
+
     // Create operation and add to global queue
     std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
-    std::shared_ptr<AsyncRPCOperation> operation( new AsyncRPCOperation_sendmany(fromaddress, taddrRecipients, zaddrRecipients, nMinDepth, nFee, contextInfo) );
+    std::shared_ptr<AsyncRPCOperation_sendmany> sendOperation( new AsyncRPCOperation_sendmany(fromaddress, taddrRecipients, zaddrRecipients, nMinDepth, nFee, contextInfo) );
+    if (nJoinSplits > Z_SENDMANY_LOW_PRIORITY_JOINSPLITS) {
+        // Let quicker operations go first, they are run between its proofs
+        sendOperation->setPriority(OperationPriority::LOW);
+    }
+    sendOperation->persistent = true;
+    sendOperation->checkpoint();
+    std::shared_ptr<AsyncRPCOperation> operation(sendOperation);
     q->addOperation(operation);
     AsyncRPCOperationId operationId = operation->getId();
     return operationId;
 }
 
+void ResumeAsyncRPCOperations()
+{
+    // Called at startup and again on each unlock, possibly from several RPC
+    // threads, so that no record is resumed twice
+    static std::mutex cs_resume;
+    std::lock_guard<std::mutex> resumeLock(cs_resume);
+
+    std::map<std::string, CAsyncOperationRecord> mapRecords;
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    walletdb.ListAsyncOperations(mapRecords);
+
+    // Resume the oldest operations first
+    std::vector<std::pair<int64_t, std::string> > vOrder;
+    for (const auto& item : mapRecords) {
+        vOrder.push_back(std::make_pair(item.second.nCreationTime, item.first));
+    }
+    std::sort(vOrder.begin(), vOrder.end());
+
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    size_t nResumed = 0;
+    size_t nWaiting = 0;
+    for (const auto& item : vOrder) {
+        const std::string& strId = item.second;
+        const CAsyncOperationRecord& record = mapRecords[strId];
+        if (q->getOperationForId(strId)) {
+            // Already resumed, or still running since it was started
+            continue;
+        }
+        std::shared_ptr<AsyncRPCOperation> operation;
+        try {
+            if (record.nVersion > CAsyncOperationRecord::CURRENT_VERSION) {
+                throw std::runtime_error(strprintf("unsupported version %d", record.nVersion));
+            }
+            CDataStream ss(record.vchData, SER_DISK, CLIENT_VERSION);
+            if (record.strMethod == "z_sendmany") {
+                operation.reset(new AsyncRPCOperation_sendmany(strId, record.nCreationTime, ss));
+            } else if (record.strMethod == "z_shieldcoinbase") {
+                operation.reset(new AsyncRPCOperation_shieldcoinbase(strId, record.nCreationTime, ss));
+            } else {
+                throw std::runtime_error("unknown method " + record.strMethod);
+            }
+        } catch (const UniValue& objError) {
+            if (find_value(objError, "code").get_int() == RPC_WALLET_UNLOCK_NEEDED) {
+                // Keep the record; walletpassphrase resumes it
+                nWaiting++;
+                continue;
+            }
+            LogPrintf("Unable to resume %s: %s\n", strId, find_value(objError, "message").get_str());
+        } catch (const std::exception& e) {
+            LogPrintf("Unable to resume %s: %s\n", strId, e.what());
+        }
+        if (!operation) {
+            walletdb.EraseAsyncOperation(strId);
+            continue;
+        }
+        if (record.nPriority >= (int)OperationPriority::HIGH && record.nPriority <= (int)OperationPriority::LOW) {
+            operation->setPriority((OperationPriority)record.nPriority);
+        }
+        q->addOperation(operation);
+        nResumed++;
+    }
+    if (nResumed) {
+        LogPrintf("Resumed %u unfinished async operations\n", (unsigned int)nResumed);
+    }
+    if (nWaiting) {
+        LogPrintf("%u unfinished async operations will resume once the wallet is unlocked\n", (unsigned int)nWaiting);
+    }
+}
+
 
 /**
 When estimating the number of coinbase utxos we can shield in a single transaction:
@@ -3711,7 +3815,10 @@ UniValue z_shieldcoinbase(const UniValue& params, bool fHelp)
 
     // Create operation and add to global queue
     std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
-    std::shared_ptr<AsyncRPCOperation> operation( new AsyncRPCOperation_shieldcoinbase(inputs, destaddress, nFee, contextInfo) );
+    std::shared_ptr<AsyncRPCOperation_shieldcoinbase> shieldOperation( new AsyncRPCOperation_shieldcoinbase(inputs, destaddress, nFee, contextInfo) );
+    shieldOperation->persistent = true;
+    shieldOperation->checkpoint();
+    std::shared_ptr<AsyncRPCOperation> operation(shieldOperation);
     q->addOperation(operation);
     AsyncRPCOperationId operationId = operation->getId();
 
@@ -4,6 +4,8 @@
 
 #include "wallet/wallet.h"
 
+#include "main.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -307,4 +309,56 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(available_coins_after_spend_and_disconnect)
+{
+    CWallet wallet;
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK(wallet.AddKey(key));
+
+    LOCK2(cs_main, wallet.cs_wallet);
+
+    // A payment to us, confirmed in the genesis block
+    CMutableTransaction mtx;
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = COIN;
+    mtx.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    CWalletTx wtx(&wallet, mtx);
+    wtx.hashBlock = chainActive.Tip()->GetBlockHash();
+    wtx.nIndex = 0;
+    wtx.fMerkleVerified = true;
+    wallet.AddToWallet(wtx, true, NULL);
+
+    vector<COutput> vAvailable;
+    wallet.AvailableCoins(vAvailable);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 1U);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), COIN);
+
+    // Spend it, also in the main chain
+    CMutableTransaction mtxSpend;
+    mtxSpend.vin.resize(1);
+    mtxSpend.vin[0].prevout = COutPoint(wtx.GetHash(), 0);
+    mtxSpend.vout.resize(1);
+    mtxSpend.vout[0].nValue = COIN;
+    CWalletTx wtxSpend(&wallet, mtxSpend);
+    wtxSpend.hashBlock = wtx.hashBlock;
+    wtxSpend.nIndex = 0;
+    wtxSpend.fMerkleVerified = true;
+    wallet.AddToWallet(wtxSpend, true, NULL);
+
+    wallet.AvailableCoins(vAvailable);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 0U);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), 0);
+
+    // The spend is disconnected and not in the mempool, so the coin is
+    // available again
+    wtxSpend.hashBlock.SetNull();
+    wtxSpend.nIndex = -1;
+    wallet.AddToWallet(wtxSpend, true, NULL);
+
+    wallet.AvailableCoins(vAvailable);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 1U);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), COIN);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -77,6 +77,13 @@ const CWalletTx* CWallet::GetWalletTx(const uint256& hash) const
     return &(it->second);
 }
 
+bool CWallet::IsTxInMainChain(const uint256& hash) const
+{
+    LOCK2(cs_main, cs_wallet);
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+    return it != mapWallet.end() && it->second.GetDepthInMainChain() > 0;
+}
+
 // Generate a new spending key and return its public payment address
 CZCPaymentAddress CWallet::GenerateNewZKey()
 {
@@ -978,6 +985,81 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
+        fWalletTxsWithCoinsValid = false;
+    }
+}
+
+/**
+ * Outpoint is spent by a transaction in the main chain. Unlike IsSpent(),
+ * this can only change back when that block is disconnected.
+ */
+bool CWallet::IsSpentInMainChain(const uint256& hash, unsigned int n) const
+{
+    const COutPoint outpoint(hash, n);
+    pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it)
+    {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain() >= 1)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Return the transactions that may have unspent outputs of ours, dropping
+ * those that no longer can from setWalletTxsWithCoins.
+ */
+std::vector<const CWalletTx*> CWallet::GetWalletTxsWithCoins() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (!fWalletTxsWithCoinsValid) {
+        setWalletTxsWithCoins.clear();
+        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            setWalletTxsWithCoins.insert(setWalletTxsWithCoins.end(), it->first);
+        fWalletTxsWithCoinsValid = true;
+    }
+
+    std::vector<const CWalletTx*> vResult;
+    vResult.reserve(setWalletTxsWithCoins.size());
+    for (std::set<uint256>::iterator it = setWalletTxsWithCoins.begin(); it != setWalletTxsWithCoins.end();)
+    {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(*it);
+        bool fHasCoins = false;
+        if (mit != mapWallet.end()) {
+            const CWalletTx& wtx = mit->second;
+            for (unsigned int i = 0; i < wtx.vout.size() && !fHasCoins; i++) {
+                fHasCoins = IsMine(wtx.vout[i]) != ISMINE_NO && !IsSpentInMainChain(*it, i);
+            }
+        }
+        if (fHasCoins) {
+            vResult.push_back(&mit->second);
+            ++it;
+        } else {
+            setWalletTxsWithCoins.erase(it++);
+        }
+    }
+    return vResult;
+}
+
+/**
+ * A transaction was added or changed: it and the wallet transactions it
+ * spends from may have coins again.
+ */
+void CWallet::UpdateWalletTxsWithCoins(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    if (!fWalletTxsWithCoinsValid)
+        return;
+
+    setWalletTxsWithCoins.insert(wtx.GetHash());
+    BOOST_FOREACH(const CTxIn& txin, wtx.vin) {
+        if (mapWallet.count(txin.prevout.hash))
+            setWalletTxsWithCoins.insert(txin.prevout.hash);
     }
 }
 
@@ -1031,6 +1113,17 @@ void CWallet::UpdateNullifierNoteMapWithTx(const CWalletTx& wtx)
     }
 }
 
+/**
+ * Add the notes in this tx to mapNotesByAddress.
+ */
+void CWallet::UpdateNoteIndexWithTx(const CWalletTx& wtx)
+{
+    LOCK(cs_wallet);
+    for (const mapNoteData_t::value_type& item : wtx.mapNoteData) {
+        mapNotesByAddress[item.second.address].insert(item.first);
+    }
+}
+
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb)
 {
     uint256 hash = wtxIn.GetHash();
@@ -1040,6 +1133,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         mapWallet[hash] = wtxIn;
         mapWallet[hash].BindWallet(this);
         UpdateNullifierNoteMapWithTx(mapWallet[hash]);
+        UpdateNoteIndexWithTx(mapWallet[hash]);
+        UpdateWalletTxsWithCoins(mapWallet[hash]);
         AddToSpends(hash);
     }
     else
@@ -1129,6 +1224,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
             }
         }
 
+        UpdateNoteIndexWithTx(wtx);
+        UpdateWalletTxsWithCoins(wtx);
+
         //// debug print
         LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
@@ -1240,11 +1338,22 @@ void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
 
 void CWallet::EraseFromWallet(const uint256 &hash)
 {
-    if (!fFileBacked)
-        return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it == mapWallet.end())
+            return;
+        for (const mapNoteData_t::value_type& item : it->second.mapNoteData) {
+            auto itAddr = mapNotesByAddress.find(item.second.address);
+            if (itAddr == mapNotesByAddress.end())
+                continue;
+            itAddr->second.erase(item.first);
+            if (itAddr->second.empty())
+                mapNotesByAddress.erase(itAddr);
+        }
+        mapWallet.erase(it);
+        fWalletTxsWithCoinsValid = false;
+        if (fFileBacked)
             CWalletDB(strWalletFile).EraseTx(hash);
     }
     return;
@@ -2140,9 +2249,8 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2156,9 +2264,8 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2171,9 +2278,8 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -2185,9 +2291,8 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2201,9 +2306,8 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2216,9 +2320,8 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -2234,10 +2337,9 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        BOOST_FOREACH(const CWalletTx* pcoin, GetWalletTxsWithCoins())
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -2258,8 +2360,8 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
                 isminetype mine = IsMine(pcoin->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected((*it).first, i)))
+                    !IsLockedCoin(wtxid, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(wtxid, i)))
                         vCoins.push_back(COutput(pcoin, i, nDepth, (mine & ISMINE_SPENDABLE) != ISMINE_NO));
             }
         }
@@ -3644,11 +3746,36 @@ bool CMerkleTx::AcceptToMemoryPool(bool fLimitFree, bool fRejectAbsurdFee)
     return ::AcceptToMemoryPool(mempool, state, *this, fLimitFree, NULL, fRejectAbsurdFee);
 }
 
+bool CWallet::IsLockedNote(const JSOutPoint& output) const
+{
+    AssertLockHeld(cs_wallet); // setLockedNotes
+    return (setLockedNotes.count(output) > 0);
+}
+
+void CWallet::LockNote(const JSOutPoint& output)
+{
+    AssertLockHeld(cs_wallet); // setLockedNotes
+    setLockedNotes.insert(output);
+}
+
+void CWallet::UnlockNote(const JSOutPoint& output)
+{
+    AssertLockHeld(cs_wallet); // setLockedNotes
+    setLockedNotes.erase(output);
+}
+
+void CWallet::UnlockAllNotes()
+{
+    AssertLockHeld(cs_wallet); // setLockedNotes
+    setLockedNotes.clear();
+}
+
 /**
- * Find notes in the wallet filtered by payment address, min depth and ability to spend.
+ * Find notes in the wallet filtered by payment address, min depth, ability to spend
+ * and whether they are locked by an operation in progress.
  * These notes are decrypted and added to the output parameter vector, outEntries.
  */
-void CWallet::GetFilteredNotes(std::vector<CNotePlaintextEntry> & outEntries, std::string address, int minDepth, bool ignoreSpent, bool ignoreUnspendable)
+void CWallet::GetFilteredNotes(std::vector<CNotePlaintextEntry> & outEntries, std::string address, int minDepth, bool ignoreSpent, bool ignoreUnspendable, bool ignoreLocked)
 {
     bool fFilterAddress = false;
     libzcash::PaymentAddress filterPaymentAddress;
@@ -3659,67 +3786,83 @@ void CWallet::GetFilteredNotes(std::vector<CNotePlaintextEntry> & outEntries, st
 
     LOCK2(cs_main, cs_wallet);
 
-    for (auto & p : mapWallet) {
-        CWalletTx wtx = p.second;
-
-        // Filter the transactions before checking for notes
-        if (!CheckFinalTx(wtx) || wtx.GetBlocksToMaturity() > 0 || wtx.GetDepthInMainChain() < minDepth) {
-            continue;
+    size_t nStart = outEntries.size();
+    auto itAddr = fFilterAddress ? mapNotesByAddress.find(filterPaymentAddress) : mapNotesByAddress.begin();
+    for (; itAddr != mapNotesByAddress.end(); ++itAddr) {
+        // skip notes which belong to a different payment address in the wallet
+        if (fFilterAddress && !(itAddr->first == filterPaymentAddress)) {
+            break;
         }
+        PaymentAddress pa = itAddr->first;
 
-        if (wtx.mapNoteData.size() == 0) {
+        // skip notes which cannot be spent
+        if (ignoreUnspendable && !HaveSpendingKey(pa)) {
             continue;
         }
 
-        for (auto & pair : wtx.mapNoteData) {
-            JSOutPoint jsop = pair.first;
-            CNoteData nd = pair.second;
-            PaymentAddress pa = nd.address;
+        for (const JSOutPoint& jsop : itAddr->second) {
+            std::map<uint256, CWalletTx>::iterator mi = mapWallet.find(jsop.hash);
+            if (mi == mapWallet.end()) {
+                continue;
+            }
+            CWalletTx& wtx = mi->second;
+
+            // Filter the transactions before checking for notes
+            if (!CheckFinalTx(wtx) || wtx.GetBlocksToMaturity() > 0 || wtx.GetDepthInMainChain() < minDepth) {
+                continue;
+            }
 
-            // skip notes which belong to a different payment address in the wallet
-            if (fFilterAddress && !(pa == filterPaymentAddress)) {
+            mapNoteData_t::iterator ni = wtx.mapNoteData.find(jsop);
+            if (ni == wtx.mapNoteData.end()) {
                 continue;
             }
+            CNoteData& nd = ni->second;
 
             // skip note which has been spent
             if (ignoreSpent && nd.nullifier && IsSpent(*nd.nullifier)) {
                 continue;
             }
 
-            // skip notes which cannot be spent
-            if (ignoreUnspendable && !HaveSpendingKey(pa)) {
+            // skip note which an operation in progress is spending
+            if (ignoreLocked && IsLockedNote(jsop)) {
                 continue;
             }
 
-            int i = jsop.js; // Index into CTransaction.vjoinsplit
-            int j = jsop.n; // Index into JSDescription.ciphertexts
+            if (!nd.plaintext) {
+                int i = jsop.js; // Index into CTransaction.vjoinsplit
+                int j = jsop.n; // Index into JSDescription.ciphertexts
 
-            // Get cached decryptor
-            ZCNoteDecryption decryptor;
-            if (!GetNoteDecryptor(pa, decryptor)) {
-                // Note decryptors are created when the wallet is loaded, so it should always exist
-                throw std::runtime_error(strprintf("Could not find note decryptor for payment address %s", CZCPaymentAddress(pa).ToString()));
-            }
+                // Get cached decryptor
+                ZCNoteDecryption decryptor;
+                if (!GetNoteDecryptor(pa, decryptor)) {
+                    // Note decryptors are created when the wallet is loaded, so it should always exist
+                    throw std::runtime_error(strprintf("Could not find note decryptor for payment address %s", CZCPaymentAddress(pa).ToString()));
+                }
 
-            // determine amount of funds in the note
-            auto hSig = wtx.vjoinsplit[i].h_sig(*pzcashParams, wtx.joinSplitPubKey);
-            try {
-                NotePlaintext plaintext = NotePlaintext::decrypt(
-                        decryptor,
-                        wtx.vjoinsplit[i].ciphertexts[j],
-                        wtx.vjoinsplit[i].ephemeralKey,
-                        hSig,
-                        (unsigned char) j);
-
-                outEntries.push_back(CNotePlaintextEntry{jsop, plaintext});
-
-            } catch (const note_decryption_failed &err) {
-                // Couldn't decrypt with this spending key
-                throw std::runtime_error(strprintf("Could not decrypt note for payment address %s", CZCPaymentAddress(pa).ToString()));
-            } catch (const std::exception &exc) {
-                // Unexpected failure
-                throw std::runtime_error(strprintf("Error while decrypting note for payment address %s: %s", CZCPaymentAddress(pa).ToString(), exc.what()));
+                // determine amount of funds in the note
+                auto hSig = wtx.vjoinsplit[i].h_sig(*pzcashParams, wtx.joinSplitPubKey);
+                try {
+                    nd.plaintext = NotePlaintext::decrypt(
+                            decryptor,
+                            wtx.vjoinsplit[i].ciphertexts[j],
+                            wtx.vjoinsplit[i].ephemeralKey,
+                            hSig,
+                            (unsigned char) j);
+                } catch (const note_decryption_failed &err) {
+                    // Couldn't decrypt with this spending key
+                    throw std::runtime_error(strprintf("Could not decrypt note for payment address %s", CZCPaymentAddress(pa).ToString()));
+                } catch (const std::exception &exc) {
+                    // Unexpected failure
+                    throw std::runtime_error(strprintf("Error while decrypting note for payment address %s: %s", CZCPaymentAddress(pa).ToString(), exc.what()));
+                }
             }
+
+            outEntries.push_back(CNotePlaintextEntry{jsop, *nd.plaintext});
         }
     }
+
+    // Return the notes in wallet order, as they were before the index existed.
+    std::sort(outEntries.begin() + nStart, outEntries.end(), [](const CNotePlaintextEntry& a, const CNotePlaintextEntry& b) {
+        return a.jsop < b.jsop;
+    });
 }
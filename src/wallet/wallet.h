@@ -51,6 +51,8 @@ static const CAmount nHighTransactionFeeWarning = 0.01 * COIN;
 static const CAmount DEFAULT_TRANSACTION_MAXFEE = 0.1 * COIN;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 2;
+//! -zproverthreads default
+static const unsigned int DEFAULT_JOINSPLIT_PROVER_THREADS = 2;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
 //! Largest (in bytes) free transaction we're willing to create
@@ -231,6 +233,13 @@ public:
      */
     int witnessHeight;
 
+    /**
+     * Cached decryption of the note, filled in the first time
+     * CWallet::GetFilteredNotes needs it. It is never serialized, so
+     * plaintexts are only held in memory and not written to the wallet file.
+     */
+    boost::optional<libzcash::NotePlaintext> plaintext;
+
     CNoteData() : address(), nullifier(), witnessHeight {-1} { }
     CNoteData(libzcash::PaymentAddress a) :
             address {a}, nullifier(), witnessHeight {-1} { }
@@ -692,6 +701,22 @@ private:
     void AddToSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Transactions in mapWallet that may still have unspent outputs of ours,
+     * so that balances and coin selection can skip the (typically much larger)
+     * set of fully spent ones. A transaction is dropped once each of its
+     * outputs is either not ours or spent by a transaction in the main chain.
+     * AddToWallet re-adds a transaction and its parents whenever it changes,
+     * which covers spends being disconnected. Rebuilt from mapWallet on first
+     * use and after MarkDirty() or EraseFromWallet().
+     */
+    mutable std::set<uint256> setWalletTxsWithCoins;
+    mutable bool fWalletTxsWithCoinsValid;
+
+    bool IsSpentInMainChain(const uint256& hash, unsigned int n) const;
+    std::vector<const CWalletTx*> GetWalletTxsWithCoins() const;
+    void UpdateWalletTxsWithCoins(const CWalletTx& wtx);
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -814,6 +839,7 @@ public:
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fWalletTxsWithCoinsValid = false;
     }
 
     /**
@@ -826,8 +852,8 @@ public:
      * - Parent transactions can't be marked dirty when a child transaction that
      *   spends their output notes is updated.
      *
-     *   - We currently don't cache any note values, so this is not a problem,
-     *     yet.
+     *   - Note plaintexts are cached (see CNoteData), but they do not depend
+     *     on whether the note is spent, so this is not a problem.
      *
      * - GetFilteredNotes can't filter out spent notes.
      *
@@ -866,6 +892,13 @@ public:
      */
     std::map<uint256, JSOutPoint> mapNullifiersToNotes;
 
+    /**
+     * Every note in mapWallet, by the payment address it was sent to, so that
+     * GetFilteredNotes only visits the transactions that can match a query.
+     * Kept in step with mapNoteData by UpdateNoteIndexWithTx.
+     */
+    std::map<libzcash::PaymentAddress, std::set<JSOutPoint>> mapNotesByAddress;
+
     std::map<uint256, CWalletTx> mapWallet;
 
     int64_t nOrderPosNext;
@@ -876,10 +909,18 @@ public:
     CPubKey vchDefaultKey;
 
     std::set<COutPoint> setLockedCoins;
+    std::set<JSOutPoint> setLockedNotes;
 
     int64_t nTimeFirstKey;
 
     const CWalletTx* GetWalletTx(const uint256& hash) const;
+    /**
+     * Whether the wallet holds the transaction and has seen it in a block.
+     * sendrawtransaction reports a mined transaction only while it has
+     * unspent transparent outputs, so a resumed z_sendmany or
+     * z_shieldcoinbase asks the wallet whether its earlier send got through.
+     */
+    bool IsTxInMainChain(const uint256& hash) const;
 
     //! check whether we are allowed to upgrade (or already support) to the named feature
     bool CanSupportFeature(enum WalletFeature wf) { AssertLockHeld(cs_wallet); return nWalletMaxVersion >= wf; }
@@ -896,6 +937,11 @@ public:
     void UnlockAllCoins();
     void ListLockedCoins(std::vector<COutPoint>& vOutpts);
 
+    bool IsLockedNote(const JSOutPoint& output) const;
+    void LockNote(const JSOutPoint& output);
+    void UnlockNote(const JSOutPoint& output);
+    void UnlockAllNotes();
+
     /**
      * keystore implementation
      * Generate a new key
@@ -979,6 +1025,7 @@ public:
     void MarkDirty();
     bool UpdateNullifierNoteMap();
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
+    void UpdateNoteIndexWithTx(const CWalletTx& wtx);
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
@@ -1120,12 +1167,13 @@ public:
     /** Set whether this wallet broadcasts transactions. */
     void SetBroadcastTransactions(bool broadcast) { fBroadcastTransactions = broadcast; }
     
-    /* Find notes filtered by payment address, min depth, ability to spend */
+    /* Find notes filtered by payment address, min depth, ability to spend, and whether they are locked */
     void GetFilteredNotes(std::vector<CNotePlaintextEntry> & outEntries,
                           std::string address,
                           int minDepth=1,
                           bool ignoreSpent=true,
-                          bool ignoreUnspendable=true);
+                          bool ignoreUnspendable=true,
+                          bool ignoreLocked=true);
     
 };
 
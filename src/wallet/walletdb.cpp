@@ -425,7 +425,9 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
             ssValue >> wtx;
             CValidationState state;
             auto verifier = libzcash::ProofVerifier::Strict();
-            if (!(CheckTransaction(wtx, state, verifier) && (wtx.GetHash() == hash) && state.IsValid()))
+            // Proofs of wallet transactions are mostly already mined, so
+            // they are not added to the JoinSplit cache
+            if (!(CheckTransaction(wtx, state, verifier, CACHE_LOOKUP) && (wtx.GetHash() == hash) && state.IsValid()))
                 return false;
 
             // Undo serialize changes in 31600
@@ -1103,3 +1105,51 @@ bool CWalletDB::EraseDestData(const std::string &address, const std::string &key
     nWalletDBUpdated++;
     return Erase(std::make_pair(std::string("destdata"), std::make_pair(address, key)));
 }
+
+bool CWalletDB::WriteAsyncOperation(const std::string& strId, const CAsyncOperationRecord& record)
+{
+    nWalletDBUpdated++;
+    return Write(std::make_pair(std::string("asyncop"), strId), record);
+}
+
+bool CWalletDB::EraseAsyncOperation(const std::string& strId)
+{
+    nWalletDBUpdated++;
+    return Erase(std::make_pair(std::string("asyncop"), strId));
+}
+
+void CWalletDB::ListAsyncOperations(std::map<std::string, CAsyncOperationRecord>& mapRecords)
+{
+    Dbc* pcursor = GetCursor();
+    if (!pcursor)
+        throw runtime_error("CWalletDB::ListAsyncOperations(): cannot create DB cursor");
+    unsigned int fFlags = DB_SET_RANGE;
+    while (true)
+    {
+        // Read next record
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        if (fFlags == DB_SET_RANGE)
+            ssKey << std::make_pair(std::string("asyncop"), string(""));
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        int ret = ReadAtCursor(pcursor, ssKey, ssValue, fFlags);
+        fFlags = DB_NEXT;
+        if (ret == DB_NOTFOUND)
+            break;
+        else if (ret != 0)
+        {
+            pcursor->close();
+            throw runtime_error("CWalletDB::ListAsyncOperations(): error scanning DB");
+        }
+
+        // Unserialize
+        string strType;
+        ssKey >> strType;
+        if (strType != "asyncop")
+            break;
+        string strId;
+        ssKey >> strId;
+        ssValue >> mapRecords[strId];
+    }
+
+    pcursor->close();
+}
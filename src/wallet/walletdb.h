@@ -13,6 +13,7 @@
 #include "zcash/Address.hpp"
 
 #include <list>
+#include <map>
 #include <stdint.h>
 #include <string>
 #include <utility>
@@ -73,6 +74,48 @@ public:
     }
 };
 
+/**
+ * A z_sendmany or z_shieldcoinbase operation that has not finished, saved so
+ * that it can be resumed after a restart. vchData is the operation's own
+ * checkpoint of its parameters and progress.
+ */
+class CAsyncOperationRecord
+{
+public:
+    static const int CURRENT_VERSION=1;
+    int nVersion;
+    std::string strMethod;
+    int64_t nCreationTime;
+    int nPriority;
+    std::vector<unsigned char> vchData;
+
+    CAsyncOperationRecord()
+    {
+        SetNull();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(this->nVersion);
+        nVersion = this->nVersion;
+        READWRITE(strMethod);
+        READWRITE(nCreationTime);
+        READWRITE(nPriority);
+        READWRITE(vchData);
+    }
+
+    void SetNull()
+    {
+        nVersion = CAsyncOperationRecord::CURRENT_VERSION;
+        strMethod.clear();
+        nCreationTime = 0;
+        nPriority = 0;
+        vchData.clear();
+    }
+};
+
 /** Access to the wallet database (wallet.dat) */
 class CWalletDB : public CDB
 {
@@ -143,6 +186,11 @@ public:
     bool WriteViewingKey(const libzcash::ViewingKey &vk);
     bool EraseViewingKey(const libzcash::ViewingKey &vk);
 
+    /// Save, forget and list the unfinished async operations, by operation id
+    bool WriteAsyncOperation(const std::string& strId, const CAsyncOperationRecord& record);
+    bool EraseAsyncOperation(const std::string& strId);
+    void ListAsyncOperations(std::map<std::string, CAsyncOperationRecord>& mapRecords);
+
 private:
     CWalletDB(const CWalletDB&);
     void operator=(const CWalletDB&);
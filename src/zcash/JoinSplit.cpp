@@ -151,7 +151,8 @@ public:
         uint64_t vpub_new,
         const uint256& rt,
         bool computeProof,
-        uint256 *out_esk // Payment disclosure
+        uint256 *out_esk, // Payment disclosure
+        JSProofWitness<NumInputs, NumOutputs> *out_witness
     ) {
         if (vpub_old > MAX_MONEY) {
             throw std::invalid_argument("nonsensical vpub_old value");
@@ -267,22 +268,38 @@ public:
             out_macs[i] = PRF_pk(inputs[i].key, i, h_sig);
         }
 
+        JSProofWitness<NumInputs, NumOutputs> witness;
+        witness.inputs = inputs;
+        witness.notes = out_notes;
+        witness.phi = phi;
+        witness.h_sig = h_sig;
+        witness.vpub_old = vpub_old;
+        witness.vpub_new = vpub_new;
+        witness.rt = rt;
+
         if (!computeProof) {
+            if (out_witness != nullptr) {
+                *out_witness = witness;
+            }
             return ZCProof();
         }
 
+        return prove(witness);
+    }
+
+    ZCProof prove(const JSProofWitness<NumInputs, NumOutputs>& witness) {
         protoboard<FieldT> pb;
         {
             joinsplit_gadget<FieldT, NumInputs, NumOutputs> g(pb);
             g.generate_r1cs_constraints();
             g.generate_r1cs_witness(
-                phi,
-                rt,
-                h_sig,
-                inputs,
-                out_notes,
-                vpub_old,
-                vpub_new
+                witness.phi,
+                witness.rt,
+                witness.h_sig,
+                witness.inputs,
+                witness.notes,
+                witness.vpub_old,
+                witness.vpub_new
             );
         }
 
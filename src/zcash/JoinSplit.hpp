@@ -29,6 +29,15 @@ public:
     uint256 nullifier() const {
         return note.nullifier(key);
     }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(witness);
+        READWRITE(note);
+        READWRITE(key);
+    }
 };
 
 class JSOutput {
@@ -43,6 +52,33 @@ public:
     Note note(const uint252& phi, const uint256& r, size_t i, const uint256& h_sig) const;
 };
 
+// Everything the zk-SNARK proof of a JoinSplit depends on, once its output
+// notes have been sampled. Lets the (slow) proof be generated separately
+// from the rest of the JoinSplit.
+template<size_t NumInputs, size_t NumOutputs>
+struct JSProofWitness {
+    boost::array<JSInput, NumInputs> inputs;
+    boost::array<Note, NumOutputs> notes;
+    uint252 phi;
+    uint256 h_sig;
+    uint64_t vpub_old;
+    uint64_t vpub_new;
+    uint256 rt;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(inputs);
+        READWRITE(notes);
+        READWRITE(phi);
+        READWRITE(h_sig);
+        READWRITE(vpub_old);
+        READWRITE(vpub_new);
+        READWRITE(rt);
+    }
+};
+
 template<size_t NumInputs, size_t NumOutputs>
 class JoinSplit {
 public:
@@ -77,9 +113,14 @@ public:
         // For paymentdisclosure, we need to retrieve the esk.
         // Reference as non-const parameter with default value leads to compile error.
         // So use pointer for simplicity.
-        uint256 *out_esk = nullptr
+        uint256 *out_esk = nullptr,
+        // When computeProof is false, receives what is needed to compute
+        // the proof later with prove(const JSProofWitness&).
+        JSProofWitness<NumInputs, NumOutputs> *out_witness = nullptr
     ) = 0;
 
+    virtual ZCProof prove(const JSProofWitness<NumInputs, NumOutputs>& witness) = 0;
+
     virtual bool verify(
         const ZCProof& proof,
         ProofVerifier& verifier,
@@ -101,5 +142,7 @@ protected:
 
 typedef libzcash::JoinSplit<ZC_NUM_JS_INPUTS,
                             ZC_NUM_JS_OUTPUTS> ZCJoinSplit;
+typedef libzcash::JSProofWitness<ZC_NUM_JS_INPUTS,
+                                 ZC_NUM_JS_OUTPUTS> ZCJSProofWitness;
 
 #endif // ZC_JOINSPLIT_H_
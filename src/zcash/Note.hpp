@@ -22,6 +22,16 @@ public:
 
     uint256 cm() const;
     uint256 nullifier(const SpendingKey& a_sk) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(a_pk);
+        READWRITE(value);
+        READWRITE(rho);
+        READWRITE(r);
+    }
 };
 
 class NotePlaintext {
@@ -259,6 +259,9 @@ public:
     // such as during reindexing.
     static ProofVerifier Disabled();
 
+    // Whether proofs are actually checked.
+    bool IsStrict() const { return perform_verification; }
+
     template <typename VerificationKey,
               typename ProcessedVerificationKey,
               typename PrimaryInput,
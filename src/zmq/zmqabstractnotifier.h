@@ -6,8 +6,8 @@
 #define BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 
 #include "zmqconfig.h"
+#include "notificationqueue.h"
 
-class CBlockIndex;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -32,8 +32,12 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
-    virtual bool NotifyTransaction(const CTransaction &transaction);
+    //! Whether the notifier publishes the serialized block or transaction.
+    virtual bool PublishesData() const { return false; }
+
+    //! Called from the notification queue's thread.
+    virtual bool NotifyBlock(const CNotificationData &block);
+    virtual bool NotifyTransaction(const CNotificationData &transaction);
 
 protected:
     void *psocket;
@@ -10,12 +10,14 @@
 #include "streams.h"
 #include "util.h"
 
+#include <algorithm>
+
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL), fBlockData(false), fTransactionData(false), nBlockSequence(0), nTransactionSequence(0)
 {
 }
 
@@ -56,8 +58,28 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
 
     if (!notifiers.empty())
     {
+        int64_t nQueueSize = DEFAULT_NOTIFICATION_QUEUE_SIZE;
+        std::map<std::string, std::string>::const_iterator it = args.find("-zmqqueuesize");
+        if (it != args.end())
+            nQueueSize = std::max((int64_t)1, atoi64(it->second));
+        NotificationQueuePolicy policy = NOTIFY_DROP;
+        it = args.find("-zmqqueuepolicy");
+        if (it != args.end())
+            ParseNotificationQueuePolicy(it->second, policy);
+
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->queue.reset(new CNotificationQueue(nQueueSize << 20, policy));
+        for (std::list<CZMQAbstractNotifier*>::const_iterator i = notifiers.begin(); i != notifiers.end(); ++i)
+        {
+            if ((*i)->PublishesData())
+            {
+                if ((*i)->GetType() == "pubrawblock")
+                    notificationInterface->fBlockData = true;
+                else
+                    notificationInterface->fTransactionData = true;
+            }
+        }
 
         if (!notificationInterface->Initialize())
         {
@@ -103,6 +125,8 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    // From here on the sockets are only used by the queue's thread.
+    queue->Start();
     return true;
 }
 
@@ -110,6 +134,8 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    if (queue)
+        queue->Stop();
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -124,12 +150,87 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
+void CZMQNotificationInterface::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+{
+    // Blocks are only announced once the node is in sync, so there is no
+    // point in serializing them before.
+    if (!fBlockData || !added || IsInitialBlockDownload())
+        return;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *pblock;
+    std::lock_guard<std::mutex> lock(cs_lastBlock);
+    hashLastBlock = pindex->GetBlockHash();
+    lastBlockData = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+}
+
 void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    CNotificationData block;
+    block.hash = pindex->GetBlockHash();
+    CDiskBlockPos pos;
+    if (fBlockData)
+    {
+        std::lock_guard<std::mutex> lock(cs_lastBlock);
+        if (hashLastBlock == block.hash)
+            block.data = lastBlockData;
+        lastBlockData.reset();
+    }
+    if (fBlockData && !block.data)
+    {
+        // The block was connected before ChainTip serialized blocks, so it
+        // is read back from disk on the queue's thread instead.
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+
+    std::lock_guard<std::mutex> lock(cs_sequence);
+    block.nSequence = nBlockSequence++;
+    size_t nSize = block.data ? block.data->size() : 0;
+    if (!queue->Push([this, block, pos]() mutable {
+            if (!pos.IsNull())
+            {
+                CBlock blockRead;
+                if (ReadBlockFromDisk(blockRead, pos))
+                {
+                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    ss << blockRead;
+                    block.data = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+                }
+            }
+            PublishBlock(block);
+        }, nSize))
+    {
+        LogPrint("zmq", "zmq: Notification queue full, dropped block %s\n", block.hash.GetHex());
+    }
+}
+
+void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    CNotificationData transaction;
+    transaction.hash = tx.GetHash();
+    if (fTransactionData)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << tx;
+        transaction.data = std::make_shared<const std::vector<unsigned char> >(ss.begin(), ss.end());
+    }
+
+    std::lock_guard<std::mutex> lock(cs_sequence);
+    transaction.nSequence = nTransactionSequence++;
+    size_t nSize = transaction.data ? transaction.data->size() : 0;
+    if (!queue->Push([this, transaction]() { PublishTransaction(transaction); }, nSize))
+    {
+        LogPrint("zmq", "zmq: Notification queue full, dropped transaction %s\n", transaction.hash.GetHex());
+    }
+}
+
+void CZMQNotificationInterface::PublishBlock(const CNotificationData &block)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
+        if (notifier->NotifyBlock(block))
         {
             i++;
         }
@@ -141,12 +242,12 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
-void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+void CZMQNotificationInterface::PublishTransaction(const CNotificationData &transaction)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+        if (notifier->NotifyTransaction(transaction))
         {
             i++;
         }
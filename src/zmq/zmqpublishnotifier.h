@@ -7,22 +7,18 @@
 
 #include "zmqabstractnotifier.h"
 
-class CBlockIndex;
-
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
-private:
-    uint32_t nSequence; //! upcounting per message sequence number
-
 public:
 
     /* send zmq multipart message
        parts:
           * command
           * data
-          * message sequence number
+          * message sequence number, counting the notifications of this
+            kind including any dropped from the queue
     */
-    bool SendMessage(const char *command, const void* data, size_t size);
+    bool SendMessage(const char *command, const void* data, size_t size, uint32_t nSequence);
 
     bool Initialize(void *pcontext);
     void Shutdown();
@@ -31,25 +27,27 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CNotificationData &block);
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NotifyTransaction(const CNotificationData &transaction);
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool PublishesData() const { return true; }
+    bool NotifyBlock(const CNotificationData &block);
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool PublishesData() const { return true; }
+    bool NotifyTransaction(const CNotificationData &transaction);
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H